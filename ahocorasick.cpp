@@ -0,0 +1,86 @@
+#include "ahocorasick.hpp"
+
+#include <limits>
+#include <queue>
+
+AhoCorasick::AhoCorasick(const std::vector<std::string>& patterns)
+    : patternCount(patterns.size())
+{
+    static constexpr auto NONE = std::numeric_limits<uint32_t>::max();
+
+    // Class 0 is shared by all bytes that don't appear in any pattern
+    std::array<bool, 256> used {};
+    for (const auto& pattern : patterns) {
+        for (const auto c : pattern) {
+            used[static_cast<unsigned char>(c)] = true;
+        }
+    }
+    numClasses = 1;
+    for (size_t i = 0; i < used.size(); i++) {
+        byteClass[i] = used[i] ? static_cast<uint32_t>(numClasses++) : 0;
+    }
+
+    // Build the trie
+    transitions.assign(numClasses, NONE);
+    std::vector<std::vector<uint32_t>> outputs(1);
+
+    for (size_t i = 0; i < patterns.size(); i++) {
+        if (patterns[i].empty()) {
+            continue;
+        }
+
+        uint32_t state = ROOT;
+        for (const auto c : patterns[i]) {
+            auto& next = transitions[(state * numClasses) + byteClass[static_cast<unsigned char>(c)]];
+            if (next == NONE) {
+                next = static_cast<uint32_t>(outputs.size());
+                outputs.emplace_back();
+                transitions.resize(transitions.size() + numClasses, NONE);
+            }
+            // `next` may be dangling after the resize above, index again
+            state = transitions[(state * numClasses) + byteClass[static_cast<unsigned char>(c)]];
+        }
+        outputs[state].push_back(static_cast<uint32_t>(i));
+    }
+
+    // Breadth first traversal to compute the failure links and fill in the missing transitions
+    std::vector<uint32_t> failure(outputs.size(), ROOT);
+    std::queue<uint32_t> pending;
+
+    for (size_t cls = 0; cls < numClasses; cls++) {
+        auto& next = transitions[cls];
+        if (next == NONE) {
+            next = ROOT;
+        } else {
+            pending.push(next);
+        }
+    }
+
+    while (!pending.empty()) {
+        const auto state = pending.front();
+        pending.pop();
+
+        for (size_t cls = 0; cls < numClasses; cls++) {
+            const auto fallback = transitions[(failure[state] * numClasses) + cls];
+            auto& next = transitions[(state * numClasses) + cls];
+
+            if (next == NONE) {
+                next = fallback;
+                continue;
+            }
+
+            failure[next] = fallback;
+            // A state also recognizes everything its longest proper suffix recognizes
+            const auto& inherited = outputs[fallback];
+            outputs[next].insert(outputs[next].end(), inherited.begin(), inherited.end());
+            pending.push(next);
+        }
+    }
+
+    outputStart.reserve(outputs.size() + 1);
+    for (const auto& out : outputs) {
+        outputStart.push_back(static_cast<uint32_t>(outputPatterns.size()));
+        outputPatterns.insert(outputPatterns.end(), out.begin(), out.end());
+    }
+    outputStart.push_back(static_cast<uint32_t>(outputPatterns.size()));
+}
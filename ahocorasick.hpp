@@ -0,0 +1,61 @@
+#ifndef AHOCORASICK_HPP
+#define AHOCORASICK_HPP
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Multi-pattern matcher. The patterns are compiled into a DFA (trie + failure links folded into the transition table),
+// so searching costs one table lookup per input byte regardless of the number of patterns.
+// Bytes that don't occur in any pattern share a single column in the table to keep it small.
+class AhoCorasick final {
+public:
+    static constexpr uint32_t ROOT = 0;
+
+    AhoCorasick() = default;
+    // Empty patterns never match
+    explicit AhoCorasick(const std::vector<std::string>& patterns);
+
+    [[nodiscard]] bool empty() const { return patternCount == 0; }
+    [[nodiscard]] size_t size() const { return patternCount; }
+    [[nodiscard]] size_t stateCount() const { return numClasses ? transitions.size() / numClasses : 0; }
+
+    // Runs the automaton over `text` starting from `state` and calls onMatch(patternIndex, endOffset) for every
+    // occurrence, where endOffset is the offset in `text` just past the match. Returns the final state.
+    template <typename OnMatch>
+    uint32_t search(const std::string_view text, uint32_t state, OnMatch&& onMatch) const
+    {
+        if (empty()) {
+            return state;
+        }
+
+        // NOLINTNEXTLINE(altera-id-dependent-backward-branch)
+        for (size_t i = 0; i < text.size(); i++) {
+            state = transitions[(state * numClasses) + byteClass[static_cast<unsigned char>(text[i])]];
+
+            const auto begin = outputStart[state];
+            const auto end = outputStart[state + 1];
+            // NOLINTNEXTLINE(altera-id-dependent-backward-branch)
+            for (auto k = begin; k < end; k++) {
+                onMatch(static_cast<size_t>(outputPatterns[k]), i + 1);
+            }
+        }
+
+        return state;
+    }
+
+private:
+    size_t patternCount {};
+    size_t numClasses {};
+    std::array<uint32_t, 256> byteClass {};
+    // numClasses entries per state
+    std::vector<uint32_t> transitions;
+    // Patterns recognized in state `s` are outputPatterns[outputStart[s] .. outputStart[s + 1]]
+    std::vector<uint32_t> outputStart;
+    std::vector<uint32_t> outputPatterns;
+};
+
+#endif // AHOCORASICK_HPP
@@ -0,0 +1,482 @@
+#include "archivefile.hpp"
+
+#include <QDebug>
+#include <QFile>
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <list>
+#include <new>
+#include <stdexcept>
+#include <sys/file.h>
+#include <unistd.h>
+#include <utility>
+#include <vector>
+
+#ifdef LIBURING_AVAILABLE
+#include <liburing.h>
+#endif
+
+[[nodiscard]] static std::runtime_error ioError(const QString& what, const QString& filename, const int err)
+{
+    return std::runtime_error(QStringLiteral("%1 %2: %3").arg(what, filename, QString::fromLocal8Bit(strerror(err))).toStdString());
+}
+
+class PwriteArchiveFile final : public ArchiveFile {
+public:
+    PwriteArchiveFile(const QString& filename, const int newFd, const Options& newOptions)
+        : ArchiveFile(filename, newFd, newOptions)
+    {
+    }
+
+protected:
+    Buffer submit(Buffer buffer, const size_t len, const qint64 offset, const bool /*afterPrevious*/) override
+    {
+        size_t done {};
+        // NOLINTNEXTLINE(altera-id-dependent-backward-branch)
+        while (done < len) {
+            // NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+            const auto result = pwrite(fd, buffer.get() + done, len - done, offset + static_cast<qint64>(done));
+            if (result < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                const auto err = errno;
+                failedOffset = offset + static_cast<qint64>(done);
+                throw ioError(QStringLiteral("Failed to write"), name, err);
+            }
+            done += static_cast<size_t>(result);
+        }
+        completedEnd = std::max(completedEnd, offset + static_cast<qint64>(len));
+        return buffer;
+    }
+
+    void waitForWrites() override { }
+
+    void syncFile(const bool metadata) override
+    {
+        if ((metadata ? fsync(fd) : fdatasync(fd)) != 0) {
+            throw ioError(QStringLiteral("Failed to sync"), name, errno);
+        }
+    }
+};
+
+#ifdef LIBURING_AVAILABLE
+// Writes are queued and submitted in batches: when all buffers are used up, and on every sync.
+// Syncs are queued behind the writes and not waited for, except when a file is finished.
+class UringArchiveFile final : public ArchiveFile {
+public:
+    UringArchiveFile(const QString& filename, const int newFd, const Options& newOptions)
+        : ArchiveFile(filename, newFd, newOptions)
+    {
+        if (const auto result = io_uring_queue_init(QUEUE_DEPTH, &ring, 0); result < 0) {
+            throw ioError(QStringLiteral("Failed to set up io_uring for"), name, -result);
+        }
+    }
+    UringArchiveFile(const UringArchiveFile&) = delete;
+    UringArchiveFile(UringArchiveFile&&) = delete;
+    UringArchiveFile& operator=(const UringArchiveFile&) = delete;
+    UringArchiveFile& operator=(UringArchiveFile&&) = delete;
+
+    ~UringArchiveFile() override
+    {
+        try {
+            waitForWrites();
+        } catch (std::exception& e) {
+            qWarning() << e.what();
+        }
+        io_uring_queue_exit(&ring);
+    }
+
+protected:
+    Buffer submit(Buffer buffer, const size_t len, const qint64 offset, const bool afterPrevious) override
+    {
+        auto* const sqe = getSqe();
+        auto& request = requests.emplace_back(Request { std::move(buffer), offset, len });
+        io_uring_prep_write(sqe, fd, request.buffer.get(), static_cast<unsigned>(len), static_cast<__u64>(offset));
+        if (afterPrevious) {
+            io_uring_sqe_set_flags(sqe, IOSQE_IO_DRAIN);
+        }
+        io_uring_sqe_set_data(sqe, &request);
+        queued++;
+        submittedEnd = std::max(submittedEnd, offset + static_cast<qint64>(len));
+        updateCompletedEnd();
+
+        return acquireBuffer();
+    }
+
+    void waitForWrites() override
+    {
+        submitQueued();
+        // NOLINTNEXTLINE(altera-id-dependent-backward-branch)
+        while (inFlight) {
+            reap(true);
+        }
+    }
+
+    void syncFile(const bool metadata) override
+    {
+        auto* const sqe = getSqe();
+        auto& request = requests.emplace_back();
+        io_uring_prep_fsync(sqe, fd, metadata ? 0 : IORING_FSYNC_DATASYNC);
+        // Only after all the writes queued before it
+        io_uring_sqe_set_flags(sqe, IOSQE_IO_DRAIN);
+        io_uring_sqe_set_data(sqe, &request);
+        queued++;
+        submitQueued();
+    }
+
+private:
+    static constexpr unsigned QUEUE_DEPTH = 16;
+    static constexpr size_t MAX_BUFFERS = 4;
+
+    struct Request {
+        // Empty for a sync
+        Buffer buffer;
+        qint64 offset {};
+        size_t len {};
+    };
+
+    io_uring ring {};
+    // Queued or in flight
+    std::list<Request> requests;
+    std::vector<Buffer> freeBuffers;
+    // Including the one the base class is filling
+    size_t allocatedBuffers = 1;
+    unsigned queued {};
+    unsigned inFlight {};
+    qint64 submittedEnd {};
+
+    io_uring_sqe* getSqe()
+    {
+        auto* sqe = io_uring_get_sqe(&ring);
+        if (!sqe) {
+            // Submitting frees up the submission queue
+            submitQueued();
+            sqe = io_uring_get_sqe(&ring);
+        }
+        if (!sqe) {
+            throw std::runtime_error("io_uring submission queue is full");
+        }
+        return sqe;
+    }
+
+    void submitQueued()
+    {
+        if (!queued) {
+            return;
+        }
+        const auto result = io_uring_submit(&ring);
+        if (result < 0) {
+            throw ioError(QStringLiteral("Failed to submit writes for"), name, -result);
+        }
+        queued -= static_cast<unsigned>(result);
+        inFlight += static_cast<unsigned>(result);
+    }
+
+    Buffer acquireBuffer()
+    {
+        reap(false);
+        // NOLINTNEXTLINE(altera-id-dependent-backward-branch)
+        while (freeBuffers.empty()) {
+            if (allocatedBuffers < MAX_BUFFERS) {
+                allocatedBuffers++;
+                return allocateBuffer();
+            }
+            // All buffers are queued or being written
+            submitQueued();
+            reap(true);
+        }
+        auto buffer = std::move(freeBuffers.back());
+        freeBuffers.pop_back();
+        return buffer;
+    }
+
+    // Handles the completed requests, waits for one first if `wait`
+    void reap(const bool wait)
+    {
+        io_uring_cqe* cqe {};
+        if (wait && inFlight) {
+            int result {};
+            // NOLINTNEXTLINE(altera-id-dependent-backward-branch)
+            do {
+                result = io_uring_wait_cqe(&ring, &cqe);
+            } while (result == -EINTR);
+            if (result < 0) {
+                throw ioError(QStringLiteral("Failed to wait for writes to"), name, -result);
+            }
+            complete(cqe);
+        }
+        // NOLINTNEXTLINE(altera-id-dependent-backward-branch)
+        while (io_uring_peek_cqe(&ring, &cqe) == 0) {
+            complete(cqe);
+        }
+    }
+
+    void complete(io_uring_cqe* cqe)
+    {
+        auto* const request = static_cast<Request*>(io_uring_cqe_get_data(cqe));
+        const auto result = cqe->res;
+        io_uring_cqe_seen(&ring, cqe);
+        inFlight--;
+
+        if (request->buffer) {
+            if (result < 0 || static_cast<size_t>(result) != request->len) {
+                if (error.isEmpty()) {
+                    error = (result < 0) ? QString::fromStdString(ioError(QStringLiteral("Failed to write"), name, -result).what())
+                                         : QStringLiteral("Short write to %1").arg(name);
+                }
+                failedOffset = (failedOffset < 0) ? request->offset : std::min(failedOffset, request->offset);
+            }
+            freeBuffers.push_back(std::move(request->buffer));
+        } else if (result < 0 && error.isEmpty()) {
+            error = QString::fromStdString(ioError(QStringLiteral("Failed to sync"), name, -result).what());
+        }
+
+        requests.remove_if([request](const Request& r) { return &r == request; });
+        updateCompletedEnd();
+    }
+
+    void updateCompletedEnd()
+    {
+        completedEnd = submittedEnd;
+        for (const auto& request : requests) {
+            if (request.buffer) {
+                completedEnd = std::min(completedEnd, request.offset);
+            }
+        }
+    }
+};
+#endif
+
+std::unique_ptr<ArchiveFile> ArchiveFile::create(const QString& filename, const Options& options)
+{
+    const auto path = QFile::encodeName(filename);
+    // Readable for reading back the partial block with direct I/O
+    constexpr int FLAGS = O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC;
+    constexpr mode_t MODE = 0666;
+
+    auto actualOptions = options;
+    int newFd = ::open(path.constData(), FLAGS | (options.directIo ? O_DIRECT : 0), MODE); // NOLINT(cppcoreguidelines-pro-type-vararg)
+    if (newFd < 0 && options.directIo && errno == EINVAL) {
+        qWarning() << filename << "doesn't support direct I/O, using buffered I/O";
+        actualOptions.directIo = false;
+        // The file may or may not have been created before O_DIRECT was rejected
+        newFd = ::open(path.constData(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, MODE); // NOLINT(cppcoreguidelines-pro-type-vararg)
+    }
+    if (newFd < 0) {
+        throw ioError(QStringLiteral("Failed to open"), filename, errno);
+    }
+    // Tells ArchiveRetention, of this or another instance, that the archive is being written. A retention pass may
+    // hold the lock for a moment while it checks the new file.
+    if (flock(newFd, LOCK_EX) != 0) {
+        const auto error = errno;
+        ::close(newFd);
+        throw ioError(QStringLiteral("Failed to lock"), filename, error);
+    }
+
+    if (options.backend == Backend::IoUring) {
+#ifdef LIBURING_AVAILABLE
+        if (isIoUringAvailable()) {
+            return std::make_unique<UringArchiveFile>(filename, newFd, actualOptions);
+        }
+        qWarning() << "io_uring is not available, using pwrite";
+#else
+        qWarning() << "Built without io_uring support, using pwrite";
+#endif
+    }
+    return std::make_unique<PwriteArchiveFile>(filename, newFd, actualOptions);
+}
+
+bool ArchiveFile::isIoUringAvailable()
+{
+#ifdef LIBURING_AVAILABLE
+    // Can be disabled by the kernel configuration, sysctl or a seccomp filter (e.g. in containers)
+    static const bool available = []() {
+        io_uring ring {};
+        if (io_uring_queue_init(2, &ring, 0) < 0) {
+            return false;
+        }
+        io_uring_queue_exit(&ring);
+        return true;
+    }();
+    return available;
+#else
+    return false;
+#endif
+}
+
+ArchiveFile::ArchiveFile(const QString& filename, const int newFd, const Options& newOptions)
+    : fd(newFd)
+    , name(filename)
+    , options(newOptions)
+    , current(allocateBuffer())
+{
+}
+
+ArchiveFile::~ArchiveFile()
+{
+    if (fd >= 0) {
+        ::close(fd);
+    }
+}
+
+ArchiveFile::Buffer ArchiveFile::allocateBuffer()
+{
+    // Direct I/O needs the memory aligned like the file offsets
+    auto* const buffer = static_cast<char*>(std::aligned_alloc(BLOCK_SIZE, BUFFER_SIZE)); // NOLINT(cppcoreguidelines-no-malloc,cppcoreguidelines-owning-memory)
+    if (!buffer) {
+        throw std::bad_alloc();
+    }
+    return Buffer(buffer);
+}
+
+qint64 ArchiveFile::writtenSize() const
+{
+    const auto end = std::min(completedEnd, logicalSize);
+    return (failedOffset < 0) ? end : std::min(end, failedOffset);
+}
+
+void ArchiveFile::checkError()
+{
+    if (!error.isEmpty()) {
+        throw std::runtime_error(error.toStdString());
+    }
+}
+
+void ArchiveFile::write(const char* data, const size_t len)
+{
+    checkError();
+
+    size_t done {};
+    // NOLINTNEXTLINE(altera-id-dependent-backward-branch)
+    while (done < len) {
+        const auto count = std::min(len - done, BUFFER_SIZE - used);
+        memcpy(current.get() + used, data + done, count); // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+        used += count;
+        done += count;
+        logicalSize += static_cast<qint64>(count);
+        if (used == BUFFER_SIZE) {
+            flushBuffer();
+        }
+    }
+}
+
+void ArchiveFile::flushBuffer()
+{
+    if (used == 0) {
+        return;
+    }
+
+    // Direct I/O can only write whole blocks, the last partial block is padded and kept to be written again
+    auto len = used;
+    size_t tail {};
+    std::array<char, BLOCK_SIZE> tailData {};
+    if (options.directIo) {
+        tail = used % BLOCK_SIZE;
+        if (tail) {
+            len = used - tail + BLOCK_SIZE;
+            // NOLINTBEGIN(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+            memset(current.get() + used, 0, len - used);
+            memcpy(tailData.data(), current.get() + used - tail, tail);
+            // NOLINTEND(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+        }
+    }
+
+    try {
+        current = submit(std::move(current), len, bufferOffset, rewritingTail);
+    } catch (...) {
+        // What was in the buffer is lost, the caller truncates the file to recover
+        current = allocateBuffer();
+        used = 0;
+        throw;
+    }
+
+    bufferOffset += static_cast<qint64>(used - tail);
+    used = tail;
+    memcpy(current.get(), tailData.data(), tail);
+    padded = padded || tail != 0;
+    rewritingTail = (tail != 0);
+}
+
+void ArchiveFile::sync(const bool finish)
+{
+    checkError();
+    flushBuffer();
+
+    if (finish) {
+        waitForWrites();
+        checkError();
+        if (padded && ftruncate(fd, logicalSize) != 0) {
+            throw ioError(QStringLiteral("Failed to truncate"), name, errno);
+        }
+        padded = false;
+    }
+
+    if (options.durability == Durability::Flush || (options.durability == Durability::Rotation && finish)) {
+        syncFile(finish);
+    }
+
+    if (finish) {
+        waitForWrites();
+        checkError();
+    }
+}
+
+void ArchiveFile::truncate(const qint64 newSize)
+{
+    // Let the buffered data and the writes in flight land before cutting them off
+    try {
+        flushBuffer();
+        waitForWrites();
+    } catch (std::exception& e) {
+        qWarning() << e.what();
+    }
+    error.clear();
+    failedOffset = -1;
+
+    if (ftruncate(fd, newSize) != 0) {
+        throw ioError(QStringLiteral("Failed to truncate"), name, errno);
+    }
+    logicalSize = newSize;
+    completedEnd = newSize;
+    padded = false;
+    rewritingTail = false;
+
+    if (!options.directIo) {
+        bufferOffset = newSize;
+        used = 0;
+        return;
+    }
+
+    // Continue in the middle of the last block
+    bufferOffset = newSize - (newSize % static_cast<qint64>(BLOCK_SIZE));
+    used = static_cast<size_t>(newSize - bufferOffset);
+    if (used && pread(fd, current.get(), BLOCK_SIZE, bufferOffset) < static_cast<ssize_t>(used)) {
+        throw ioError(QStringLiteral("Failed to read back"), name, errno);
+    }
+}
+
+void ArchiveFile::close()
+{
+    if (fd < 0) {
+        return;
+    }
+
+    flushBuffer();
+    waitForWrites();
+    checkError();
+    if (padded && ftruncate(fd, logicalSize) != 0) {
+        throw ioError(QStringLiteral("Failed to truncate"), name, errno);
+    }
+    padded = false;
+
+    const auto result = ::close(fd);
+    fd = -1;
+    if (result != 0) {
+        throw ioError(QStringLiteral("Failed to close"), name, errno);
+    }
+}
@@ -0,0 +1,109 @@
+#ifndef ARCHIVEFILE_HPP
+#define ARCHIVEFILE_HPP
+
+#include <QString>
+
+#include <cstddef>
+#include <cstdlib>
+#include <memory>
+
+// Output file of the archive writer. Writes are collected in block aligned buffers and handed to the kernel with
+// pwrite() or, if built with liburing, io_uring. io_uring writes and syncs are asynchronous, so the writer thread
+// keeps compressing while slow storage (SD cards, NFS) catches up; errors are reported by the next call.
+// With direct I/O (O_DIRECT) the last partial block is written padded with zeros and rewritten by the next write,
+// the padding is cut off when the file is finished.
+// The file is flock()ed until it's closed, ArchiveRetention leaves locked archives alone.
+class ArchiveFile {
+public:
+    enum class Backend {
+        Pwrite,
+        IoUring,
+    };
+
+    enum class Durability {
+        // fdatasync() at every flush interval, fsync() when the file is finished. Survives power loss.
+        Flush,
+        // fsync() only when the file is finished
+        Rotation,
+        // Never waits for the storage, the kernel writes the data back on its own
+        None,
+    };
+
+    struct Options {
+        Backend backend = Backend::Pwrite;
+        Durability durability = Durability::Flush;
+        // Bypass the page cache, falls back to buffered I/O if the file system doesn't support it
+        bool directIo {};
+    };
+
+    // Creates `filename`, which must not exist yet. Falls back to pwrite() if io_uring can't be used.
+    // Throws std::runtime_error on failure.
+    [[nodiscard]] static std::unique_ptr<ArchiveFile> create(const QString& filename, const Options& options);
+    [[nodiscard]] static bool isIoUringAvailable();
+
+    ArchiveFile(const ArchiveFile&) = delete;
+    ArchiveFile(ArchiveFile&&) = delete;
+    ArchiveFile& operator=(const ArchiveFile&) = delete;
+    ArchiveFile& operator=(ArchiveFile&&) = delete;
+    virtual ~ArchiveFile();
+
+    [[nodiscard]] const QString& fileName() const { return name; }
+    // Everything passed to write()
+    [[nodiscard]] qint64 size() const { return logicalSize; }
+    // End of the data known to be in the file, behind size() while writes are in flight or after a write failed
+    [[nodiscard]] qint64 writtenSize() const;
+
+    // These throw std::runtime_error on failure, including the failure of an earlier asynchronous write
+    void write(const char* data, const size_t len);
+    // Hands the buffered data to the kernel and syncs it as the durability option asks.
+    // `finish` is set for the last sync before the file is closed.
+    void sync(const bool finish);
+    // Drops everything after `newSize`, writing continues from there. Clears the error of a failed write.
+    void truncate(const qint64 newSize);
+    void close();
+
+protected:
+    static constexpr size_t BLOCK_SIZE = 4096;
+    static constexpr size_t BUFFER_SIZE = 1024 * 1024;
+
+    struct AlignedFree {
+        void operator()(char* p) const { free(p); } // NOLINT(cppcoreguidelines-no-malloc,cppcoreguidelines-owning-memory)
+    };
+    using Buffer = std::unique_ptr<char, AlignedFree>;
+
+    ArchiveFile(const QString& filename, const int newFd, const Options& newOptions);
+
+    [[nodiscard]] static Buffer allocateBuffer();
+
+    // Writes data[0, len) to `offset` and returns an empty buffer to continue with. `afterPrevious` is set when the
+    // write overlaps an earlier one, which must not be reordered with it.
+    [[nodiscard]] virtual Buffer submit(Buffer buffer, const size_t len, const qint64 offset, const bool afterPrevious) = 0;
+    virtual void waitForWrites() = 0;
+    // fsync() if `metadata`, fdatasync() otherwise
+    virtual void syncFile(const bool metadata) = 0;
+
+    int fd { -1 };
+    QString name;
+    Options options;
+    // End of the writes that have completed, and offset of the first write that failed
+    qint64 completedEnd {};
+    qint64 failedOffset { -1 };
+    // Error of an asynchronous operation, thrown by the next call
+    QString error;
+
+private:
+    Buffer current;
+    size_t used {};
+    // File offset of current[0]
+    qint64 bufferOffset {};
+    qint64 logicalSize {};
+    // The file has been extended beyond logicalSize by a padded direct I/O write
+    bool padded {};
+    // The partial block in `current` has been written before, the next write must not overtake that
+    bool rewritingTail {};
+
+    void checkError();
+    void flushBuffer();
+};
+
+#endif // ARCHIVEFILE_HPP
@@ -0,0 +1,379 @@
+#include "archiveloader.hpp"
+#include "literalsearch.hpp"
+#include "seekableformat.hpp"
+
+#include <QByteArrayView>
+#include <QDebug>
+#include <QMutexLocker>
+#include <QRegularExpression>
+#include <QStringView>
+
+#include <algorithm>
+#include <iterator>
+#include <stdexcept>
+#include <utility>
+
+// Beyond this, a line that spans several frames is not carried over and a match across the frame boundary is missed
+static constexpr qsizetype MAX_CARRY = SeekableFormat::MAX_FRAME_SIZE;
+
+// Finds the search pattern in a block of UTF-8 text and returns the number of '\n' before the match.
+// Case sensitive literals are searched in the raw bytes, everything else is a QRegularExpression on the decoded text.
+class LineMatcher final {
+public:
+    explicit LineMatcher(const ArchiveLoader::Search& search)
+    {
+        if (!search.regex && search.caseSensitive) {
+            literal.emplace(search.pattern.toStdString());
+            return;
+        }
+        auto options = QRegularExpression::MultilineOption;
+        if (!search.caseSensitive) {
+            options |= QRegularExpression::CaseInsensitiveOption;
+        }
+        regex = QRegularExpression(search.regex ? search.pattern : QRegularExpression::escape(search.pattern), options);
+        if (!regex.isValid()) {
+            throw std::runtime_error(QStringLiteral("Invalid regular expression: %1").arg(regex.errorString()).toStdString());
+        }
+        regex.optimize();
+    }
+
+    [[nodiscard]] std::optional<qint64> first(const QByteArray& text) const
+    {
+        if (literal) {
+            const auto pos = literal->find(text.constData(), static_cast<size_t>(text.size()));
+            if (pos == LiteralSearch::NOT_FOUND) {
+                return std::nullopt;
+            }
+            return QByteArrayView(text).first(static_cast<qsizetype>(pos)).count('\n');
+        }
+
+        const auto str = QString::fromUtf8(text);
+        const auto match = regex.match(str);
+        if (!match.hasMatch()) {
+            return std::nullopt;
+        }
+        return QStringView(str).first(match.capturedStart()).count(u'\n');
+    }
+
+    // The last match that starts before `limit`, it may end after it
+    [[nodiscard]] std::optional<qint64> last(const QByteArray& text, const qsizetype limit) const
+    {
+        if (literal) {
+            auto found = LiteralSearch::NOT_FOUND;
+            // NOLINTNEXTLINE(altera-id-dependent-backward-branch)
+            for (auto pos = literal->find(text.constData(), static_cast<size_t>(text.size()));
+                pos < static_cast<size_t>(limit); pos = literal->find(text.constData(), static_cast<size_t>(text.size()), pos + 1)) {
+                found = pos;
+            }
+            if (found == LiteralSearch::NOT_FOUND) {
+                return std::nullopt;
+            }
+            return QByteArrayView(text).first(static_cast<qsizetype>(found)).count('\n');
+        }
+
+        // Split at the limit to know where it is in the decoded text
+        const auto head = QString::fromUtf8(text.first(limit));
+        const auto str = head + QString::fromUtf8(text.sliced(limit));
+        qsizetype found = -1;
+        auto it = regex.globalMatch(str);
+        // NOLINTNEXTLINE(altera-id-dependent-backward-branch)
+        while (it.hasNext()) {
+            const auto start = it.next().capturedStart();
+            if (start >= head.size()) {
+                break;
+            }
+            found = start;
+        }
+        if (found < 0) {
+            return std::nullopt;
+        }
+        return QStringView(str).first(found).count(u'\n');
+    }
+
+private:
+    std::optional<LiteralSearch> literal;
+    QRegularExpression regex;
+};
+
+// Offset of the first byte after `count` '\n'
+[[nodiscard]] static qsizetype skipLines(const QByteArray& data, const qint64 count)
+{
+    qsizetype pos {};
+    // NOLINTNEXTLINE(altera-id-dependent-backward-branch)
+    for (auto remaining = count; remaining > 0 && pos < data.size(); remaining--) {
+        const auto newline = data.indexOf('\n', pos);
+        pos = (newline < 0) ? data.size() : newline + 1;
+    }
+    return pos;
+}
+
+ArchiveLoader::ArchiveLoader(const QString& newFilename, QObject* parent)
+    : QThread(parent)
+    , filename(newFilename)
+{
+}
+
+ArchiveLoader::~ArchiveLoader()
+{
+    {
+        const QMutexLocker locker(&mutex);
+        stopRequested = true;
+        wakeUp.wakeAll();
+    }
+    wait();
+}
+
+std::vector<ArchiveReader::Frame> ArchiveLoader::frames(const size_t first) const
+{
+    const QMutexLocker locker(&mutex);
+    if (first >= frameList.size()) {
+        return {};
+    }
+    return std::vector<ArchiveReader::Frame>(frameList.cbegin() + static_cast<std::ptrdiff_t>(first), frameList.cend());
+}
+
+void ArchiveLoader::requestFrames(const QList<qsizetype>& indices)
+{
+    const QMutexLocker locker(&mutex);
+    frameRequests = indices;
+    wakeUp.wakeAll();
+}
+
+void ArchiveLoader::find(const Search& search)
+{
+    const QMutexLocker locker(&mutex);
+    searchGeneration++;
+    pendingSearch = search;
+    wakeUp.wakeAll();
+}
+
+void ArchiveLoader::cancelFind()
+{
+    const QMutexLocker locker(&mutex);
+    searchGeneration++;
+    pendingSearch.reset();
+}
+
+bool ArchiveLoader::isSearchCancelled(const quint64 generation)
+{
+    const QMutexLocker locker(&mutex);
+    return stopRequested || generation != searchGeneration;
+}
+
+void ArchiveLoader::run()
+{
+    try {
+        reader = std::make_unique<ArchiveReader>(filename, true);
+        // Something to show right away
+        void(reader->scanNext());
+    } catch (std::exception& e) {
+        emit openFailed(QString::fromLocal8Bit(e.what()));
+        return;
+    }
+    {
+        const QMutexLocker locker(&mutex);
+        frameList = reader->frames();
+    }
+    sinceIndexed.start();
+    emit opened(reader->lineCount(), reader->size(), reader->isScanned());
+
+    QMutexLocker locker(&mutex);
+    // NOLINTNEXTLINE(altera-id-dependent-backward-branch)
+    while (!stopRequested) {
+        if (!frameRequests.isEmpty()) {
+            locker.unlock();
+            serveFrameRequests();
+            locker.relock();
+            continue;
+        }
+
+        if (pendingSearch) {
+            const auto search = *std::exchange(pendingSearch, std::nullopt);
+            const auto generation = searchGeneration;
+            locker.unlock();
+            try {
+                const auto matched = search.forward ? searchForward(search, generation) : searchBackward(search, generation);
+                if (!matched && !isSearchCancelled(generation)) {
+                    emit notFound();
+                }
+            } catch (std::exception& e) {
+                emit searchFailed(QString::fromLocal8Bit(e.what()));
+            }
+            locker.relock();
+            continue;
+        }
+
+        if (!reader->isScanned()) {
+            locker.unlock();
+            void(indexNext());
+            locker.relock();
+            continue;
+        }
+
+        wakeUp.wait(&mutex);
+    }
+}
+
+void ArchiveLoader::serveFrameRequests()
+{
+    // NOLINTNEXTLINE(altera-id-dependent-backward-branch)
+    while (true) {
+        qsizetype index {};
+        {
+            const QMutexLocker locker(&mutex);
+            if (stopRequested || frameRequests.isEmpty()) {
+                return;
+            }
+            index = frameRequests.takeFirst();
+        }
+        if (index < 0 || std::cmp_greater_equal(index, reader->frames().size())) {
+            continue;
+        }
+
+        try {
+            emit frameLoaded(index, reader->readFrame(static_cast<size_t>(index)));
+        } catch (std::exception& e) {
+            qWarning() << "Failed to read frame" << index << "of" << filename << e.what();
+            emit frameFailed(index, QString::fromLocal8Bit(e.what()));
+        }
+    }
+}
+
+bool ArchiveLoader::indexNext()
+{
+    // Frames are indexed far faster than the view can take them, they are handed over a few times per second
+    static constexpr qint64 INDEXED_INTERVAL_MS = 200;
+
+    const auto more = reader->scanNext();
+    if (more && !reader->isScanned() && sinceIndexed.elapsed() < INDEXED_INTERVAL_MS) {
+        return true;
+    }
+    sinceIndexed.restart();
+
+    {
+        const QMutexLocker locker(&mutex);
+        const auto& frames = reader->frames();
+        frameList.insert(frameList.cend(), frames.cbegin() + static_cast<std::ptrdiff_t>(frameList.size()), frames.cend());
+    }
+    emit indexed(reader->lineCount(), reader->size(), reader->isScanned());
+    return more;
+}
+
+bool ArchiveLoader::searchForward(const Search& search, const quint64 generation)
+{
+    const auto& frames = reader->frames();
+    if (frames.empty()) {
+        return false;
+    }
+    const LineMatcher matcher(search);
+    const auto fromLine = std::clamp<qint64>(search.fromLine, 0, reader->lineCount());
+    const auto firstFrame = (fromLine == 0) ? 0 : ArchiveReader::frameAtNewline(frames, fromLine);
+
+    // The end of the previous frame's last line, so that a match can span the frame boundary
+    QByteArray carry;
+    auto carryLine = fromLine;
+    int percent = -1;
+    // The search goes on into the part of the archive that isn't indexed yet
+    // NOLINTNEXTLINE(altera-id-dependent-backward-branch)
+    for (auto i = firstFrame; i < frames.size() || indexNext(); i++) {
+        // Scrolling goes first
+        serveFrameRequests();
+        if (isSearchCancelled(generation)) {
+            return false;
+        }
+
+        auto data = reader->readFrame(i);
+        if (i == firstFrame) {
+            data = data.sliced(skipLines(data, fromLine - frames[i].firstLine));
+        }
+        const auto text = carry + data;
+        if (const auto line = matcher.first(text)) {
+            emit found(carryLine + *line);
+            return true;
+        }
+
+        carryLine += text.count('\n');
+        carry = text.sliced(text.lastIndexOf('\n') + 1);
+        if (carry.size() > MAX_CARRY) {
+            carry.clear();
+        }
+
+        if (!reader->isScanned()) {
+            continue;
+        }
+        if (const auto newPercent = static_cast<int>((i - firstFrame + 1) * 100 / (frames.size() - firstFrame)); newPercent != percent) {
+            percent = newPercent;
+            emit searchProgress(percent);
+        }
+    }
+    return false;
+}
+
+bool ArchiveLoader::searchBackward(const Search& search, const quint64 generation)
+{
+    const auto& frames = reader->frames();
+    if (frames.empty()) {
+        return false;
+    }
+    const LineMatcher matcher(search);
+    const auto fromLine = std::clamp<qint64>(search.fromLine, 0, reader->lineCount());
+
+    // Find where the line the search starts with ends, it may continue in the next frames
+    auto startFrame = (fromLine == 0) ? 0 : ArchiveReader::frameAtNewline(frames, fromLine);
+    auto data = reader->readFrame(startFrame);
+    auto lineStart = skipLines(data, fromLine - frames[startFrame].firstLine);
+    if (lineStart == data.size() && startFrame + 1 < frames.size()) {
+        startFrame++;
+        data = reader->readFrame(startFrame);
+        lineStart = 0;
+    }
+    QByteArray text;
+    if (const auto newline = data.indexOf('\n', lineStart); newline >= 0) {
+        text = data.first(newline + 1);
+    } else {
+        text = data;
+        // NOLINTNEXTLINE(altera-id-dependent-backward-branch)
+        for (auto next = startFrame + 1; next < frames.size() && text.size() - data.size() < MAX_CARRY; next++) {
+            const auto nextData = reader->readFrame(next);
+            const auto nextNewline = nextData.indexOf('\n');
+            text += (nextNewline < 0) ? nextData : nextData.first(nextNewline + 1);
+            if (nextNewline >= 0) {
+                break;
+            }
+        }
+    }
+
+    // The start of the following frame's first line, so that a match can span the frame boundary
+    QByteArray headCarry;
+    int percent = -1;
+    // NOLINTNEXTLINE(altera-id-dependent-backward-branch)
+    for (auto i = startFrame + 1; i-- > 0;) {
+        serveFrameRequests();
+        if (isSearchCancelled(generation)) {
+            return false;
+        }
+
+        if (i != startFrame) {
+            data = reader->readFrame(i);
+            text = data + headCarry;
+        }
+        // Matches starting in the carried part were searched with the following frame already
+        const auto limit = (i == startFrame) ? text.size() : data.size();
+        if (const auto line = matcher.last(text, limit)) {
+            emit found(frames[i].firstLine + *line);
+            return true;
+        }
+
+        const auto newline = data.indexOf('\n');
+        headCarry = (newline < 0) ? data + headCarry : data.first(newline + 1);
+        if (headCarry.size() > MAX_CARRY) {
+            headCarry.truncate(MAX_CARRY);
+        }
+
+        if (const auto newPercent = static_cast<int>((startFrame - i + 1) * 100 / (startFrame + 1)); newPercent != percent) {
+            percent = newPercent;
+            emit searchProgress(percent);
+        }
+    }
+    return false;
+}
@@ -0,0 +1,91 @@
+#ifndef ARCHIVELOADER_HPP
+#define ARCHIVELOADER_HPP
+
+#include "archivereader.hpp"
+
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QList>
+#include <QMutex>
+#include <QString>
+#include <QThread>
+#include <QWaitCondition>
+
+#include <memory>
+#include <optional>
+#include <vector>
+
+// Reads an archive for the archive viewer on a worker thread: opens it, decompresses the frames the view asks for and
+// searches it frame by frame. An archive without a seek table is opened as soon as its first frame is indexed, the
+// rest is indexed while the thread has nothing else to do.
+// Frame requests are served between the frames of a search and of the indexing, so scrolling stays responsive.
+class ArchiveLoader final : public QThread {
+    Q_OBJECT
+
+public:
+    struct Search {
+        QString pattern;
+        bool regex {};
+        bool caseSensitive {};
+        // The search starts with this line and includes it
+        qint64 fromLine {};
+        bool forward = true;
+    };
+
+    explicit ArchiveLoader(const QString& newFilename, QObject* parent = nullptr);
+    ArchiveLoader(const ArchiveLoader&) = delete;
+    ArchiveLoader(ArchiveLoader&&) = delete;
+    ArchiveLoader& operator=(const ArchiveLoader&) = delete;
+    ArchiveLoader& operator=(ArchiveLoader&&) = delete;
+    ~ArchiveLoader() override;
+
+    // Valid once opened() has been emitted, the frames from index `first` on
+    [[nodiscard]] std::vector<ArchiveReader::Frame> frames(const size_t first = 0) const;
+
+    // Replaces the frames that are still to be decompressed, the view asks for the ones it's missing on every paint
+    void requestFrames(const QList<qsizetype>& indices);
+    // Replaces the running search
+    void find(const Search& search);
+    void cancelFind();
+
+signals:
+    void opened(qint64 lineCount, qint64 size, bool complete);
+    // More frames were indexed after opened(), complete once the whole archive is
+    void indexed(qint64 lineCount, qint64 size, bool complete);
+    void openFailed(const QString& error);
+    void frameLoaded(qsizetype index, const QByteArray& data);
+    void frameFailed(qsizetype index, const QString& error);
+    void found(qint64 line);
+    void notFound();
+    void searchFailed(const QString& error);
+    void searchProgress(int percent);
+
+protected:
+    void run() override;
+
+private:
+    const QString filename;
+
+    mutable QMutex mutex;
+    QWaitCondition wakeUp;
+    bool stopRequested {};
+    QList<qsizetype> frameRequests;
+    std::optional<Search> pendingSearch;
+    // Incremented by every find() and cancelFind(), a search stops once it changes
+    quint64 searchGeneration {};
+    std::vector<ArchiveReader::Frame> frameList;
+
+    // Only accessed by the worker thread
+    std::unique_ptr<ArchiveReader> reader;
+    QElapsedTimer sinceIndexed;
+
+    void serveFrameRequests();
+    // Indexes the next frame of an archive without a seek table, returns false once all of it is indexed
+    bool indexNext();
+    // Returns true if there was a match, false if there was none or the search was replaced
+    bool searchForward(const Search& search, const quint64 generation);
+    bool searchBackward(const Search& search, const quint64 generation);
+    [[nodiscard]] bool isSearchCancelled(const quint64 generation);
+};
+
+#endif // ARCHIVELOADER_HPP
@@ -0,0 +1,423 @@
+#include "archivereader.hpp"
+#include "seekableformat.hpp"
+#include "zstddictionary.hpp"
+
+#include <QDebug>
+#include <QFileInfo>
+#include <QIODevice>
+
+#include <algorithm>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+
+ArchiveReader::ArchiveReader(const QString& filename, const bool incrementalScan)
+    : file(filename)
+{
+    if (!file.open(QIODevice::ReadOnly)) {
+        throw std::runtime_error(QStringLiteral("Failed to open %1: %2").arg(filename, file.errorString()).toStdString());
+    }
+
+    reading.dctx = ZSTD_createDCtx();
+    if (!reading.dctx) {
+        throw std::runtime_error("Failed to create zstd decompression context");
+    }
+
+    try {
+        seekTable = loadSeekTable();
+        if (!seekTable) {
+            qInfo() << filename << "has no seek table, scanning frames";
+            scanning.dctx = ZSTD_createDCtx();
+            if (!scanning.dctx) {
+                throw std::runtime_error("Failed to create zstd decompression context");
+            }
+            scanned = false;
+            // NOLINTNEXTLINE(altera-id-dependent-backward-branch)
+            while (!incrementalScan && scanNext()) { }
+        }
+    } catch (...) {
+        ZSTD_freeDCtx(scanning.dctx);
+        ZSTD_freeDCtx(reading.dctx);
+        throw;
+    }
+}
+
+ArchiveReader::~ArchiveReader()
+{
+    ZSTD_freeDCtx(scanning.dctx);
+    ZSTD_freeDCtx(reading.dctx);
+}
+
+qint64 ArchiveReader::size() const
+{
+    return frameList.empty() ? 0 : frameList.back().offset + frameList.back().size;
+}
+
+qint64 ArchiveReader::lineCount() const
+{
+    return frameList.empty() ? 0 : frameList.back().firstLine + frameList.back().lineCount;
+}
+
+bool ArchiveReader::loadSeekTable()
+{
+    using namespace SeekableFormat;
+
+    const auto fileSize = file.size();
+    if (fileSize < SKIPPABLE_HEADER_SIZE + SEEK_TABLE_FOOTER_SIZE || !file.seek(fileSize - SEEK_TABLE_FOOTER_SIZE)) {
+        return false;
+    }
+    const auto footer = file.read(SEEK_TABLE_FOOTER_SIZE);
+    if (footer.size() != SEEK_TABLE_FOOTER_SIZE || readLE32(footer.constData() + 5) != SEEKABLE_MAGIC) { // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+        return false;
+    }
+
+    const qint64 frameCount = readLE32(footer.constData());
+    const qint64 entrySize = (static_cast<uint8_t>(footer.at(4)) & CHECKSUM_FLAG) ? 12 : 8;
+    const auto tableSize = SKIPPABLE_HEADER_SIZE + (frameCount * entrySize) + SEEK_TABLE_FOOTER_SIZE;
+    if (tableSize > fileSize || !file.seek(fileSize - tableSize)) {
+        return false;
+    }
+    const auto table = file.read(tableSize);
+    if (table.size() != tableSize || readLE32(table.constData()) != SEEK_TABLE_MAGIC
+        || readLE32(table.constData() + 4) != tableSize - SKIPPABLE_HEADER_SIZE) { // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+        return false;
+    }
+
+    std::vector<Frame> frames;
+    frames.reserve(static_cast<size_t>(frameCount));
+    qint64 compressedOffset {};
+    qint64 offset {};
+    for (qint64 i = 0; i < frameCount; i++) {
+        const auto* const entry = table.constData() + SKIPPABLE_HEADER_SIZE + (i * entrySize); // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+        Frame frame;
+        frame.compressedOffset = compressedOffset;
+        frame.compressedSize = readLE32(entry);
+        frame.offset = offset;
+        frame.size = readLE32(entry + 4); // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+        compressedOffset += frame.compressedSize;
+        offset += frame.size;
+        frames.push_back(frame);
+    }
+    if (compressedOffset > fileSize - tableSize) {
+        qWarning() << "Seek table of" << file.fileName() << "doesn't match the file size";
+        return false;
+    }
+    frameList = std::move(frames);
+
+    // Line index written by yeTTY right before the seek table
+    const auto lineIndexSize = SKIPPABLE_HEADER_SIZE + (frameCount * 4);
+    if (fileSize - tableSize - lineIndexSize >= compressedOffset && file.seek(fileSize - tableSize - lineIndexSize)) {
+        const auto lineIndex = file.read(lineIndexSize);
+        if (lineIndex.size() == lineIndexSize && readLE32(lineIndex.constData()) == LINE_INDEX_MAGIC
+            && readLE32(lineIndex.constData() + 4) == lineIndexSize - SKIPPABLE_HEADER_SIZE) { // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+            qint64 firstLine {};
+            for (size_t i = 0; i < frameList.size(); i++) {
+                frameList[i].firstLine = firstLine;
+                frameList[i].lineCount = readLE32(lineIndex.constData() + SKIPPABLE_HEADER_SIZE + (i * 4)); // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+                firstLine += frameList[i].lineCount;
+            }
+            return true;
+        }
+    }
+
+    // Seekable archive written by another tool, count the lines once
+    qint64 firstLine {};
+    for (size_t i = 0; i < frameList.size(); i++) {
+        const auto data = readFrame(i);
+        frameList[i].firstLine = firstLine;
+        frameList[i].lineCount = data.count('\n');
+        firstLine += frameList[i].lineCount;
+    }
+    return true;
+}
+
+bool ArchiveReader::scanNext()
+{
+    using namespace SeekableFormat;
+
+    // Only the '\n' are counted, the text goes through a small buffer
+    std::vector<char> buffer(ZSTD_DStreamOutSize());
+    // NOLINTNEXTLINE(altera-id-dependent-backward-branch)
+    while (!scanned) {
+        try {
+            if (scanning.frameStart < 0) {
+                if (!file.seek(scanPos)) {
+                    throw std::runtime_error(QStringLiteral("Failed to seek in %1: %2").arg(file.fileName(), file.errorString()).toStdString());
+                }
+                const auto header = file.read(SKIPPABLE_HEADER_SIZE);
+                if (header.size() < 4) {
+                    scanned = true;
+                    break;
+                }
+                if (isSkippableMagic(readLE32(header.constData()))) {
+                    if (header.size() < SKIPPABLE_HEADER_SIZE) {
+                        scanned = true;
+                        break;
+                    }
+                    scanPos += SKIPPABLE_HEADER_SIZE + readLE32(header.constData() + 4); // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+                    continue;
+                }
+                startFrame(scanning, scanPos);
+            }
+
+            Frame frame;
+            frame.compressedOffset = scanning.frameStart;
+            frame.frameOffset = scanning.outputPos;
+            frame.offset = size();
+            frame.firstLine = lineCount();
+            // NOLINTNEXTLINE(altera-id-dependent-backward-branch)
+            while (frame.size < SEGMENT_SIZE) {
+                const auto produced = decompressStream(scanning, buffer.data(), std::min(buffer.size(), static_cast<size_t>(SEGMENT_SIZE - frame.size)));
+                if (produced == 0) {
+                    break;
+                }
+                frame.size += static_cast<qint64>(produced);
+                frame.lineCount += std::count(buffer.cbegin(), buffer.cbegin() + static_cast<std::ptrdiff_t>(produced), '\n');
+            }
+
+            if (scanning.truncated) {
+                // Last frame of an archive that wasn't closed properly, its text up to the cut can still be read
+                qWarning() << "Incomplete last frame in" << file.fileName();
+                scanned = true;
+            } else if (scanning.frameEnded) {
+                const auto frameEnd = scanning.readPos - scanning.input.size() + static_cast<qint64>(scanning.inputPos);
+                if (frame.frameOffset == 0) {
+                    // Small enough to be read at once
+                    frame.compressedSize = frameEnd - frame.compressedOffset;
+                    frame.frameOffset = -1;
+                }
+                scanning.frameStart = -1;
+                scanPos = frameEnd;
+            }
+
+            // Nothing for an empty frame, or a split frame that ended right at a part boundary
+            if (frame.size > 0) {
+                frameList.push_back(frame);
+                return true;
+            }
+        } catch (std::exception& e) {
+            qWarning() << "Ignoring the rest of" << file.fileName() << "from offset" << scanPos << e.what();
+            scanned = true;
+        }
+    }
+    return false;
+}
+
+void ArchiveReader::useDictionaryFor(FrameStream& stream, const char* frame, const size_t size)
+{
+    const auto id = ZSTD_getDictID_fromFrame(frame, size);
+    if (id == stream.dictionaryId) {
+        return;
+    }
+
+    QByteArray dictionary;
+    if (id != 0) {
+        dictionary = ZstdDictionary::loadById(QFileInfo(file).absolutePath(), id);
+        if (dictionary.isEmpty()) {
+            throw std::runtime_error(QStringLiteral("Dictionary %1 needed by %2 not found").arg(id).arg(file.fileName()).toStdString());
+        }
+    }
+
+    // An empty dictionary unloads the previous one
+    if (const auto result = ZSTD_DCtx_loadDictionary(stream.dctx, dictionary.constData(), static_cast<size_t>(dictionary.size()));
+        ZSTD_isError(result)) {
+        throw std::runtime_error(std::string("Failed to load dictionary: ") + ZSTD_getErrorName(result));
+    }
+    stream.dictionaryId = id;
+}
+
+void ArchiveReader::startFrame(FrameStream& stream, const qint64 compressedOffset)
+{
+    // The frame may already be in the block read for the previous one
+    const auto inputStart = stream.readPos - stream.input.size();
+    if (compressedOffset >= inputStart && compressedOffset < stream.readPos) {
+        stream.inputPos = static_cast<size_t>(compressedOffset - inputStart);
+    } else {
+        stream.input.clear();
+        stream.inputPos = 0;
+        stream.readPos = compressedOffset;
+    }
+    stream.frameStart = -1;
+    stream.outputPos = 0;
+    stream.frameEnded = false;
+    stream.truncated = false;
+
+    if (!file.seek(compressedOffset)) {
+        throw std::runtime_error(QStringLiteral("Failed to seek in %1: %2").arg(file.fileName(), file.errorString()).toStdString());
+    }
+    const auto header = file.read(SeekableFormat::MAX_FRAME_HEADER_SIZE);
+    useDictionaryFor(stream, header.constData(), static_cast<size_t>(header.size()));
+    void(ZSTD_DCtx_reset(stream.dctx, ZSTD_reset_session_only));
+    stream.frameStart = compressedOffset;
+}
+
+size_t ArchiveReader::decompressStream(FrameStream& stream, char* out, const size_t capacity)
+{
+    ZSTD_outBuffer output = { out, capacity, 0 };
+    // NOLINTNEXTLINE(altera-id-dependent-backward-branch)
+    while (output.pos < output.size && !stream.frameEnded && !stream.truncated) {
+        if (stream.inputPos == static_cast<size_t>(stream.input.size())) {
+            if (!file.seek(stream.readPos)) {
+                throw std::runtime_error(QStringLiteral("Failed to seek in %1: %2").arg(file.fileName(), file.errorString()).toStdString());
+            }
+            stream.input = file.read(static_cast<qint64>(ZSTD_DStreamInSize()));
+            stream.inputPos = 0;
+            stream.readPos += stream.input.size();
+            if (stream.input.isEmpty()) {
+                stream.truncated = true;
+                break;
+            }
+        }
+
+        ZSTD_inBuffer input = { stream.input.constData(), static_cast<size_t>(stream.input.size()), stream.inputPos };
+        const auto result = ZSTD_decompressStream(stream.dctx, &output, &input);
+        stream.inputPos = input.pos;
+        if (ZSTD_isError(result)) {
+            stream.frameStart = -1;
+            throw std::runtime_error(QStringLiteral("Failed to decompress %1: %2").arg(file.fileName(), ZSTD_getErrorName(result)).toStdString());
+        }
+        stream.frameEnded = (result == 0);
+    }
+    stream.outputPos += static_cast<qint64>(output.pos);
+    return output.pos;
+}
+
+QByteArray ArchiveReader::decompress(const char* frame, const size_t size, const qint64 expectedSize)
+{
+    useDictionaryFor(reading, frame, size);
+    void(ZSTD_DCtx_reset(reading.dctx, ZSTD_reset_session_only));
+    // The context no longer holds the position in a split frame
+    reading.frameStart = -1;
+
+    QByteArray out;
+    out.reserve(expectedSize > 0 ? expectedSize : static_cast<qsizetype>(ZSTD_DStreamOutSize()));
+
+    ZSTD_inBuffer input = { frame, size, 0 };
+    size_t result = 1;
+    // NOLINTNEXTLINE(altera-id-dependent-backward-branch)
+    while (result != 0) {
+        const auto used = out.size();
+        out.resize(std::max(out.capacity(), used + static_cast<qsizetype>(ZSTD_DStreamOutSize())));
+        ZSTD_outBuffer output = { out.data() + used, static_cast<size_t>(out.size() - used), 0 }; // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+        result = ZSTD_decompressStream(reading.dctx, &output, &input);
+        out.resize(used + static_cast<qsizetype>(output.pos));
+        if (ZSTD_isError(result)) {
+            throw std::runtime_error(QStringLiteral("Failed to decompress %1: %2").arg(file.fileName(), ZSTD_getErrorName(result)).toStdString());
+        }
+        if (result != 0 && input.pos == input.size && output.pos < output.size) {
+            throw std::runtime_error(QStringLiteral("Truncated frame in %1").arg(file.fileName()).toStdString());
+        }
+    }
+
+    return out;
+}
+
+QByteArray ArchiveReader::readFrame(const size_t index)
+{
+    const auto& frame = frameList.at(index);
+    if (frame.frameOffset >= 0) {
+        return readPart(frame);
+    }
+    if (!file.seek(frame.compressedOffset)) {
+        throw std::runtime_error(QStringLiteral("Failed to seek in %1: %2").arg(file.fileName(), file.errorString()).toStdString());
+    }
+    const auto compressed = file.read(frame.compressedSize);
+    if (compressed.size() != frame.compressedSize) {
+        throw std::runtime_error(QStringLiteral("Failed to read %1: %2").arg(file.fileName(), file.errorString()).toStdString());
+    }
+
+    auto data = decompress(compressed.constData(), static_cast<size_t>(compressed.size()), frame.size);
+    if (data.size() != frame.size) {
+        throw std::runtime_error(QStringLiteral("Frame %1 of %2 has unexpected size").arg(index).arg(file.fileName()).toStdString());
+    }
+    return data;
+}
+
+QByteArray ArchiveReader::readPart(const Frame& frame)
+{
+    // Parts are usually read in order, going back means decompressing the frame from its start again
+    if (reading.frameStart != frame.compressedOffset || reading.outputPos > frame.frameOffset) {
+        startFrame(reading, frame.compressedOffset);
+    }
+
+    std::vector<char> skipped(ZSTD_DStreamOutSize());
+    // NOLINTNEXTLINE(altera-id-dependent-backward-branch)
+    while (reading.outputPos < frame.frameOffset) {
+        if (decompressStream(reading, skipped.data(), std::min(skipped.size(), static_cast<size_t>(frame.frameOffset - reading.outputPos))) == 0) {
+            break;
+        }
+    }
+
+    QByteArray data(frame.size, Qt::Uninitialized);
+    qsizetype used {};
+    // NOLINTNEXTLINE(altera-id-dependent-backward-branch)
+    while (reading.outputPos == frame.frameOffset + used && used < data.size()) {
+        used += static_cast<qsizetype>(decompressStream(reading, data.data() + used, static_cast<size_t>(data.size() - used))); // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+        if (reading.frameEnded || reading.truncated) {
+            break;
+        }
+    }
+    if (used != frame.size) {
+        reading.frameStart = -1;
+        throw std::runtime_error(QStringLiteral("Part of %1 at offset %2 has unexpected size").arg(file.fileName()).arg(frame.offset).toStdString());
+    }
+    return data;
+}
+
+QByteArray ArchiveReader::readBytes(const qint64 offset, const qint64 length)
+{
+    const auto end = std::min(offset + length, size());
+    if (offset < 0 || offset >= end) {
+        return {};
+    }
+
+    const auto first = frameAtOffset(offset);
+    const auto last = frameAtOffset(end - 1);
+    QByteArray data;
+    for (auto i = first; i <= last; i++) {
+        data.append(readFrame(i));
+    }
+    return data.mid(offset - frameList[first].offset, end - offset);
+}
+
+QByteArray ArchiveReader::readLines(const qint64 firstLine, const qint64 count)
+{
+    if (frameList.empty() || firstLine < 0 || count <= 0 || firstLine > lineCount()) {
+        return {};
+    }
+
+    // Line n starts after the n-th '\n'
+    const auto first = (firstLine == 0) ? 0 : frameAtNewline(frameList, firstLine);
+    const auto last = (firstLine + count >= lineCount()) ? frameList.size() - 1 : frameAtNewline(frameList, firstLine + count);
+
+    QByteArray data;
+    for (auto i = first; i <= last; i++) {
+        data.append(readFrame(i));
+    }
+
+    qsizetype start {};
+    for (auto skip = firstLine - frameList[first].firstLine; skip > 0; skip--) {
+        start = data.indexOf('\n', start) + 1;
+    }
+    auto end = start;
+    for (auto remaining = count; remaining > 0 && end < data.size(); remaining--) {
+        const auto newline = data.indexOf('\n', end);
+        end = (newline < 0) ? data.size() : newline + 1;
+    }
+
+    return data.mid(start, end - start);
+}
+
+size_t ArchiveReader::frameAtOffset(const qint64 offset) const
+{
+    const auto it = std::upper_bound(frameList.cbegin(), frameList.cend(), offset,
+        [](const qint64 value, const Frame& frame) { return value < frame.offset; });
+    return static_cast<size_t>(std::distance(frameList.cbegin(), it)) - 1;
+}
+
+size_t ArchiveReader::frameAtNewline(const std::vector<Frame>& frames, const qint64 newline)
+{
+    const auto it = std::lower_bound(frames.cbegin(), frames.cend(), newline,
+        [](const Frame& frame, const qint64 value) { return frame.firstLine + frame.lineCount < value; });
+    return static_cast<size_t>(std::distance(frames.cbegin(), it));
+}
@@ -0,0 +1,107 @@
+#ifndef ARCHIVEREADER_HPP
+#define ARCHIVEREADER_HPP
+
+#include "seekableformat.hpp"
+
+#include <QByteArray>
+#include <QFile>
+#include <QString>
+
+#include <cstddef>
+#include <vector>
+#include <zstd.h>
+
+// Random access to the long term run mode archives (see seekableformat.hpp).
+// Only the frames covering the requested range are read and decompressed. Archives without a seek table
+// (e.g. after a crash, or written as one large frame by older versions) are indexed by streaming through them once
+// with bounded reads, either when opened or step by step with scanNext(). Frames larger than SEGMENT_SIZE are
+// indexed as several entries at fixed decompressed offsets, so no more than SEGMENT_SIZE is ever held at once.
+// Frames compressed with a dictionary are decoded with the matching .zdict file from the archive's directory.
+class ArchiveReader final {
+public:
+    // Size of the entries a large frame is split into
+    static constexpr qint64 SEGMENT_SIZE = SeekableFormat::MAX_FRAME_SIZE;
+
+    struct Frame {
+        qint64 compressedOffset {};
+        // 0 for a part of a split frame
+        qint64 compressedSize {};
+        // Offset of the part in the decompressed frame, -1 if the entry is the whole frame
+        qint64 frameOffset = -1;
+        // Offset of the frame's first byte in the decompressed text
+        qint64 offset {};
+        qint64 size {};
+        // Number of '\n' before the frame and in it
+        qint64 firstLine {};
+        qint64 lineCount {};
+    };
+
+    // Throws std::runtime_error if the file can't be read.
+    // With incrementalScan, an archive without a seek table is only indexed as far as scanNext() has been called.
+    explicit ArchiveReader(const QString& filename, const bool incrementalScan = false);
+    ArchiveReader(const ArchiveReader&) = delete;
+    ArchiveReader(ArchiveReader&&) = delete;
+    ArchiveReader& operator=(const ArchiveReader&) = delete;
+    ArchiveReader& operator=(ArchiveReader&&) = delete;
+    ~ArchiveReader();
+
+    [[nodiscard]] const std::vector<Frame>& frames() const { return frameList; }
+    [[nodiscard]] bool hasSeekTable() const { return seekTable; }
+    // Whether frames() covers the whole archive
+    [[nodiscard]] bool isScanned() const { return scanned; }
+    // Indexes the next entry, returns false once the whole archive is indexed.
+    // A damaged or incomplete end of the archive is left out with a warning.
+    bool scanNext();
+    // Decompressed size
+    [[nodiscard]] qint64 size() const;
+    // Number of '\n', a last line without one is not counted but is returned by readLines()
+    [[nodiscard]] qint64 lineCount() const;
+
+    [[nodiscard]] QByteArray readFrame(const size_t index);
+    [[nodiscard]] QByteArray readBytes(const qint64 offset, const qint64 length);
+    // Lines [firstLine, firstLine + count) including their '\n'
+    [[nodiscard]] QByteArray readLines(const qint64 firstLine, const qint64 count);
+
+    // Index of the frame containing the n-th '\n' (1 based, at most the line count), the line n starts right after it
+    [[nodiscard]] static size_t frameAtNewline(const std::vector<Frame>& frames, const qint64 newline);
+
+private:
+    // Streaming decompression of one frame, reading the file in blocks of ZSTD_DStreamInSize()
+    struct FrameStream {
+        ZSTD_DCtx* dctx {};
+        unsigned dictionaryId {};
+        // Compressed offset of the frame, -1 if there is none
+        qint64 frameStart = -1;
+        // File offset of the end of `input`
+        qint64 readPos {};
+        QByteArray input;
+        size_t inputPos {};
+        // Decompressed bytes of the frame produced so far
+        qint64 outputPos {};
+        bool frameEnded {};
+        bool truncated {};
+    };
+
+    QFile file;
+    // Reads the frames, whole or from the start to the requested part of a split frame
+    FrameStream reading;
+    FrameStream scanning;
+    std::vector<Frame> frameList;
+    bool seekTable {};
+    bool scanned = true;
+    // Compressed offset of the next frame to scan
+    qint64 scanPos {};
+
+    bool loadSeekTable();
+    void useDictionaryFor(FrameStream& stream, const char* frame, const size_t size);
+    void startFrame(FrameStream& stream, const qint64 compressedOffset);
+    // Decompresses up to `capacity` bytes, less only at the end of the frame or file
+    [[nodiscard]] size_t decompressStream(FrameStream& stream, char* out, const size_t capacity);
+    // Decompresses one frame
+    [[nodiscard]] QByteArray decompress(const char* frame, const size_t size, const qint64 expectedSize = 0);
+    [[nodiscard]] QByteArray readPart(const Frame& frame);
+    // Index of the frame containing the given decompressed offset
+    [[nodiscard]] size_t frameAtOffset(const qint64 offset) const;
+};
+
+#endif // ARCHIVEREADER_HPP
@@ -0,0 +1,322 @@
+#include "archiveretention.hpp"
+#include "archivereader.hpp"
+#include "seekableformat.hpp"
+#include "timeindex.hpp"
+#include "trigramfilter.hpp"
+#include "zstddictionary.hpp"
+
+#include <QDateTime>
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QIODevice>
+#include <QMutexLocker>
+
+#include <algorithm>
+#include <cstdio>
+#include <fcntl.h>
+#include <stdexcept>
+#include <string>
+#include <sys/file.h>
+#include <unistd.h>
+
+static QString tempFilenameFor(const QString& archive)
+{
+    return archive + QStringLiteral(".recompress");
+}
+
+static void validateZstdResult(const size_t result)
+{
+    if (ZSTD_isError(result)) {
+        throw std::runtime_error(std::string("ZSTD error: ") + ZSTD_getErrorName(result));
+    }
+}
+
+ArchiveRetention::ArchiveRetention(QObject* parent)
+    : QThread(parent)
+{
+}
+
+ArchiveRetention::~ArchiveRetention()
+{
+    close();
+    ZSTD_freeCCtx(zstdCtx);
+    zstdCtx = nullptr;
+}
+
+void ArchiveRetention::open(const QString& newDirectory, const Policy& newPolicy)
+{
+    close();
+
+    if (!newPolicy.quotaBytes && !newPolicy.maxAgeMs && !newPolicy.recompress) {
+        return;
+    }
+    directory = newDirectory;
+    policy = newPolicy;
+    done.clear();
+    {
+        const QMutexLocker locker(&mutex);
+        stopRequested = false;
+        passRequested = false;
+    }
+
+    start(QThread::IdlePriority);
+}
+
+void ArchiveRetention::close()
+{
+    {
+        const QMutexLocker locker(&mutex);
+        stopRequested = true;
+        wakeUp.wakeAll();
+    }
+    wait();
+}
+
+void ArchiveRetention::schedule()
+{
+    const QMutexLocker locker(&mutex);
+    passRequested = true;
+    wakeUp.wakeAll();
+}
+
+void ArchiveRetention::noteActivity()
+{
+    lastActivityMs.store(QDateTime::currentMSecsSinceEpoch(), std::memory_order_relaxed);
+}
+
+bool ArchiveRetention::isIdle() const
+{
+    return QDateTime::currentMSecsSinceEpoch() - lastActivityMs.load(std::memory_order_relaxed) >= IDLE_MS;
+}
+
+bool ArchiveRetention::isStopRequested()
+{
+    const QMutexLocker locker(&mutex);
+    return stopRequested;
+}
+
+void ArchiveRetention::run()
+{
+    // Left behind if yeTTY was stopped while recompressing
+    const QDir dir(directory);
+    for (const auto& temp : dir.entryList({ tempFilenameFor(QStringLiteral("*.txt.zst")) }, QDir::Files)) {
+        QFile::remove(dir.filePath(temp));
+    }
+
+    QMutexLocker locker(&mutex);
+
+    // NOLINTNEXTLINE(altera-id-dependent-backward-branch)
+    while (!stopRequested) {
+        passRequested = false;
+        locker.unlock();
+
+        bool more {};
+        try {
+            prune();
+            more = policy.recompress && isIdle() && recompressNext();
+        } catch (std::exception& e) {
+            qWarning() << "Archive retention:" << e.what();
+        }
+
+        locker.relock();
+        if (!more && !stopRequested && !passRequested) {
+            wakeUp.wait(&mutex, CHECK_INTERVAL_MS);
+        }
+    }
+}
+
+std::vector<ArchiveRetention::Archive> ArchiveRetention::listArchives() const
+{
+    std::vector<Archive> archives;
+    const QDir dir(directory);
+    const auto entries = dir.entryInfoList({ QStringLiteral("*.txt.zst") }, QDir::Files, QDir::Time | QDir::Reversed);
+    archives.reserve(static_cast<size_t>(entries.size()));
+    for (const auto& info : entries) {
+        const auto filename = info.absoluteFilePath();
+        const auto size = info.size() + QFileInfo(TimeIndex::filenameFor(filename)).size() + QFileInfo(TrigramFilter::filenameFor(filename)).size();
+        archives.push_back({ filename, size, info.lastModified().toMSecsSinceEpoch() });
+    }
+    return archives;
+}
+
+bool ArchiveRetention::isInUse(const Archive& archive)
+{
+    const auto fd = ::open(QFile::encodeName(archive.filename).constData(), O_RDONLY | O_CLOEXEC); // NOLINT(cppcoreguidelines-pro-type-vararg)
+    if (fd < 0) {
+        return true;
+    }
+    // A writer never reopens an archive it has finished, so the lock doesn't have to be held after this
+    const auto locked = flock(fd, LOCK_EX | LOCK_NB) != 0;
+    ::close(fd);
+    // Also an archive that has just been created and isn't locked yet
+    return locked || archive.size == 0;
+}
+
+void ArchiveRetention::prune()
+{
+    const auto archives = listArchives();
+    qint64 total {};
+    for (const auto& archive : archives) {
+        total += archive.size;
+    }
+
+    const auto now = QDateTime::currentMSecsSinceEpoch();
+    for (const auto& archive : archives) {
+        const auto expired = policy.maxAgeMs && now - archive.modifiedMs > policy.maxAgeMs;
+        const auto overQuota = policy.quotaBytes && total > policy.quotaBytes;
+        if (!expired && !overQuota) {
+            break;
+        }
+        if (isInUse(archive)) {
+            continue;
+        }
+        removeArchive(archive);
+        total -= archive.size;
+    }
+}
+
+void ArchiveRetention::removeArchive(const Archive& archive)
+{
+    if (!QFile::remove(archive.filename)) {
+        qWarning() << "Failed to remove" << archive.filename;
+        return;
+    }
+    QFile::remove(TimeIndex::filenameFor(archive.filename));
+    QFile::remove(TrigramFilter::filenameFor(archive.filename));
+    done.remove(archive.filename);
+    qInfo() << "Pruned" << archive.filename << archive.size << "bytes";
+    emit archivePruned(archive.filename, archive.size);
+}
+
+bool ArchiveRetention::recompressNext()
+{
+    const auto archives = listArchives();
+
+    // Newest first, the oldest ones are the next to be pruned
+    // NOLINTNEXTLINE(altera-id-dependent-backward-branch)
+    for (auto it = archives.rbegin(); it != archives.rend(); it++) {
+        if (done.contains(it->filename) || isInUse(*it)) {
+            continue;
+        }
+
+        Result result {};
+        try {
+            result = recompress(it->filename);
+        } catch (std::exception& e) {
+            qWarning() << "Failed to recompress" << it->filename << e.what();
+            QFile::remove(tempFilenameFor(it->filename));
+            done.insert(it->filename);
+            continue;
+        }
+        if (result == Result::Interrupted) {
+            return false;
+        }
+        if (result == Result::Recompressed) {
+            return true;
+        }
+    }
+    return false;
+}
+
+ArchiveRetention::Result ArchiveRetention::recompress(const QString& filename)
+{
+    // Not scanned if it has no seek table, it's skipped anyway
+    ArchiveReader reader(filename, true);
+    // Cut off by a crash, or still being created when it was checked; it's looked at again in the next pass
+    if (!reader.hasSeekTable()) {
+        return Result::Skipped;
+    }
+    const auto& frames = reader.frames();
+    if (frames.empty()) {
+        done.insert(filename);
+        return Result::Skipped;
+    }
+
+    QFile input(filename);
+    if (!input.open(QIODevice::ReadOnly)) {
+        throw std::runtime_error(input.errorString().toStdString());
+    }
+    const auto firstHeader = input.read(SeekableFormat::MAX_FRAME_HEADER_SIZE);
+    if (ZSTD_getFrameContentSize(firstHeader.constData(), static_cast<size_t>(firstHeader.size())) != ZSTD_CONTENTSIZE_UNKNOWN) {
+        done.insert(filename);
+        return Result::Skipped;
+    }
+
+    if (!zstdCtx) {
+        zstdCtx = ZSTD_createCCtx();
+        if (!zstdCtx) {
+            throw std::runtime_error("Failed to create zstd context");
+        }
+    }
+    validateZstdResult(ZSTD_CCtx_reset(zstdCtx, ZSTD_reset_session_and_parameters));
+    validateZstdResult(ZSTD_CCtx_setParameter(zstdCtx, ZSTD_c_compressionLevel, policy.recompressLevel));
+
+    QFile output(tempFilenameFor(filename));
+    if (!output.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        throw std::runtime_error(QStringLiteral("Failed to open %1: %2").arg(output.fileName(), output.errorString()).toStdString());
+    }
+
+    std::vector<SeekableFormat::FrameEntry> entries;
+    entries.reserve(frames.size());
+    std::vector<char> compressed;
+    unsigned dictionaryId {};
+    QByteArray dictionary;
+    for (size_t i = 0; i < frames.size(); i++) {
+        // Give the CPU and the disk back to the capture, this file is started over next time
+        if (!isIdle() || isStopRequested()) {
+            output.remove();
+            return Result::Interrupted;
+        }
+
+        // The frames keep the dictionary they were compressed with
+        if (!input.seek(frames[i].compressedOffset)) {
+            throw std::runtime_error(input.errorString().toStdString());
+        }
+        const auto header = input.read(std::min(frames[i].compressedSize, SeekableFormat::MAX_FRAME_HEADER_SIZE));
+        if (const auto id = ZSTD_getDictID_fromFrame(header.constData(), static_cast<size_t>(header.size())); id != dictionaryId) {
+            dictionary = id ? ZstdDictionary::loadById(QFileInfo(filename).absolutePath(), id) : QByteArray();
+            if (id && dictionary.isEmpty()) {
+                throw std::runtime_error(QStringLiteral("Dictionary %1 not found").arg(id).toStdString());
+            }
+            validateZstdResult(ZSTD_CCtx_loadDictionary(zstdCtx, dictionary.constData(), static_cast<size_t>(dictionary.size())));
+            dictionaryId = id;
+        }
+
+        const auto data = reader.readFrame(i);
+        compressed.resize(ZSTD_compressBound(static_cast<size_t>(data.size())));
+        const auto size = ZSTD_compress2(zstdCtx, compressed.data(), compressed.size(), data.constData(), static_cast<size_t>(data.size()));
+        validateZstdResult(size);
+        if (output.write(compressed.data(), static_cast<qint64>(size)) != static_cast<qint64>(size)) {
+            throw std::runtime_error(QStringLiteral("Failed to write %1: %2").arg(output.fileName(), output.errorString()).toStdString());
+        }
+        entries.push_back({ static_cast<uint32_t>(size), static_cast<uint32_t>(data.size()), static_cast<uint32_t>(frames[i].lineCount) });
+    }
+
+    const auto index = SeekableFormat::serializeIndex(entries);
+    // Keeps the modification time, pruning goes by it
+    const auto modified = QFileInfo(input).lastModified();
+    if (output.write(index) != index.size() || !output.flush() || fsync(output.handle()) != 0
+        || !output.setFileTime(modified, QFileDevice::FileModificationTime)) {
+        throw std::runtime_error(QStringLiteral("Failed to write %1: %2").arg(output.fileName(), output.errorString()).toStdString());
+    }
+    const auto sizeBefore = input.size();
+    const auto sizeAfter = output.size();
+    output.close();
+
+    done.insert(filename);
+    if (sizeAfter >= sizeBefore) {
+        output.remove();
+        return Result::Skipped;
+    }
+    // Readers that have the file open keep reading the old one
+    if (std::rename(QFile::encodeName(output.fileName()).constData(), QFile::encodeName(filename).constData()) != 0) {
+        output.remove();
+        throw std::runtime_error("Failed to replace the archive");
+    }
+
+    qInfo() << "Recompressed" << filename << "from" << sizeBefore << "to" << sizeAfter << "bytes";
+    emit archiveRecompressed(filename, sizeBefore, sizeAfter);
+    return Result::Recompressed;
+}
@@ -0,0 +1,97 @@
+#ifndef ARCHIVERETENTION_HPP
+#define ARCHIVERETENTION_HPP
+
+#include <QMutex>
+#include <QSet>
+#include <QString>
+#include <QThread>
+#include <QWaitCondition>
+
+#include <atomic>
+#include <vector>
+#include <zstd.h>
+
+// Keeps the long term run mode archives in a directory within a disk budget, on a low priority thread.
+// The oldest archives are deleted together with their sidecar files once the archives exceed the quota or the maximum
+// age. While nothing is being captured, finished archives are recompressed at a high level. The frame boundaries are
+// kept, so the line index, the time index and the trigram filter stay valid. Recompressed frames have their content
+// size in the frame header while the frames streamed during the capture don't, which marks an archive as done.
+class ArchiveRetention final : public QThread {
+    Q_OBJECT
+
+public:
+    struct Policy {
+        // 0 disables the limit
+        qint64 quotaBytes {};
+        qint64 maxAgeMs {};
+        bool recompress {};
+        int recompressLevel = 19;
+    };
+
+    explicit ArchiveRetention(QObject* parent = nullptr);
+    ArchiveRetention(const ArchiveRetention&) = delete;
+    ArchiveRetention(ArchiveRetention&&) = delete;
+    ArchiveRetention& operator=(const ArchiveRetention&) = delete;
+    ArchiveRetention& operator=(ArchiveRetention&&) = delete;
+    ~ArchiveRetention() override;
+
+    // Starts the thread for the archives in `newDirectory`, does nothing if the policy has nothing to do.
+    void open(const QString& newDirectory, const Policy& newPolicy);
+    void close();
+    // Runs a pass now instead of at the next check interval, e.g. after a file has been finished
+    void schedule();
+    // Called for every captured chunk, recompression only runs once the capture has been idle for IDLE_MS
+    void noteActivity();
+
+signals:
+    void archivePruned(const QString& filename, qint64 size);
+    void archiveRecompressed(const QString& filename, qint64 sizeBefore, qint64 sizeAfter);
+
+protected:
+    void run() override;
+
+private:
+    static constexpr unsigned long CHECK_INTERVAL_MS = 30 * 1000;
+    static constexpr qint64 IDLE_MS = 10 * 1000;
+
+    struct Archive {
+        QString filename;
+        // Including the sidecar files
+        qint64 size {};
+        qint64 modifiedMs {};
+    };
+
+    enum class Result {
+        Recompressed,
+        Skipped,
+        Interrupted,
+    };
+
+    QMutex mutex;
+    QWaitCondition wakeUp;
+    bool stopRequested {};
+    bool passRequested {};
+    std::atomic<qint64> lastActivityMs {};
+
+    // Only accessed by the retention thread while it is running
+    QString directory;
+    Policy policy;
+    ZSTD_CCtx* zstdCtx {};
+    // Archives that are recompressed already or can't be
+    QSet<QString> done;
+
+    // Oldest first
+    [[nodiscard]] std::vector<Archive> listArchives() const;
+    // Archives that may still be written to, by any port or instance writing to the directory: their ArchiveFile
+    // holds a flock() on them
+    [[nodiscard]] static bool isInUse(const Archive& archive);
+    void prune();
+    void removeArchive(const Archive& archive);
+    // Returns true if an archive has been recompressed and there might be more
+    bool recompressNext();
+    Result recompress(const QString& filename);
+    [[nodiscard]] bool isIdle() const;
+    [[nodiscard]] bool isStopRequested();
+};
+
+#endif // ARCHIVERETENTION_HPP
@@ -0,0 +1,309 @@
+#include "archiveview.hpp"
+
+#include <QApplication>
+#include <QClipboard>
+#include <QFontDatabase>
+#include <QKeyEvent>
+#include <QMouseEvent>
+#include <QPaintEvent>
+#include <QPainter>
+#include <QScrollBar>
+
+#include <algorithm>
+#include <climits>
+#include <utility>
+
+// Space between the line numbers and the text
+static constexpr int MARGIN = 4;
+
+ArchiveView::ArchiveView(QWidget* parent)
+    : QAbstractScrollArea(parent)
+{
+    setFont(QFontDatabase::systemFont(QFontDatabase::FixedFont));
+    setFocusPolicy(Qt::StrongFocus);
+    viewport()->setCursor(Qt::IBeamCursor);
+}
+
+void ArchiveView::setFrames(std::vector<ArchiveReader::Frame> newFrames)
+{
+    frames = std::move(newFrames);
+    cache.clear();
+    failedFrames.clear();
+    selectedLine = -1;
+    widestLine = 0;
+    updateScrollBars();
+    verticalScrollBar()->setValue(0);
+    horizontalScrollBar()->setValue(0);
+    viewport()->update();
+}
+
+void ArchiveView::appendFrames(const std::vector<ArchiveReader::Frame>& newFrames)
+{
+    if (newFrames.empty()) {
+        return;
+    }
+    frames.insert(frames.cend(), newFrames.cbegin(), newFrames.cend());
+    updateScrollBars();
+    viewport()->update();
+}
+
+void ArchiveView::addFrame(const qsizetype index, const QByteArray& data)
+{
+    if (index < 0 || std::cmp_greater_equal(index, frames.size())) {
+        return;
+    }
+
+    // NOLINTNEXTLINE(altera-id-dependent-backward-branch)
+    while (cache.size() >= MAX_CACHED_FRAMES) {
+        const auto oldest = std::min_element(cache.cbegin(), cache.cend(),
+            [](const CachedFrame& a, const CachedFrame& b) { return a.lastUse < b.lastUse; });
+        cache.erase(oldest);
+    }
+
+    CachedFrame frame { data, {}, ++useCounter };
+    frame.newlines.reserve(static_cast<size_t>(frames[static_cast<size_t>(index)].lineCount));
+    // NOLINTNEXTLINE(altera-id-dependent-backward-branch)
+    for (auto pos = data.indexOf('\n'); pos >= 0; pos = data.indexOf('\n', pos + 1)) {
+        frame.newlines.push_back(pos);
+    }
+    cache.insert(index, std::move(frame));
+    failedFrames.remove(index);
+    viewport()->update();
+}
+
+void ArchiveView::setFrameFailed(const qsizetype index)
+{
+    failedFrames.insert(index);
+    viewport()->update();
+}
+
+qint64 ArchiveView::lineCount() const
+{
+    // Including the line after the last '\n'
+    return frames.empty() ? 0 : frames.back().firstLine + frames.back().lineCount + 1;
+}
+
+void ArchiveView::showLine(const qint64 line)
+{
+    if (frames.empty()) {
+        return;
+    }
+    selectLine(std::clamp<qint64>(line, 0, lineCount() - 1));
+
+    // Centered, with some context around it
+    const auto first = static_cast<qint64>(verticalScrollBar()->value());
+    if (selectedLine < first || selectedLine >= first + visibleLines()) {
+        verticalScrollBar()->setValue(static_cast<int>(std::min<qint64>(selectedLine - (visibleLines() / 2), INT_MAX)));
+    }
+}
+
+void ArchiveView::selectLine(const qint64 line)
+{
+    if (line == selectedLine) {
+        return;
+    }
+    selectedLine = line;
+    emit currentLineChanged(selectedLine);
+    viewport()->update();
+}
+
+ArchiveView::CachedFrame* ArchiveView::cachedFrame(const qsizetype index, QList<qsizetype>& missing)
+{
+    const auto it = cache.find(index);
+    if (it == cache.end()) {
+        if (!missing.contains(index)) {
+            missing.append(index);
+        }
+        return nullptr;
+    }
+    it->lastUse = ++useCounter;
+    return &*it;
+}
+
+std::optional<QString> ArchiveView::lineText(const qint64 line, QList<qsizetype>& missing)
+{
+    // Line n starts after the n-th '\n'
+    auto index = (line == 0) ? 0 : ArchiveReader::frameAtNewline(frames, line);
+    if (failedFrames.contains(static_cast<qsizetype>(index))) {
+        return QStringLiteral("<failed to decompress>");
+    }
+    const auto* frame = cachedFrame(static_cast<qsizetype>(index), missing);
+    if (!frame) {
+        return std::nullopt;
+    }
+    const auto newline = line - frames[index].firstLine;
+    if (std::cmp_greater(newline, frame->newlines.size())) {
+        return QString();
+    }
+    qsizetype pos = (newline == 0) ? 0 : frame->newlines[static_cast<size_t>(newline - 1)] + 1;
+
+    // The line may continue in the next frames
+    QByteArray bytes;
+    // NOLINTNEXTLINE(altera-id-dependent-backward-branch)
+    while (true) {
+        const auto end = frame->data.indexOf('\n', pos);
+        const auto length = std::min((end < 0 ? frame->data.size() : end) - pos, MAX_LINE_LENGTH - bytes.size());
+        bytes.append(frame->data.constData() + pos, length); // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+        if (end >= 0 || bytes.size() >= MAX_LINE_LENGTH || ++index >= frames.size()
+            || failedFrames.contains(static_cast<qsizetype>(index))) {
+            break;
+        }
+        frame = cachedFrame(static_cast<qsizetype>(index), missing);
+        if (!frame) {
+            return std::nullopt;
+        }
+        pos = 0;
+    }
+
+    QString text;
+    text.reserve(bytes.size());
+    for (const auto c : QString::fromUtf8(bytes)) {
+        if (c == u'\t') {
+            text.append(QString(TAB_WIDTH - (text.size() % TAB_WIDTH), u' '));
+        } else if (c != u'\r') {
+            text.append(c);
+        }
+    }
+    return text;
+}
+
+int ArchiveView::lineHeight() const
+{
+    return fontMetrics().height();
+}
+
+int ArchiveView::gutterWidth() const
+{
+    const auto digits = QString::number(std::max<qint64>(lineCount(), 1)).size();
+    return (fontMetrics().horizontalAdvance(u'0') * static_cast<int>(digits)) + (3 * MARGIN);
+}
+
+int ArchiveView::visibleLines() const
+{
+    return std::max(1, viewport()->height() / lineHeight());
+}
+
+void ArchiveView::updateScrollBars()
+{
+    const auto rows = visibleLines();
+    verticalScrollBar()->setPageStep(rows);
+    verticalScrollBar()->setSingleStep(1);
+    verticalScrollBar()->setRange(0, static_cast<int>(std::clamp<qint64>(lineCount() - rows, 0, INT_MAX)));
+
+    const auto charWidth = fontMetrics().horizontalAdvance(u'M');
+    const auto textWidth = viewport()->width() - gutterWidth() - MARGIN;
+    horizontalScrollBar()->setPageStep(std::max(textWidth, 1));
+    horizontalScrollBar()->setSingleStep(charWidth);
+    horizontalScrollBar()->setRange(0, std::max(0, (static_cast<int>(widestLine) * charWidth) - textWidth));
+}
+
+void ArchiveView::paintEvent(QPaintEvent* event)
+{
+    QPainter painter(viewport());
+    const auto& pal = palette();
+    painter.fillRect(event->rect(), pal.base());
+    if (frames.empty()) {
+        return;
+    }
+
+    const auto rowHeight = lineHeight();
+    const auto gutter = gutterWidth();
+    const auto viewWidth = viewport()->width();
+    const auto charWidth = fontMetrics().horizontalAdvance(u'M');
+    const auto ascent = fontMetrics().ascent();
+    const auto xOffset = horizontalScrollBar()->value();
+    // Only the columns on screen are drawn, the font is monospaced
+    const auto firstColumn = xOffset / charWidth;
+    const auto columns = ((viewWidth - gutter) / charWidth) + 2;
+    const auto first = static_cast<qint64>(verticalScrollBar()->value());
+    const auto last = std::min(first + visibleLines() + 1, lineCount());
+    const auto widest = widestLine;
+
+    painter.fillRect(0, 0, gutter - MARGIN, viewport()->height(), pal.alternateBase());
+
+    QList<qsizetype> missing;
+    for (auto line = first; line < last; line++) {
+        const auto y = static_cast<int>(line - first) * rowHeight;
+
+        painter.setPen(pal.color(QPalette::PlaceholderText));
+        painter.drawText(QRect(0, y, gutter - (2 * MARGIN), rowHeight), Qt::AlignRight | Qt::AlignVCenter, QString::number(line + 1));
+
+        painter.setClipRect(gutter - MARGIN, 0, viewWidth - gutter + MARGIN, viewport()->height());
+        if (line == selectedLine) {
+            painter.fillRect(gutter - MARGIN, y, viewWidth - gutter + MARGIN, rowHeight, pal.highlight());
+        }
+        const auto text = lineText(line, missing);
+        if (text) {
+            widestLine = std::max(widestLine, text->size());
+            painter.setPen(pal.color(line == selectedLine ? QPalette::HighlightedText : QPalette::Text));
+            painter.drawText(gutter + (firstColumn * charWidth) - xOffset, y + ascent, text->mid(firstColumn, columns));
+        } else {
+            painter.setPen(pal.color(QPalette::PlaceholderText));
+            painter.drawText(gutter - xOffset, y + ascent, QStringLiteral("…"));
+        }
+        painter.setClipping(false);
+    }
+
+    // Read ahead while the user is reading the screen, the frames that are scrolled away aren't needed anymore
+    if (missing.isEmpty() && last > 0) {
+        const auto next = ArchiveReader::frameAtNewline(frames, last - 1) + 1;
+        if (next < frames.size() && !cache.contains(static_cast<qsizetype>(next)) && !failedFrames.contains(static_cast<qsizetype>(next))) {
+            missing.append(static_cast<qsizetype>(next));
+        }
+    }
+    emit framesNeeded(missing);
+
+    if (widestLine != widest) {
+        updateScrollBars();
+    }
+}
+
+void ArchiveView::resizeEvent(QResizeEvent* event)
+{
+    QAbstractScrollArea::resizeEvent(event);
+    updateScrollBars();
+}
+
+void ArchiveView::scrollContentsBy(int /*dx*/, int /*dy*/)
+{
+    viewport()->update();
+}
+
+void ArchiveView::mousePressEvent(QMouseEvent* event)
+{
+    const auto line = verticalScrollBar()->value() + (static_cast<qint64>(event->position().y()) / lineHeight());
+    if (line < lineCount()) {
+        selectLine(line);
+    }
+    QAbstractScrollArea::mousePressEvent(event);
+}
+
+void ArchiveView::keyPressEvent(QKeyEvent* event)
+{
+    if (event->matches(QKeySequence::Copy)) {
+        QList<qsizetype> missing;
+        if (const auto text = (selectedLine >= 0) ? lineText(selectedLine, missing) : std::nullopt) {
+            QApplication::clipboard()->setText(*text);
+        }
+        return;
+    }
+    if (event->matches(QKeySequence::MoveToStartOfDocument)) {
+        verticalScrollBar()->setValue(verticalScrollBar()->minimum());
+        return;
+    }
+    if (event->matches(QKeySequence::MoveToEndOfDocument)) {
+        verticalScrollBar()->setValue(verticalScrollBar()->maximum());
+        return;
+    }
+    if (selectedLine >= 0 && (event->key() == Qt::Key_Up || event->key() == Qt::Key_Down)) {
+        selectLine(std::clamp<qint64>(selectedLine + (event->key() == Qt::Key_Up ? -1 : 1), 0, lineCount() - 1));
+        const auto first = static_cast<qint64>(verticalScrollBar()->value());
+        if (selectedLine < first) {
+            verticalScrollBar()->setValue(static_cast<int>(selectedLine));
+        } else if (selectedLine >= first + visibleLines()) {
+            verticalScrollBar()->setValue(static_cast<int>(selectedLine - visibleLines() + 1));
+        }
+        return;
+    }
+    QAbstractScrollArea::keyPressEvent(event);
+}
@@ -0,0 +1,86 @@
+#ifndef ARCHIVEVIEW_HPP
+#define ARCHIVEVIEW_HPP
+
+#include "archivereader.hpp"
+
+#include <QAbstractScrollArea>
+#include <QByteArray>
+#include <QHash>
+#include <QList>
+#include <QSet>
+#include <QString>
+
+#include <optional>
+#include <vector>
+
+// Read only view of an archive that only holds the frames on screen.
+// Lines are located through the frame index, the frames are decompressed by the ArchiveLoader on request and at most
+// MAX_CACHED_FRAMES of them are kept, so memory use doesn't depend on the size of the archive.
+class ArchiveView final : public QAbstractScrollArea {
+    Q_OBJECT
+
+public:
+    explicit ArchiveView(QWidget* parent = nullptr);
+    ArchiveView(const ArchiveView&) = delete;
+    ArchiveView(ArchiveView&&) = delete;
+    ArchiveView& operator=(const ArchiveView&) = delete;
+    ArchiveView& operator=(ArchiveView&&) = delete;
+    ~ArchiveView() override = default;
+
+    void setFrames(std::vector<ArchiveReader::Frame> newFrames);
+    // Frames indexed after setFrames(), the view keeps its position
+    void appendFrames(const std::vector<ArchiveReader::Frame>& newFrames);
+    [[nodiscard]] size_t frameCount() const { return frames.size(); }
+    void addFrame(const qsizetype index, const QByteArray& data);
+    void setFrameFailed(const qsizetype index);
+
+    // 0 based, -1 if no line is selected
+    [[nodiscard]] qint64 currentLine() const { return selectedLine; }
+    [[nodiscard]] qint64 lineCount() const;
+    // Selects the line and scrolls to it
+    void showLine(const qint64 line);
+
+signals:
+    // The frames needed for the lines on screen that aren't in the cache
+    void framesNeeded(const QList<qsizetype>& indices);
+    void currentLineChanged(qint64 line);
+
+protected:
+    void paintEvent(QPaintEvent* event) override;
+    void resizeEvent(QResizeEvent* event) override;
+    void mousePressEvent(QMouseEvent* event) override;
+    void keyPressEvent(QKeyEvent* event) override;
+    void scrollContentsBy(int dx, int dy) override;
+
+private:
+    static constexpr qsizetype MAX_CACHED_FRAMES = 16;
+    // Longer lines are cut off on screen
+    static constexpr qsizetype MAX_LINE_LENGTH = 64 * 1024;
+    static constexpr int TAB_WIDTH = 8;
+
+    struct CachedFrame {
+        QByteArray data;
+        // Offsets of the '\n' in data
+        std::vector<qsizetype> newlines;
+        quint64 lastUse {};
+    };
+
+    std::vector<ArchiveReader::Frame> frames;
+    QHash<qsizetype, CachedFrame> cache;
+    QSet<qsizetype> failedFrames;
+    quint64 useCounter {};
+    qint64 selectedLine = -1;
+    // Widest line seen so far, in characters
+    qsizetype widestLine {};
+
+    // The text of a line with the tabs expanded, nullopt if a frame it needs isn't loaded yet (added to `missing`)
+    [[nodiscard]] std::optional<QString> lineText(const qint64 line, QList<qsizetype>& missing);
+    [[nodiscard]] CachedFrame* cachedFrame(const qsizetype index, QList<qsizetype>& missing);
+    [[nodiscard]] int lineHeight() const;
+    [[nodiscard]] int gutterWidth() const;
+    [[nodiscard]] int visibleLines() const;
+    void updateScrollBars();
+    void selectLine(const qint64 line);
+};
+
+#endif // ARCHIVEVIEW_HPP
@@ -0,0 +1,148 @@
+#include "archiveviewer.hpp"
+#include "archiveloader.hpp"
+#include "ui_archiveviewer.h"
+
+#include <QFileInfo>
+#include <QKeySequence>
+#include <QLocale>
+#include <QMessageBox>
+#include <QShortcut>
+
+ArchiveViewer::ArchiveViewer(const QString& filename, QWidget* parent)
+    : QWidget(parent)
+    , ui(new Ui::ArchiveViewer)
+    , loader(new ArchiveLoader(filename, this))
+{
+    ui->setupUi(this);
+    setWindowTitle(QFileInfo(filename).fileName());
+    ui->findFrame->setEnabled(false);
+    ui->previousButton->setIcon(QIcon::fromTheme(QStringLiteral("go-up")));
+    ui->nextButton->setIcon(QIcon::fromTheme(QStringLiteral("go-down")));
+    showStatus(QStringLiteral("Opening %1").arg(filename));
+
+    connect(loader, &ArchiveLoader::opened, this, &ArchiveViewer::handleOpened);
+    connect(loader, &ArchiveLoader::indexed, this, &ArchiveViewer::handleIndexed);
+    connect(loader, &ArchiveLoader::openFailed, this, &ArchiveViewer::handleOpenFailed);
+    connect(loader, &ArchiveLoader::frameLoaded, ui->archiveView, &ArchiveView::addFrame);
+    connect(loader, &ArchiveLoader::frameFailed, ui->archiveView, &ArchiveView::setFrameFailed);
+    connect(loader, &ArchiveLoader::found, this, &ArchiveViewer::handleFound);
+    connect(loader, &ArchiveLoader::notFound, this, &ArchiveViewer::handleNotFound);
+    connect(loader, &ArchiveLoader::searchFailed, this, &ArchiveViewer::handleSearchFailed);
+    connect(loader, &ArchiveLoader::searchProgress, this, &ArchiveViewer::handleSearchProgress);
+    connect(ui->archiveView, &ArchiveView::framesNeeded, loader, &ArchiveLoader::requestFrames);
+
+    connect(ui->findLineEdit, &QLineEdit::returnPressed, this, &ArchiveViewer::findNext);
+    connect(ui->findLineEdit, &QLineEdit::textChanged, loader, &ArchiveLoader::cancelFind);
+    connect(ui->nextButton, &QPushButton::clicked, this, &ArchiveViewer::findNext);
+    connect(ui->previousButton, &QPushButton::clicked, this, &ArchiveViewer::findPrevious);
+
+    connect(new QShortcut(QKeySequence::Find, this), &QShortcut::activated, this, [this]() {
+        ui->findLineEdit->setFocus();
+        ui->findLineEdit->selectAll();
+    });
+    connect(new QShortcut(QKeySequence::FindNext, this), &QShortcut::activated, this, &ArchiveViewer::findNext);
+    connect(new QShortcut(QKeySequence::FindPrevious, this), &QShortcut::activated, this, &ArchiveViewer::findPrevious);
+
+    resize(1000, 700);
+    loader->start();
+}
+
+ArchiveViewer::~ArchiveViewer()
+{
+    // Stops the loader before the view it sends frames to is gone
+    delete loader;
+    delete ui;
+}
+
+void ArchiveViewer::handleOpened(qint64 lineCount, qint64 size, bool complete)
+{
+    ui->archiveView->setFrames(loader->frames());
+    ui->archiveView->setFocus();
+    ui->findFrame->setEnabled(true);
+    setSizeText(lineCount, size, complete);
+    showStatus({});
+}
+
+void ArchiveViewer::handleIndexed(qint64 lineCount, qint64 size, bool complete)
+{
+    ui->archiveView->appendFrames(loader->frames(ui->archiveView->frameCount()));
+    setSizeText(lineCount, size, complete);
+    showStatus(statusText);
+}
+
+void ArchiveViewer::handleOpenFailed(const QString& error)
+{
+    showStatus(error);
+    QMessageBox::critical(this, QStringLiteral("Error"), error);
+}
+
+void ArchiveViewer::handleFound(qint64 line)
+{
+    ui->archiveView->showLine(line);
+    showStatus(QStringLiteral("Found on line %1").arg(line + 1));
+}
+
+void ArchiveViewer::handleNotFound()
+{
+    showStatus(QStringLiteral("Not found"));
+}
+
+void ArchiveViewer::handleSearchFailed(const QString& error)
+{
+    showStatus(error);
+}
+
+void ArchiveViewer::handleSearchProgress(int percent)
+{
+    showStatus(QStringLiteral("Searching… %1%").arg(percent));
+}
+
+void ArchiveViewer::findNext()
+{
+    find(true);
+}
+
+void ArchiveViewer::findPrevious()
+{
+    find(false);
+}
+
+void ArchiveViewer::find(const bool forward)
+{
+    if (ui->findLineEdit->text().isEmpty() || !ui->findFrame->isEnabled()) {
+        return;
+    }
+
+    // Continues after / before the current match
+    const auto current = ui->archiveView->currentLine();
+    ArchiveLoader::Search search;
+    search.pattern = ui->findLineEdit->text();
+    search.regex = ui->regexCheckBox->isChecked();
+    search.caseSensitive = ui->caseCheckBox->isChecked();
+    search.forward = forward;
+    search.fromLine = forward ? current + 1 : (current < 0 ? ui->archiveView->lineCount() - 1 : current - 1);
+    if (search.fromLine < 0 || search.fromLine >= ui->archiveView->lineCount()) {
+        handleNotFound();
+        return;
+    }
+    loader->find(search);
+    showStatus(QStringLiteral("Searching…"));
+}
+
+void ArchiveViewer::setSizeText(const qint64 lineCount, const qint64 size, const bool complete)
+{
+    sizeText = QStringLiteral("%1 lines, %2").arg(QLocale().toString(lineCount), QLocale().formattedDataSize(size));
+    if (!complete) {
+        sizeText += QStringLiteral(" so far, indexing…");
+    }
+}
+
+void ArchiveViewer::showStatus(const QString& text)
+{
+    statusText = text;
+    if (sizeText.isEmpty() || text.isEmpty()) {
+        ui->statusLabel->setText(sizeText + text);
+    } else {
+        ui->statusLabel->setText(sizeText + QStringLiteral(" | ") + text);
+    }
+}
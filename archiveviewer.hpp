@@ -0,0 +1,48 @@
+#ifndef ARCHIVEVIEWER_HPP
+#define ARCHIVEVIEWER_HPP
+
+#include <QString>
+#include <QWidget>
+
+namespace Ui {
+class ArchiveViewer;
+} // namespace Ui
+
+class ArchiveLoader;
+
+// Window that shows a long term run mode archive. Nothing is decompressed up front, the first screen is shown as soon
+// as the frames it needs are decompressed, so opening a large archive takes as long as opening a small one.
+class ArchiveViewer final : public QWidget {
+    Q_OBJECT
+
+public:
+    explicit ArchiveViewer(const QString& filename, QWidget* parent = nullptr);
+    ArchiveViewer(const ArchiveViewer&) = delete;
+    ArchiveViewer(ArchiveViewer&&) = delete;
+    ArchiveViewer& operator=(const ArchiveViewer&) = delete;
+    ArchiveViewer& operator=(ArchiveViewer&&) = delete;
+    ~ArchiveViewer() override;
+
+private slots:
+    void handleOpened(qint64 lineCount, qint64 size, bool complete);
+    void handleIndexed(qint64 lineCount, qint64 size, bool complete);
+    void handleOpenFailed(const QString& error);
+    void handleFound(qint64 line);
+    void handleNotFound();
+    void handleSearchFailed(const QString& error);
+    void handleSearchProgress(int percent);
+    void findNext();
+    void findPrevious();
+
+private:
+    Ui::ArchiveViewer* ui;
+    ArchiveLoader* loader;
+    QString sizeText;
+    QString statusText;
+
+    void find(const bool forward);
+    void setSizeText(const qint64 lineCount, const qint64 size, const bool complete);
+    void showStatus(const QString& text);
+};
+
+#endif // ARCHIVEVIEWER_HPP
@@ -0,0 +1,654 @@
+#include "archivewriter.hpp"
+#include "seekableformat.hpp"
+#include "zstddictionary.hpp"
+
+#include <QDateTime>
+#include <QDeadlineTimer>
+#include <QDebug>
+#include <QIODevice>
+#include <QMutexLocker>
+
+#include <algorithm>
+#include <atomic>
+#include <iterator>
+#include <limits>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <time.h>
+#include <utility>
+
+ArchiveWriter::ArchiveWriter(QObject* parent)
+    : QThread(parent)
+{
+}
+
+ArchiveWriter::~ArchiveWriter()
+{
+    close();
+    ZSTD_freeCCtx(zstdCtx);
+    zstdCtx = nullptr;
+}
+
+void ArchiveWriter::open(const QString& newDirectory, const QString& newPortName, const qint64 newMaxFileSize, const qint64 newMaxFileAgeMs,
+    const Compression& newCompression, const ArchiveFile::Options& newIoOptions)
+{
+    close();
+
+    directory = newDirectory;
+    portName = newPortName;
+    maxFileSize = newMaxFileSize;
+    maxFileAgeMs = newMaxFileAgeMs;
+    fileCounter = 0;
+    compression = newCompression;
+    ioOptions = newIoOptions;
+    level = compression.level;
+    // The parameters are applied when the context is created
+    ZSTD_freeCCtx(zstdCtx);
+    zstdCtx = nullptr;
+    dictionary.clear();
+    trainingData.clear();
+    collectingTrainingData = false;
+    {
+        const QMutexLocker locker(&mutex);
+        stopRequested = false;
+        maxQueuedBytes = newMaxFileSize;
+        droppedBytes = 0;
+    }
+
+    appendedBytes = 0;
+    if (journaling) {
+        try {
+            journal.open(directory, portName);
+        } catch (std::exception& e) {
+            qWarning() << "Capturing without a journal:" << e.what();
+        }
+    }
+
+    start(QThread::LowPriority);
+}
+
+void ArchiveWriter::close()
+{
+    {
+        const QMutexLocker locker(&mutex);
+        stopRequested = true;
+    }
+    dataAvailable.wakeAll();
+    wait();
+    // Kept if data was dropped
+    journal.close();
+}
+
+ArchiveWriter::Recovery ArchiveWriter::recoverJournals()
+{
+    Recovery result;
+    // The journals stay locked until all of them have been written and removed
+    for (const auto& stale : CaptureJournal::findStale()) {
+        qWarning() << "Recovering" << stale.data.size() << "bytes captured from" << stale.portName << "before yeTTY stopped unexpectedly";
+
+        std::atomic<bool> written {};
+        ArchiveWriter writer;
+        writer.journaling = false;
+        connect(&writer, &ArchiveWriter::fileWritten, &writer, [&written](const QString& filename) {
+            qInfo() << "Recovered into" << filename;
+            written = true;
+        }, Qt::DirectConnection);
+        writer.open(stale.archiveDirectory, stale.portName, std::numeric_limits<qint64>::max(), std::numeric_limits<qint64>::max(), {}, {});
+        // The journal doesn't know when each chunk arrived, the time index points everything at the last one
+        writer.append(stale.data, stale.timeMs);
+        writer.close();
+
+        if (written) {
+            QFile::remove(stale.filename);
+            result.journals++;
+            result.bytes += stale.data.size();
+        } else {
+            qWarning() << "Failed to recover" << stale.filename << "trying again at the next start";
+            result.failed++;
+        }
+    }
+    return result;
+}
+
+void ArchiveWriter::append(const QByteArray& data)
+{
+    append(data, QDateTime::currentMSecsSinceEpoch());
+}
+
+void ArchiveWriter::append(const QByteArray& data, const qint64 timeMs)
+{
+    journal.append(data.constData(), static_cast<size_t>(data.size()), timeMs);
+    appendedBytes += static_cast<quint64>(data.size());
+    {
+        const QMutexLocker locker(&mutex);
+        chunks.push_back({ data, timeMs, appendedBytes });
+        queuedBytes += data.size();
+        trimQueue();
+    }
+    dataAvailable.wakeOne();
+}
+
+qsizetype ArchiveWriter::queueDepth() const
+{
+    const QMutexLocker locker(&mutex);
+    return static_cast<qsizetype>(chunks.size());
+}
+
+void ArchiveWriter::trimQueue()
+{
+    // Only grows this far while writes are failing, drop the oldest data rather than run out of memory
+    // NOLINTNEXTLINE(altera-id-dependent-backward-branch)
+    while (queuedBytes > maxQueuedBytes && chunks.size() > 1) {
+        queuedBytes -= chunks.front().data.size();
+        droppedBytes += chunks.front().data.size();
+        chunks.pop_front();
+    }
+}
+
+qint64 ArchiveWriter::nextDeadlineMs() const
+{
+    auto deadline = std::numeric_limits<qint64>::max();
+    if (unsynced) {
+        deadline = std::min(deadline, static_cast<qint64>(FLUSH_INTERVAL_MS) - sinceFlush.elapsed());
+    }
+    if (file) {
+        deadline = std::min(deadline, maxFileAgeMs - fileAge.elapsed());
+    }
+    return deadline;
+}
+
+void ArchiveWriter::run()
+{
+    QMutexLocker locker(&mutex);
+
+    // NOLINTNEXTLINE(altera-id-dependent-backward-branch)
+    while (true) {
+        if (chunks.empty() && !stopRequested) {
+            // Wake up without new data when the current frame has to be flushed or the file rotated
+            if (const auto deadline = nextDeadlineMs(); deadline == std::numeric_limits<qint64>::max()) {
+                dataAvailable.wait(&mutex);
+            } else if (deadline > 0) {
+                dataAvailable.wait(&mutex, QDeadlineTimer(deadline));
+            }
+        }
+
+        std::deque<Chunk> batch;
+        batch.swap(chunks);
+        queuedBytes = 0;
+        const auto stopping = stopRequested;
+        locker.unlock();
+
+        QString errStr;
+        size_t processed {};
+        try {
+            // NOLINTNEXTLINE(altera-id-dependent-backward-branch)
+            for (; processed < batch.size(); processed++) {
+                compress(batch[processed]);
+            }
+            if (unsynced && (stopping || sinceFlush.elapsed() >= static_cast<qint64>(FLUSH_INTERVAL_MS))) {
+                sync();
+            }
+            if (file && (stopping || fileSize >= maxFileSize || fileAge.elapsed() >= maxFileAgeMs)) {
+                finishFile();
+            }
+        } catch (std::exception& e) {
+            errStr = QString::fromUtf8(e.what());
+            qCritical() << errStr;
+        }
+
+        if (errStr.isEmpty()) {
+            locker.relock();
+            if (stopping && chunks.empty()) {
+                break;
+            }
+            continue;
+        }
+
+        // Everything since the last frame that is in the file has to be written again, into a new file.
+        // The chunk that failed is already part of frameData.
+        abandonFile();
+        std::deque<Chunk> requeue;
+        requeue.swap(frameData);
+        const auto next = std::min(processed + 1, batch.size());
+        requeue.insert(requeue.end(), batch.begin() + static_cast<std::ptrdiff_t>(next), batch.end());
+
+        locker.relock();
+        // NOLINTNEXTLINE(altera-id-dependent-backward-branch)
+        for (auto it = requeue.rbegin(); it != requeue.rend(); it++) {
+            queuedBytes += it->data.size();
+            chunks.push_front(std::move(*it));
+        }
+        trimQueue();
+        if (droppedBytes) {
+            errStr += QStringLiteral(" (%1 bytes dropped)").arg(droppedBytes);
+        }
+        emit writeFailed(errStr, static_cast<qsizetype>(chunks.size()));
+
+        if (stopping) {
+            qCritical() << "Dropping" << queuedBytes << "bytes on shutdown";
+            chunks.clear();
+            queuedBytes = 0;
+            break;
+        }
+        if (!stopRequested) {
+            // Don't spin on a full or missing disk
+            dataAvailable.wait(&mutex, RETRY_INTERVAL_MS);
+        }
+    }
+}
+
+void ArchiveWriter::compress(const Chunk& chunk)
+{
+    const auto& data = chunk.data;
+    // Split the chunk if it doesn't fit in the open frame
+    qsizetype offset {};
+    try {
+        // NOLINTNEXTLINE(altera-id-dependent-backward-branch)
+        while (offset < data.size()) {
+            const auto length = std::min(data.size() - offset, static_cast<qsizetype>(SeekableFormat::MAX_FRAME_SIZE) - frameSize);
+            const auto piece = (offset == 0 && length == data.size()) ? data : data.sliced(offset, length);
+            // From here on the piece is part of frameData
+            offset += length;
+            compressPiece(piece, chunk.timeMs, chunk.position - static_cast<quint64>(data.size() - offset));
+
+            if (frameSize >= static_cast<qsizetype>(SeekableFormat::MAX_FRAME_SIZE)) {
+                endFrame();
+            }
+        }
+    } catch (...) {
+        // The rest of the chunk has to be written again too
+        if (offset < data.size()) {
+            frameData.push_back({ data.sliced(offset), chunk.timeMs, chunk.position });
+        }
+        throw;
+    }
+}
+
+void ArchiveWriter::compressPiece(const QByteArray& data, const qint64 timeMs, const quint64 position)
+{
+    // Shares the buffer, kept until the frame is written in case it has to be written again
+    frameData.push_back({ data, timeMs, position });
+
+    if (!file) {
+        openFile();
+    }
+    if (timeEntries.empty() || timeMs / TimeIndex::BUCKET_MS != timeEntries.back().timeMs / TimeIndex::BUCKET_MS) {
+        timeEntries.push_back({ timeMs, static_cast<uint32_t>(frameIndex.size()), fileLines });
+    }
+    frameOpen = true;
+    if (!unsynced) {
+        unsynced = true;
+        sinceFlush.start();
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+    ZSTD_inBuffer input = { data.data(), static_cast<size_t>(data.size()), 0 };
+
+    // NOLINTNEXTLINE(altera-id-dependent-backward-branch)
+    while (input.pos < input.size) {
+        ZSTD_outBuffer out = { zstdOutBuffer.data(), zstdOutBuffer.size(), 0 };
+        validateZstdResult(ZSTD_compressStream2(zstdCtx, &out, &input, ZSTD_e_continue));
+        writeOut(out);
+    }
+    fileSize += data.size();
+    frameSize += data.size();
+    const auto lines = std::count(data.cbegin(), data.cend(), '\n');
+    frameLines += lines;
+    fileLines += lines;
+    trigrams.add(data.constData(), static_cast<size_t>(data.size()));
+    fileCompressNs += timer.nsecsElapsed();
+
+    if (collectingTrainingData) {
+        const auto target = static_cast<qsizetype>(compression.dictionaryTrainingMiB) * 1024 * 1024;
+        trainingData.append(data.first(std::min(data.size(), target - trainingData.size())));
+    }
+}
+
+void ArchiveWriter::endFrame()
+{
+    QElapsedTimer timer;
+    timer.start();
+    ZSTD_inBuffer input = { nullptr, 0, 0 };
+    bool finished {};
+
+    // NOLINTNEXTLINE(altera-id-dependent-backward-branch)
+    while (!finished) {
+        ZSTD_outBuffer out = { zstdOutBuffer.data(), zstdOutBuffer.size(), 0 };
+        const auto remaining = ZSTD_compressStream2(zstdCtx, &out, &input, ZSTD_e_end);
+        validateZstdResult(remaining);
+        writeOut(out);
+
+        finished = (remaining == 0);
+    }
+    fileCompressNs += timer.nsecsElapsed();
+
+    const auto frameEnd = file->size();
+    frameIndex.push_back({ static_cast<uint32_t>(frameEnd - lastFrameEnd), static_cast<uint32_t>(frameSize), static_cast<uint32_t>(frameLines) });
+    lastFrameEnd = frameEnd;
+    frameOpen = false;
+    frameSize = 0;
+    frameLines = 0;
+    unwrittenFrames.push_back({ frameEnd, std::move(frameData) });
+    frameData.clear();
+    releaseWrittenFrames();
+
+    if (compression.adaptive) {
+        adaptLevel();
+    }
+
+    // A dictionary can only be loaded between frames
+    if (collectingTrainingData && trainingData.size() >= static_cast<qsizetype>(compression.dictionaryTrainingMiB) * 1024 * 1024) {
+        collectingTrainingData = false;
+        trainDictionary();
+    }
+}
+
+void ArchiveWriter::sync()
+{
+    if (frameOpen) {
+        endFrame();
+    }
+
+    file->sync(false);
+    unsynced = false;
+    releaseWrittenFrames();
+
+    // Only refers to frames that have been handed to the kernel
+    writeTimeIndex(false);
+}
+
+void ArchiveWriter::writeIndex()
+{
+    const auto index = SeekableFormat::serializeIndex(frameIndex);
+    file->write(index.constData(), static_cast<size_t>(index.size()));
+}
+
+void ArchiveWriter::writeTimeIndex(const bool rewrite)
+{
+    if (rewrite) {
+        timeEntriesWritten = 0;
+    } else if (timeEntriesWritten == timeEntries.size()) {
+        return;
+    }
+
+    // Losing the index doesn't lose any data, so this only warns
+    QFile indexFile(TimeIndex::filenameFor(file->fileName()));
+    if (!indexFile.open(QIODevice::WriteOnly | (rewrite ? QIODevice::Truncate : QIODevice::Append))) {
+        qWarning() << "Failed to open" << indexFile.fileName() << indexFile.errorString();
+        return;
+    }
+    const auto sizeBefore = indexFile.size();
+    const auto data = TimeIndex::serialize(std::span(timeEntries).subspan(timeEntriesWritten), sizeBefore == 0);
+    if (indexFile.write(data) != data.size() || !indexFile.flush()) {
+        qWarning() << "Failed to write" << indexFile.fileName() << indexFile.errorString();
+        // Don't leave a partial entry behind, it would shift the ones appended later
+        void(indexFile.resize(sizeBefore));
+        return;
+    }
+    timeEntriesWritten = timeEntries.size();
+}
+
+void ArchiveWriter::writeTrigramFilter(const QString& archive)
+{
+    TrigramFilter::Stats stats;
+    const auto filter = trigrams.build(stats);
+
+    // Searches read the whole archive without it, so this only warns
+    QFile filterFile(TrigramFilter::filenameFor(archive));
+    if (!filterFile.open(QIODevice::WriteOnly | QIODevice::Truncate) || filterFile.write(filter) != filter.size() || !filterFile.flush()) {
+        qWarning() << "Failed to write" << filterFile.fileName() << filterFile.errorString();
+        filterFile.close();
+        filterFile.remove();
+        return;
+    }
+    qInfo().nospace() << "Trigram filter: " << stats.trigrams << " trigrams, " << stats.size << " bytes, false positive rate "
+                      << stats.falsePositiveRate * 100.0 << "% per trigram";
+}
+
+void ArchiveWriter::finishFile()
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    if (frameOpen) {
+        endFrame();
+    }
+    writeIndex();
+    file->sync(true);
+    unsynced = false;
+    releaseWrittenFrames();
+    writeTimeIndex(false);
+
+    const auto filename = file->fileName();
+    const auto compressedSize = file->size();
+    file->close();
+    file.reset();
+    fileCounter++;
+    writeTrigramFilter(filename);
+
+    const auto latency = timer.elapsed();
+    const auto mbPerSec = fileCompressNs ? (static_cast<double>(fileSize) * 1000.0 / static_cast<double>(fileCompressNs)) : 0.0;
+    const auto ratio = compressedSize ? (static_cast<double>(fileSize) / static_cast<double>(compressedSize)) : 0.0;
+    qInfo() << "Archive complete:" << filename << fileSize << "bytes, rotation took" << latency << "ms";
+    qInfo().nospace() << "Compression: " << mbPerSec << " MB/s, ratio " << ratio << ", level " << level
+                      << ", dictionary " << (dictionary.isEmpty() ? 0U : ZstdDictionary::id(dictionary));
+    emit fileWritten(filename, fileSize, latency, queueDepth());
+}
+
+void ArchiveWriter::openFile()
+{
+    const auto filename = QString(QStringLiteral("%1/%2_%3_%4.txt.zst"))
+                              .arg(directory, portName,
+                                  QDateTime::currentDateTime().toString(QStringLiteral("yyyy-MM-dd-hh_mm-ss")),
+                                  (QStringLiteral("%1").arg(fileCounter, 8, 10, QLatin1Char('0'))));
+
+    qInfo() << "Saving" << filename;
+
+    auto newFile = ArchiveFile::create(filename, ioOptions);
+
+    if (!zstdCtx) {
+        createContext();
+    } else {
+        validateZstdResult(ZSTD_CCtx_reset(zstdCtx, ZSTD_reset_session_only));
+    }
+
+    file = std::move(newFile);
+    fileSize = 0;
+    fileLines = 0;
+    lastFrameEnd = 0;
+    frameIndex.clear();
+    timeEntries.clear();
+    timeEntriesWritten = 0;
+    trigrams.reset();
+    fileCompressNs = 0;
+    fileAge.start();
+}
+
+void ArchiveWriter::createContext()
+{
+    zstdCtx = ZSTD_createCCtx();
+    if (!zstdCtx) {
+        throw std::runtime_error("Failed to create zstd ctx");
+    }
+    validateZstdResult(ZSTD_CCtx_setParameter(zstdCtx, ZSTD_c_checksumFlag, 1));
+    validateZstdResult(ZSTD_CCtx_setParameter(zstdCtx, ZSTD_c_compressionLevel, level));
+    // No zstd worker threads or long distance matching: frames end at SeekableFormat::MAX_FRAME_SIZE or every flush,
+    // which is less than a single worker job and far less than the long distance window
+    zstdOutBuffer.resize(ZSTD_CStreamOutSize()); // This returns approx 128KiB
+
+    if (compression.dictionary) {
+        prepareDictionary();
+    }
+
+    adaptCpuNs = threadCpuTimeNs();
+    adaptTimer.start();
+    qInfo() << "zstd level:" << level << "adaptive:" << compression.adaptive;
+}
+
+void ArchiveWriter::prepareDictionary()
+{
+    if (dictionary.isEmpty()) {
+        dictionary = ZstdDictionary::loadLatest(directory, portName);
+    }
+
+    if (!dictionary.isEmpty()) {
+        qInfo() << "Using dictionary" << ZstdDictionary::id(dictionary);
+        validateZstdResult(ZSTD_CCtx_loadDictionary(zstdCtx, dictionary.constData(), static_cast<size_t>(dictionary.size())));
+        return;
+    }
+
+    const auto target = static_cast<qsizetype>(compression.dictionaryTrainingMiB) * 1024 * 1024;
+    trainingData = ZstdDictionary::collectFromArchives(directory, portName, target);
+    if (trainingData.size() >= target) {
+        trainDictionary();
+    } else {
+        // Train once enough has been captured, until then the frames are compressed without a dictionary
+        collectingTrainingData = true;
+    }
+}
+
+void ArchiveWriter::trainDictionary()
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    try {
+        auto newDictionary = ZstdDictionary::train(trainingData);
+        const auto path = ZstdDictionary::save(directory, portName, newDictionary);
+        qInfo() << "Trained dictionary" << ZstdDictionary::id(newDictionary) << "of" << newDictionary.size() << "bytes from"
+                << trainingData.size() << "bytes in" << timer.elapsed() << "ms:" << path;
+
+        validateZstdResult(ZSTD_CCtx_loadDictionary(zstdCtx, newDictionary.constData(), static_cast<size_t>(newDictionary.size())));
+        dictionary = std::move(newDictionary);
+    } catch (std::exception& e) {
+        // Not fatal, the archives are just compressed without a dictionary
+        qWarning() << e.what();
+    }
+
+    trainingData.clear();
+    trainingData.squeeze();
+}
+
+void ArchiveWriter::adaptLevel()
+{
+    const auto wallNs = adaptTimer.nsecsElapsed();
+    if (wallNs <= 0) {
+        return;
+    }
+    const auto cpuNs = threadCpuTimeNs();
+    const auto usagePercent = static_cast<double>(cpuNs - adaptCpuNs) * 100.0 / static_cast<double>(wallNs);
+    adaptCpuNs = cpuNs;
+    adaptTimer.start();
+
+    // Step up only with plenty of headroom since higher levels get disproportionately slower
+    auto newLevel = level;
+    if (usagePercent > compression.cpuBudgetPercent) {
+        newLevel = std::max(ADAPTIVE_MIN_LEVEL, level - 1);
+    } else if (usagePercent < compression.cpuBudgetPercent / 3.0) {
+        newLevel = std::min(ADAPTIVE_MAX_LEVEL, level + 1);
+    }
+
+    if (newLevel != level) {
+        // Allowed between frames, applies to the next one
+        validateZstdResult(ZSTD_CCtx_setParameter(zstdCtx, ZSTD_c_compressionLevel, newLevel));
+        qInfo() << "Adaptive compression level" << level << "->" << newLevel << "CPU usage" << usagePercent << "%";
+        level = newLevel;
+    }
+}
+
+qint64 ArchiveWriter::threadCpuTimeNs()
+{
+    timespec ts {};
+    if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts) != 0) {
+        return 0;
+    }
+    return (static_cast<qint64>(ts.tv_sec) * 1'000'000'000) + ts.tv_nsec;
+}
+
+void ArchiveWriter::releaseWrittenFrames()
+{
+    const auto written = file->writtenSize();
+    // NOLINTNEXTLINE(altera-id-dependent-backward-branch)
+    while (!unwrittenFrames.empty() && unwrittenFrames.front().end <= written) {
+        journal.commit(unwrittenFrames.front().data.back().position);
+        unwrittenFrames.pop_front();
+    }
+}
+
+void ArchiveWriter::abandonFile()
+{
+    frameOpen = false;
+    unsynced = false;
+    frameSize = 0;
+    frameLines = 0;
+    if (zstdCtx) {
+        void(ZSTD_CCtx_reset(zstdCtx, ZSTD_reset_session_only));
+    }
+    if (!file) {
+        return;
+    }
+
+    // Frames whose writes failed or never completed are dropped as well
+    const auto keepEnd = std::min(lastFrameEnd, file->writtenSize());
+    qint64 end {};
+    size_t complete {};
+    // NOLINTNEXTLINE(altera-id-dependent-backward-branch)
+    while (complete < frameIndex.size() && end + frameIndex[complete].compressedSize <= keepEnd) {
+        end += frameIndex[complete].compressedSize;
+        complete++;
+    }
+    frameIndex.resize(complete);
+    lastFrameEnd = end;
+    // NOLINTNEXTLINE(altera-id-dependent-backward-branch)
+    while (!unwrittenFrames.empty() && unwrittenFrames.back().end > lastFrameEnd) {
+        auto& data = unwrittenFrames.back().data;
+        frameData.insert(frameData.begin(), std::make_move_iterator(data.begin()), std::make_move_iterator(data.end()));
+        unwrittenFrames.pop_back();
+    }
+    // The rest is in the part of the file that is kept, recovering it from the journal would archive it twice
+    // NOLINTNEXTLINE(altera-id-dependent-backward-branch)
+    for (; !unwrittenFrames.empty(); unwrittenFrames.pop_front()) {
+        journal.commit(unwrittenFrames.front().data.back().position);
+    }
+
+    // The complete frames are a valid archive on their own, only the partial frame is cut off
+    const auto filename = file->fileName();
+    if (lastFrameEnd) {
+        try {
+            file->truncate(lastFrameEnd);
+            writeIndex();
+            file->close();
+        } catch (std::exception& e) {
+            // Readers fall back to scanning the frames
+            qWarning() << e.what();
+        }
+        std::erase_if(timeEntries, [this](const TimeIndex::Entry& entry) { return entry.frame >= frameIndex.size(); });
+        writeTimeIndex(true);
+        fileCounter++;
+        // Also has the trigrams of the frame that was cut off, which only costs false positives
+        writeTrigramFilter(filename);
+    } else {
+        try {
+            file->close();
+        } catch (std::exception& e) {
+            qWarning() << e.what();
+        }
+        QFile::remove(TimeIndex::filenameFor(filename));
+        QFile::remove(filename);
+    }
+    file.reset();
+}
+
+void ArchiveWriter::writeOut(const ZSTD_outBuffer& out)
+{
+    file->write(static_cast<const char*>(out.dst), out.pos);
+}
+
+void ArchiveWriter::validateZstdResult(const size_t result, const std::experimental::source_location& srcLoc)
+{
+    if (ZSTD_isError(result)) {
+        throw std::runtime_error(std::string("ZSTD error: ") + ZSTD_getErrorName(result) + " " + std::to_string(srcLoc.line()));
+    }
+}
@@ -0,0 +1,191 @@
+#ifndef ARCHIVEWRITER_HPP
+#define ARCHIVEWRITER_HPP
+
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QMutex>
+#include <QString>
+#include <QThread>
+#include <QWaitCondition>
+
+#include <cstdint>
+#include <deque>
+#include <experimental/source_location>
+#include <memory>
+#include <vector>
+#include <zstd.h>
+
+#include "archivefile.hpp"
+#include "capturejournal.hpp"
+#include "seekableformat.hpp"
+#include "timeindex.hpp"
+#include "trigramfilter.hpp"
+
+// Streams the received text into zstd compressed archives on a dedicated thread, so that neither compression nor
+// file I/O ever runs on the GUI thread.
+// The data is compressed as it arrives. Every FLUSH_INTERVAL_MS the current zstd frame is ended and the file is synced,
+// so a crash loses at most one flush interval. Files are rotated once they reach the configured size or age.
+// Frames are bounded to SeekableFormat::MAX_FRAME_SIZE and a seek table is added when a file is finished,
+// see seekableformat.hpp. The arrival time of the data is recorded in a sidecar index, see timeindex.hpp, and
+// the trigrams in a finished file in a Bloom filter, see trigramfilter.hpp.
+// Until the data has been written to the file it is also kept in a CaptureJournal, which recoverJournals()
+// turns into archives after a crash.
+class ArchiveWriter final : public QThread {
+    Q_OBJECT
+
+public:
+    explicit ArchiveWriter(QObject* parent = nullptr);
+    ArchiveWriter(const ArchiveWriter&) = delete;
+    ArchiveWriter(ArchiveWriter&&) = delete;
+    ArchiveWriter& operator=(const ArchiveWriter&) = delete;
+    ArchiveWriter& operator=(ArchiveWriter&&) = delete;
+    ~ArchiveWriter() override;
+
+    struct Compression {
+        int level = 1;
+        // Adjusts the level at every frame so that the writer thread stays within cpuBudgetPercent of one core
+        bool adaptive {};
+        int cpuBudgetPercent = 25;
+        // Use a per port dictionary, trained from existing archives or from the first dictionaryTrainingMiB captured
+        bool dictionary {};
+        int dictionaryTrainingMiB = 4;
+    };
+
+    // Starts the writer thread, files are named <directory>/<portName>_<date>_<counter>.txt.zst
+    // A file is rotated once it holds `newMaxFileSize` bytes of uncompressed text or is `newMaxFileAgeMs` old.
+    void open(const QString& newDirectory, const QString& newPortName, const qint64 newMaxFileSize, const qint64 newMaxFileAgeMs,
+        const Compression& newCompression, const ArchiveFile::Options& newIoOptions);
+    // Writes out whatever is still queued, finishes the current file and stops the thread
+    void close();
+    struct Recovery {
+        qsizetype journals {};
+        qint64 bytes {};
+        qsizetype failed {};
+    };
+
+    // Writes the data of the journals left behind by a crash into archives, blocks until done (see JournalRecovery)
+    static Recovery recoverJournals();
+
+    // Queues `data` to be appended to the archive, never blocks on I/O. The data is indexed with the time of the call.
+    void append(const QByteArray& data);
+    // Same, for data that arrived at `timeMs` (ms since epoch)
+    void append(const QByteArray& data, const qint64 timeMs);
+    [[nodiscard]] qsizetype queueDepth() const;
+
+signals:
+    // latencyMs is the time it took to finish the file (last frame, sync and close)
+    void fileWritten(const QString& filename, qint64 size, qint64 latencyMs, qsizetype queueDepth);
+    void writeFailed(const QString& error, qsizetype queueDepth);
+
+protected:
+    void run() override;
+
+private:
+    static constexpr unsigned long FLUSH_INTERVAL_MS = 5000;
+    static constexpr unsigned long RETRY_INTERVAL_MS = 5000;
+    static constexpr int ADAPTIVE_MIN_LEVEL = 1;
+    static constexpr int ADAPTIVE_MAX_LEVEL = 19;
+
+    struct Chunk {
+        QByteArray data;
+        // Arrival time, ms since epoch
+        qint64 timeMs {};
+        // Journal position of the end of the data
+        quint64 position {};
+    };
+
+    mutable QMutex mutex;
+    QWaitCondition dataAvailable;
+    std::deque<Chunk> chunks;
+    qint64 queuedBytes {};
+    // Upper bound for queuedBytes while writes are failing, the oldest data is dropped beyond this
+    qint64 maxQueuedBytes {};
+    qint64 droppedBytes {};
+    bool stopRequested {};
+
+    // Only accessed by the thread calling append(), and by the writer thread to commit
+    CaptureJournal journal;
+    bool journaling = true;
+    quint64 appendedBytes {};
+
+    // Only accessed by the writer thread while it is running
+    QString directory;
+    QString portName;
+    qint64 maxFileSize {};
+    qint64 maxFileAgeMs {};
+    int fileCounter {};
+    Compression compression;
+    ArchiveFile::Options ioOptions;
+    // Current level, differs from compression.level in adaptive mode
+    int level {};
+    ZSTD_CCtx* zstdCtx {};
+    std::vector<char> zstdOutBuffer;
+    QByteArray dictionary;
+    // Captured data is collected here until there's enough to train a dictionary
+    QByteArray trainingData;
+    bool collectingTrainingData {};
+
+    std::unique_ptr<ArchiveFile> file;
+    // Uncompressed bytes and lines in the current file
+    qint64 fileSize {};
+    qint64 fileLines {};
+    QElapsedTimer fileAge;
+    // Time since the first data that hasn't been synced yet
+    QElapsedTimer sinceFlush;
+    bool unsynced {};
+    // Data has been fed to the compressor since the last frame was ended
+    bool frameOpen {};
+    // Uncompressed size and number of lines in the open frame
+    qint64 frameSize {};
+    qint64 frameLines {};
+    // Complete frames of the current file
+    std::vector<SeekableFormat::FrameEntry> frameIndex;
+    // The data in the open frame, requeued if the frame can't be written
+    std::deque<Chunk> frameData;
+    struct UnwrittenFrame {
+        qint64 end {};
+        std::deque<Chunk> data;
+    };
+    // Complete frames whose writes haven't completed yet, requeued as well if they fail.
+    // Once they have, their data is committed in the journal.
+    std::deque<UnwrittenFrame> unwrittenFrames;
+    // Time index of the current file and how much of it is in the sidecar file
+    std::vector<TimeIndex::Entry> timeEntries;
+    size_t timeEntriesWritten {};
+    TrigramFilter trigrams;
+    // Size of the file at the end of the last complete frame
+    qint64 lastFrameEnd {};
+    // Time spent in the compressor for the current file, for the throughput stats
+    qint64 fileCompressNs {};
+    // CPU time of this thread and wall time at the last level adjustment
+    qint64 adaptCpuNs {};
+    QElapsedTimer adaptTimer;
+
+    // Must be called with the mutex held
+    void trimQueue();
+    // Time until the open frame has to be flushed or the file rotated
+    [[nodiscard]] qint64 nextDeadlineMs() const;
+    void compress(const Chunk& chunk);
+    void compressPiece(const QByteArray& data, const qint64 timeMs, const quint64 position);
+    void endFrame();
+    void releaseWrittenFrames();
+    void sync();
+    // Appends the line index and the seek table
+    void writeIndex();
+    // Appends the new time index entries to the sidecar file, or writes all of them if `rewrite`
+    void writeTimeIndex(const bool rewrite);
+    void writeTrigramFilter(const QString& archive);
+    void finishFile();
+    void openFile();
+    void createContext();
+    void prepareDictionary();
+    void trainDictionary();
+    void adaptLevel();
+    [[nodiscard]] static qint64 threadCpuTimeNs();
+    void abandonFile();
+    void writeOut(const ZSTD_outBuffer& out);
+    static void validateZstdResult(const size_t result, const std::experimental::source_location& srcLoc = std::experimental::source_location::current());
+};
+
+#endif // ARCHIVEWRITER_HPP
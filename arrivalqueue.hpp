@@ -0,0 +1,107 @@
+#ifndef ARRIVALQUEUE_HPP
+#define ARRIVALQUEUE_HPP
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+// Lock-free single producer/single consumer queue with the arrival times of the data in an SpscRingBuffer.
+// The producer marks the ring position at which each read starts with the time of the read, before committing the
+// data, and the consumer maps the data it drained back to those times. Reads within RESOLUTION_US of the last mark
+// share it, so a consumer that is behind doesn't have to handle every small read on its own. While the queue is full
+// the following reads are merged into one mark with the time of the first of them, so only a consumer that is
+// CAPACITY marks behind loses more precision. Like the ring, all storage is allocated up front.
+class ArrivalQueue final {
+public:
+    static constexpr int64_t RESOLUTION_US = 1000;
+
+    struct Mark {
+        // Ring position (SpscRingBuffer::writePosition()) of the first byte, or offset in the drained data
+        size_t position {};
+        int64_t timeUs {};
+    };
+
+    ArrivalQueue() = default;
+    ArrivalQueue(const ArrivalQueue&) = delete;
+    ArrivalQueue(ArrivalQueue&&) = delete;
+    ArrivalQueue& operator=(const ArrivalQueue&) = delete;
+    ArrivalQueue& operator=(ArrivalQueue&&) = delete;
+    ~ArrivalQueue() = default;
+
+    // Producer: the data written from ring position `position` on arrived at `timeUs`
+    void mark(const size_t position, const int64_t timeUs) noexcept
+    {
+        if (!flush() || (lastMarkUs >= 0 && timeUs - lastMarkUs < RESOLUTION_US)) {
+            return;
+        }
+        lastMarkUs = timeUs;
+        if (!tryPush({ position, timeUs })) {
+            pending = Mark { position, timeUs };
+        }
+    }
+
+    // Producer: retries a mark that didn't fit, returns false if it still doesn't
+    bool flush() noexcept
+    {
+        if (pending && !tryPush(*pending)) {
+            return false;
+        }
+        pending.reset();
+        return true;
+    }
+
+    // Consumer: the times of the data between ring positions `begin` and `end`, with positions relative to `begin`.
+    // The first mark is at 0, its time is -1 if no time is known for the start of the data.
+    [[nodiscard]] std::vector<Mark> take(const size_t begin, const size_t end)
+    {
+        std::vector<Mark> marks { { 0, current.timeUs } };
+        // NOLINTNEXTLINE(altera-id-dependent-backward-branch)
+        for (auto tail = readIdx.load(std::memory_order_relaxed); tail != writeIdx.load(std::memory_order_acquire); tail++) {
+            const auto& mark = entries.at(tail % CAPACITY);
+            // Positions are compared as differences so that they may wrap around
+            const auto offset = static_cast<std::ptrdiff_t>(mark.position - begin);
+            if (offset >= static_cast<std::ptrdiff_t>(end - begin)) {
+                // Data that hasn't been drained yet
+                break;
+            }
+            current = mark;
+            if (offset <= 0) {
+                // A mark that was held back while the queue was full applies from here on
+                marks.front().timeUs = mark.timeUs;
+            } else {
+                marks.push_back({ mark.position - begin, mark.timeUs });
+            }
+            readIdx.store(tail + 1, std::memory_order_release);
+        }
+        return marks;
+    }
+
+private:
+    static constexpr size_t CAPACITY = 4096;
+
+    std::array<Mark, CAPACITY> entries {};
+    // Producer only
+    std::optional<Mark> pending;
+    int64_t lastMarkUs = -1;
+    // Consumer only, the mark in effect at the start of the next take()
+    Mark current { 0, -1 };
+
+    std::atomic<size_t> writeIdx {};
+    std::atomic<size_t> readIdx {};
+
+    bool tryPush(const Mark& mark) noexcept
+    {
+        const auto head = writeIdx.load(std::memory_order_relaxed);
+        if (head - readIdx.load(std::memory_order_acquire) == CAPACITY) {
+            return false;
+        }
+        entries.at(head % CAPACITY) = mark;
+        writeIdx.store(head + 1, std::memory_order_release);
+        return true;
+    }
+};
+
+#endif // ARRIVALQUEUE_HPP
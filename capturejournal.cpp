@@ -0,0 +1,223 @@
+#include "capturejournal.hpp"
+
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QRandomGenerator>
+#include <QStandardPaths>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <stdexcept>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static_assert(std::atomic_ref<uint64_t>::required_alignment <= alignof(uint64_t));
+
+[[nodiscard]] static std::runtime_error journalError(const QString& what, const QString& filename)
+{
+    return std::runtime_error(QStringLiteral("%1 %2: %3").arg(what, filename, QString::fromLocal8Bit(strerror(errno))).toStdString());
+}
+
+CaptureJournal::LockedFile::~LockedFile()
+{
+    if (fd >= 0) {
+        ::close(fd);
+    }
+}
+
+CaptureJournal::~CaptureJournal()
+{
+    close();
+}
+
+QString CaptureJournal::directory()
+{
+    return QStandardPaths::writableLocation(QStandardPaths::AppDataLocation) + QStringLiteral("/journal");
+}
+
+CaptureJournal::Header& CaptureJournal::header() const
+{
+    return *reinterpret_cast<Header*>(mapping); // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
+}
+
+void CaptureJournal::open(const QString& archiveDirectory, const QString& portName)
+{
+    close();
+
+    const auto dir = directory();
+    if (!QDir().mkpath(dir)) {
+        throw std::runtime_error(QStringLiteral("Failed to create %1").arg(dir).toStdString());
+    }
+    const auto directoryUtf8 = archiveDirectory.toUtf8();
+    const auto portNameUtf8 = portName.toUtf8();
+    if (sizeof(Header) + static_cast<size_t>(directoryUtf8.size() + portNameUtf8.size()) > HEADER_SIZE) {
+        throw std::runtime_error("Archive directory name is too long for the journal");
+    }
+
+    // One new journal per capture, the lock tells findStale() that it's in use. The pid alone isn't unique, a crashed
+    // instance's pid may be reused (containers, Flatpak) and its journal must not be touched before it's recovered.
+    static constexpr int MAX_CREATE_ATTEMPTS = 16;
+    // NOLINTNEXTLINE(altera-id-dependent-backward-branch)
+    for (int attempt = 0; fd < 0; attempt++) {
+        filename = QStringLiteral("%1/%2-%3-%4.journal")
+                       .arg(dir, portName)
+                       .arg(getpid())
+                       .arg(QRandomGenerator::global()->generate(), 8, 16, QLatin1Char('0'));
+        fd = ::open(QFile::encodeName(filename).constData(), O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0600); // NOLINT(cppcoreguidelines-pro-type-vararg)
+        if (fd < 0 && (errno != EEXIST || attempt + 1 == MAX_CREATE_ATTEMPTS)) {
+            throw journalError(QStringLiteral("Failed to create"), filename);
+        }
+    }
+    try {
+        // findStale() of another instance may hold the lock for a moment while it finds the new file empty
+        if (flock(fd, LOCK_EX) != 0) {
+            throw journalError(QStringLiteral("Failed to lock"), filename);
+        }
+        // Allocated up front, running out of space while writing to the mapping would be a SIGBUS
+        constexpr auto size = static_cast<off_t>(HEADER_SIZE + CAPACITY);
+        if (const auto result = posix_fallocate(fd, 0, size); result != 0) {
+            errno = result;
+            throw journalError(QStringLiteral("Failed to allocate"), filename);
+        }
+        auto* const address = mmap(nullptr, static_cast<size_t>(size), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (address == MAP_FAILED) { // NOLINT(cppcoreguidelines-pro-type-cstyle-cast)
+            throw journalError(QStringLiteral("Failed to map"), filename);
+        }
+        mapping = static_cast<char*>(address);
+    } catch (...) {
+        ::close(fd);
+        fd = -1;
+        QFile::remove(filename);
+        throw;
+    }
+
+    auto& h = header();
+    h.magic = MAGIC;
+    h.version = VERSION;
+    h.capacity = CAPACITY;
+    h.head = 0;
+    h.committed = 0;
+    h.lastAppendMs = 0;
+    h.archiveDirectorySize = static_cast<uint32_t>(directoryUtf8.size());
+    h.portNameSize = static_cast<uint32_t>(portNameUtf8.size());
+    // NOLINTBEGIN(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+    memcpy(mapping + sizeof(Header), directoryUtf8.constData(), h.archiveDirectorySize);
+    memcpy(mapping + sizeof(Header) + h.archiveDirectorySize, portNameUtf8.constData(), h.portNameSize);
+    // NOLINTEND(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+}
+
+void CaptureJournal::close()
+{
+    if (!mapping) {
+        return;
+    }
+
+    auto& h = header();
+    const auto complete = std::atomic_ref(h.committed).load() >= std::atomic_ref(h.head).load();
+    munmap(mapping, HEADER_SIZE + CAPACITY);
+    mapping = nullptr;
+    if (complete) {
+        QFile::remove(filename);
+    } else {
+        qWarning() << "Keeping" << filename << "to recover the data that didn't make it into an archive";
+    }
+    ::close(fd);
+    fd = -1;
+}
+
+void CaptureJournal::append(const char* data, const size_t len, const qint64 timeMs)
+{
+    if (!mapping) {
+        return;
+    }
+
+    auto& h = header();
+    const auto head = std::atomic_ref(h.head).load(std::memory_order_relaxed);
+    // Only the end of a chunk larger than the journal is kept
+    const auto count = std::min<quint64>(len, CAPACITY);
+    const auto pos = (head + len - count) % CAPACITY;
+    const auto first = std::min(count, CAPACITY - pos);
+    // NOLINTBEGIN(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+    auto* const ring = mapping + HEADER_SIZE;
+    const auto* const source = data + (len - count);
+    memcpy(ring + pos, source, first);
+    memcpy(ring, source + first, count - first);
+    // NOLINTEND(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+
+    std::atomic_ref(h.lastAppendMs).store(timeMs, std::memory_order_relaxed);
+    std::atomic_ref(h.head).store(head + len, std::memory_order_release);
+}
+
+void CaptureJournal::commit(const quint64 position)
+{
+    if (mapping) {
+        std::atomic_ref(header().committed).store(position, std::memory_order_relaxed);
+    }
+}
+
+std::vector<CaptureJournal::Stale> CaptureJournal::findStale()
+{
+    std::vector<Stale> stale;
+    const QDir dir(directory());
+    for (const auto& name : dir.entryList({ QStringLiteral("*.journal") }, QDir::Files)) {
+        const auto path = dir.filePath(name);
+        const auto journalFd = ::open(QFile::encodeName(path).constData(), O_RDONLY | O_CLOEXEC); // NOLINT(cppcoreguidelines-pro-type-vararg)
+        if (journalFd < 0) {
+            continue;
+        }
+        Stale journal;
+        journal.lock = LockedFile(journalFd);
+        // Locked by a running instance, or being recovered by another one
+        if (flock(journalFd, LOCK_EX | LOCK_NB) != 0) {
+            continue;
+        }
+        // Recovered and removed by another instance between the open() and the flock()
+        struct stat status {};
+        if (fstat(journalFd, &status) != 0 || status.st_nlink == 0) {
+            continue;
+        }
+
+        Header h {};
+        std::array<char, HEADER_SIZE> headerData {};
+        if (pread(journalFd, headerData.data(), HEADER_SIZE, 0) != static_cast<ssize_t>(HEADER_SIZE)) {
+            // Just created by an instance that hasn't locked it yet
+            continue;
+        }
+        memcpy(&h, headerData.data(), sizeof(h));
+        if (h.magic != MAGIC || h.version != VERSION || h.capacity != CAPACITY || h.committed > h.head
+            || sizeof(Header) + h.archiveDirectorySize + h.portNameSize > HEADER_SIZE) {
+            qWarning() << path << "is not a valid journal";
+            continue;
+        }
+
+        if (h.committed < h.head) {
+            const auto start = std::max<uint64_t>(h.committed, h.head > CAPACITY ? h.head - CAPACITY : 0);
+            const auto count = h.head - start;
+            const auto pos = start % CAPACITY;
+            const auto first = std::min<uint64_t>(count, CAPACITY - pos);
+            journal.data.resize(static_cast<qsizetype>(count));
+            // NOLINTBEGIN(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+            if (pread(journalFd, journal.data.data(), first, static_cast<off_t>(HEADER_SIZE + pos)) != static_cast<ssize_t>(first)
+                || pread(journalFd, journal.data.data() + first, count - first, HEADER_SIZE) != static_cast<ssize_t>(count - first)) {
+                qWarning() << "Failed to read" << path;
+                continue;
+            }
+            journal.archiveDirectory = QString::fromUtf8(headerData.data() + sizeof(Header), h.archiveDirectorySize);
+            journal.portName = QString::fromUtf8(headerData.data() + sizeof(Header) + h.archiveDirectorySize, h.portNameSize);
+            // NOLINTEND(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+            journal.filename = path;
+            journal.timeMs = h.lastAppendMs;
+            stale.push_back(std::move(journal));
+        } else {
+            QFile::remove(path);
+        }
+    }
+    return stale;
+}
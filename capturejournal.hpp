@@ -0,0 +1,105 @@
+#ifndef CAPTUREJOURNAL_HPP
+#define CAPTUREJOURNAL_HPP
+
+#include <QByteArray>
+#include <QString>
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+// Memory mapped ring buffer with the most recently captured data, kept until the archive writer has written it to the
+// archive. The mapping is shared with the page cache, so the data survives a crash or kill of yeTTY (but not a power
+// loss) for the cost of a memcpy per chunk. Journals are stored in the application data directory, a journal that is
+// left behind with data that never made it into an archive is found by findStale() on the next start.
+class CaptureJournal final {
+public:
+    static constexpr quint64 CAPACITY = 64 * 1024 * 1024;
+
+    // Owns a file descriptor, and with it the flock() on the file
+    class LockedFile final {
+    public:
+        explicit LockedFile(const int newFd = -1)
+            : fd(newFd)
+        {
+        }
+        LockedFile(const LockedFile&) = delete;
+        LockedFile(LockedFile&& other) noexcept
+            : fd(std::exchange(other.fd, -1))
+        {
+        }
+        LockedFile& operator=(const LockedFile&) = delete;
+        LockedFile& operator=(LockedFile&& other) noexcept
+        {
+            std::swap(fd, other.fd);
+            return *this;
+        }
+        ~LockedFile();
+
+    private:
+        int fd { -1 };
+    };
+
+    struct Stale {
+        QString filename;
+        // Where the archives of the capture went
+        QString archiveDirectory;
+        QString portName;
+        // The data that isn't in an archive, at most CAPACITY bytes
+        QByteArray data;
+        // Time of the last append
+        qint64 timeMs {};
+        // Held until the journal has been recovered and removed, so that no other instance recovers it too
+        LockedFile lock;
+    };
+
+    CaptureJournal() = default;
+    CaptureJournal(const CaptureJournal&) = delete;
+    CaptureJournal(CaptureJournal&&) = delete;
+    CaptureJournal& operator=(const CaptureJournal&) = delete;
+    CaptureJournal& operator=(CaptureJournal&&) = delete;
+    ~CaptureJournal();
+
+    // Creates a new journal, throws std::runtime_error on failure
+    void open(const QString& archiveDirectory, const QString& portName);
+    // The file is removed if everything in it has been committed, otherwise it's left to be recovered
+    void close();
+    [[nodiscard]] bool isOpen() const { return mapping != nullptr; }
+
+    // Only called from one thread. Positions count the bytes appended since open().
+    void append(const char* data, const size_t len, const qint64 timeMs);
+    // Everything before `position` is in an archive, may be called from another thread than append()
+    void commit(const quint64 position);
+
+    // Journals of instances that aren't running anymore that still hold data, locked exclusively until the returned
+    // Stale is destroyed. Journals without such data are removed.
+    [[nodiscard]] static std::vector<Stale> findStale();
+
+private:
+    static constexpr uint32_t MAGIC = 0x4A545459; // "YTTJ"
+    static constexpr uint32_t VERSION = 1;
+    // The header is followed by the archive directory and port name (UTF-8), the data starts at HEADER_SIZE
+    static constexpr size_t HEADER_SIZE = 4096;
+
+    struct Header {
+        uint32_t magic;
+        uint32_t version;
+        uint64_t capacity;
+        // Bytes appended and committed since the journal was created
+        uint64_t head;
+        uint64_t committed;
+        int64_t lastAppendMs;
+        uint32_t archiveDirectorySize;
+        uint32_t portNameSize;
+    };
+
+    int fd { -1 };
+    QString filename;
+    char* mapping {};
+
+    [[nodiscard]] Header& header() const;
+    [[nodiscard]] static QString directory();
+};
+
+#endif // CAPTUREJOURNAL_HPP
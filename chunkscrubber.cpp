@@ -0,0 +1,139 @@
+#include "chunkscrubber.hpp"
+
+#include <bit>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#define CHUNKSCRUBBER_X86
+#endif
+
+// State shared by the vector loops and the scalar path
+struct ScrubState {
+    char* data;
+    size_t in;
+    size_t out;
+    bool lastWasCr;
+    std::vector<size_t>& newlines;
+};
+
+static inline void scrubScalar(ScrubState& s, const size_t end)
+{
+    // NOLINTBEGIN(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+    while (s.in < end) {
+        const char c = s.data[s.in++];
+
+        if (c == '\n') {
+            if (s.lastWasCr) {
+                // Second half of "\r\n", the '\r' was already turned into a newline
+                s.lastWasCr = false;
+                continue;
+            }
+            s.newlines.push_back(s.out);
+            s.data[s.out++] = '\n';
+        } else if (c == '\r') {
+            s.lastWasCr = true;
+            s.newlines.push_back(s.out);
+            s.data[s.out++] = '\n';
+        } else {
+            s.lastWasCr = false;
+            s.data[s.out++] = (c == '\0') ? ' ' : c;
+        }
+    }
+    // NOLINTEND(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+}
+
+// Fast path for a block that contains neither '\0' nor '\r'
+static inline void copyCleanBlock(ScrubState& s, const size_t width, uint32_t newlineMask)
+{
+    if (s.out != s.in) {
+        memmove(s.data + s.out, s.data + s.in, width); // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+    }
+
+    // NOLINTNEXTLINE(altera-id-dependent-backward-branch)
+    for (; newlineMask; newlineMask &= newlineMask - 1) {
+        s.newlines.push_back(s.out + static_cast<size_t>(std::countr_zero(newlineMask)));
+    }
+
+    s.in += width;
+    s.out += width;
+}
+
+#ifdef CHUNKSCRUBBER_X86
+static void scrubSse2(ScrubState& s, const size_t len)
+{
+    constexpr size_t WIDTH = 16;
+    const auto newline = _mm_set1_epi8('\n');
+    const auto carriageReturn = _mm_set1_epi8('\r');
+    const auto zero = _mm_setzero_si128();
+
+    // NOLINTNEXTLINE(altera-id-dependent-backward-branch)
+    while (s.in + WIDTH <= len) {
+        // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast,cppcoreguidelines-pro-bounds-pointer-arithmetic)
+        const auto v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s.data + s.in));
+        const auto special = static_cast<uint32_t>(_mm_movemask_epi8(
+            _mm_or_si128(_mm_cmpeq_epi8(v, zero), _mm_cmpeq_epi8(v, carriageReturn))));
+
+        if (special || s.lastWasCr) {
+            scrubScalar(s, s.in + WIDTH);
+            continue;
+        }
+        copyCleanBlock(s, WIDTH, static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(v, newline))));
+    }
+}
+
+__attribute__((target("avx2"))) static void scrubAvx2(ScrubState& s, const size_t len)
+{
+    constexpr size_t WIDTH = 32;
+    const auto newline = _mm256_set1_epi8('\n');
+    const auto carriageReturn = _mm256_set1_epi8('\r');
+    const auto zero = _mm256_setzero_si256();
+
+    // NOLINTNEXTLINE(altera-id-dependent-backward-branch)
+    while (s.in + WIDTH <= len) {
+        // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast,cppcoreguidelines-pro-bounds-pointer-arithmetic)
+        const auto v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(s.data + s.in));
+        const auto special = static_cast<uint32_t>(_mm256_movemask_epi8(
+            _mm256_or_si256(_mm256_cmpeq_epi8(v, zero), _mm256_cmpeq_epi8(v, carriageReturn))));
+
+        if (special || s.lastWasCr) {
+            scrubScalar(s, s.in + WIDTH);
+            continue;
+        }
+        copyCleanBlock(s, WIDTH, static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, newline))));
+    }
+}
+
+static bool hasAvx2()
+{
+    static const bool result = __builtin_cpu_supports("avx2");
+    return result;
+}
+#endif
+
+size_t ChunkScrubber::process(char* data, const size_t len)
+{
+    newlines.clear();
+
+    ScrubState state { data, 0, 0, lastWasCr, newlines };
+
+#ifdef CHUNKSCRUBBER_X86
+    if (hasAvx2()) {
+        scrubAvx2(state, len);
+    } else {
+        scrubSse2(state, len);
+    }
+#endif
+    // Remainder that doesn't fill a vector, or everything if SIMD is not available
+    scrubScalar(state, len);
+
+    lastWasCr = state.lastWasCr;
+    return state.out;
+}
+
+void ChunkScrubber::reset()
+{
+    lastWasCr = false;
+    newlines.clear();
+}
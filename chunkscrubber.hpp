@@ -0,0 +1,28 @@
+#ifndef CHUNKSCRUBBER_HPP
+#define CHUNKSCRUBBER_HPP
+
+#include <cstddef>
+#include <vector>
+
+// Single pass over each received chunk that
+//  - replaces '\0' with ' ' so that it doesn't mess up the text shown or string operations downstream
+//  - converts "\r\n" and lone '\r' to '\n'
+//  - records the offset of every '\n' in the output
+// Uses AVX2 or SSE2 when available, blocks without '\0' and '\r' are only scanned for newlines.
+class ChunkScrubber final {
+public:
+    // Processes the data in place and returns the new length, which is smaller if "\r\n" pairs were merged.
+    // A '\r' at the end of a chunk is remembered so that a '\n' at the start of the next chunk is dropped.
+    [[nodiscard]] size_t process(char* data, const size_t len);
+
+    // Offsets of '\n' in the output of the last process() call
+    [[nodiscard]] const std::vector<size_t>& newlineOffsets() const { return newlines; }
+
+    void reset();
+
+private:
+    bool lastWasCr {};
+    std::vector<size_t> newlines;
+};
+
+#endif // CHUNKSCRUBBER_HPP
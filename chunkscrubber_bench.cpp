@@ -0,0 +1,111 @@
+// Microbenchmark for ChunkScrubber, compares it with the per-chunk work handleNewData() did before it existed:
+// QByteArray::replace('\0', ' ') followed by lastIndexOf('\n') to find the end of the last line for the triggers.
+// Built with -DBUILD_BENCHMARKS=ON, run without arguments.
+
+#include "chunkscrubber.hpp"
+
+#include <QByteArray>
+#include <QElapsedTimer>
+
+#include <array>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <random>
+
+#if defined(__x86_64__)
+#include <x86intrin.h>
+#define BENCH_TSC
+#endif
+
+// A typical read at high baud rates
+static constexpr qsizetype CHUNK_SIZE = 4096;
+static constexpr qsizetype TOTAL_SIZE = 256 * 1024 * 1024;
+static constexpr qsizetype LINE_LENGTH = 80;
+
+struct Input {
+    const char* name;
+    // Line ending appended to every line
+    const char* eol;
+    // One in this many bytes is '\0', 0 for none
+    int nulEvery;
+};
+
+static QByteArray makeChunk(const Input& input)
+{
+    std::mt19937 rng(1); // NOLINT(cert-msc32-c,cert-msc51-cpp)
+    std::uniform_int_distribution<int> printable(' ', '~');
+    std::uniform_int_distribution<int> nul(0, input.nulEvery ? input.nulEvery - 1 : 0);
+
+    QByteArray chunk;
+    // NOLINTNEXTLINE(altera-id-dependent-backward-branch)
+    while (chunk.size() < CHUNK_SIZE) {
+        for (qsizetype i = 0; i < LINE_LENGTH; i++) {
+            chunk.append(input.nulEvery && !nul(rng) ? '\0' : static_cast<char>(printable(rng)));
+        }
+        chunk.append(input.eol);
+    }
+    chunk.resize(CHUNK_SIZE);
+    return chunk;
+}
+
+static uint64_t cycles()
+{
+#ifdef BENCH_TSC
+    return __rdtsc();
+#else
+    return 0;
+#endif
+}
+
+template <typename F>
+static void measure(const char* name, const QByteArray& chunk, F&& work)
+{
+    // Each iteration starts from the original data, like a fresh read would
+    QByteArray buffer(chunk.size(), Qt::Uninitialized);
+    size_t sink {};
+
+    QElapsedTimer timer;
+    timer.start();
+    const auto start = cycles();
+    for (qsizetype done = 0; done < TOTAL_SIZE; done += chunk.size()) {
+        memcpy(buffer.data(), chunk.constData(), static_cast<size_t>(chunk.size()));
+        sink += work(buffer);
+    }
+    const auto elapsedCycles = cycles() - start;
+    const auto elapsedNs = timer.nsecsElapsed();
+
+    const auto gbPerSecond = static_cast<double>(TOTAL_SIZE) / static_cast<double>(elapsedNs);
+    if (elapsedCycles) {
+        printf("  %-8s %6.2f bytes/cycle %6.2f GB/s (%zu)\n", name,
+            static_cast<double>(TOTAL_SIZE) / static_cast<double>(elapsedCycles), gbPerSecond, sink % 10);
+    } else {
+        printf("  %-8s %6.2f GB/s (%zu)\n", name, gbPerSecond, sink % 10);
+    }
+}
+
+int main()
+{
+    static constexpr std::array<Input, 3> INPUTS { {
+        { "LF text", "\n", 0 },
+        { "CRLF text", "\r\n", 0 },
+        { "Text with 1% '\\0'", "\n", 100 },
+    } };
+
+    for (const auto& input : INPUTS) {
+        const auto chunk = makeChunk(input);
+        printf("%s, %lld byte chunks\n", input.name, static_cast<long long>(chunk.size()));
+
+        measure("before", chunk, [](QByteArray& data) {
+            data.replace('\0', ' ');
+            return static_cast<size_t>(data.lastIndexOf('\n'));
+        });
+
+        ChunkScrubber scrubber;
+        measure("after", chunk, [&scrubber](QByteArray& data) {
+            const auto len = scrubber.process(data.data(), static_cast<size_t>(data.size()));
+            return len + scrubber.newlineOffsets().size();
+        });
+    }
+    return 0;
+}
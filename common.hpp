@@ -3,5 +3,8 @@
 
 static constexpr auto SETTINGS_LAST_USED_PORT = "lastUsedPort";
 static constexpr auto SETTINGS_BUFFER_SIZE = "bufferSize";
+static constexpr auto SETTINGS_REFRESH_RATE = "refreshRate";
+static constexpr auto SETTINGS_SHOW_TIMESTAMPS = "showTimestamps";
+static constexpr auto SETTINGS_HEX_VIEW = "hexView";
 
 #endif // COMMON_HPP
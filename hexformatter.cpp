@@ -0,0 +1,152 @@
+#include "hexformatter.hpp"
+
+#include <cstdint>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#define HEXFORMATTER_X86
+#endif
+
+static constexpr char HEX_DIGITS[] = "0123456789abcdef"; // NOLINT(cppcoreguidelines-avoid-c-arrays,modernize-avoid-c-arrays)
+static constexpr char FIRST_PRINTABLE = 0x20;
+static constexpr char LAST_PRINTABLE = 0x7E;
+static constexpr char REPLACEMENT = '.';
+
+static inline void toHexScalar(const char* data, size_t i, const size_t len, char* out)
+{
+    // NOLINTBEGIN(cppcoreguidelines-pro-bounds-pointer-arithmetic,cppcoreguidelines-pro-bounds-constant-array-index)
+    for (; i < len; i++) {
+        const auto byte = static_cast<uint8_t>(data[i]);
+        out[2 * i] = HEX_DIGITS[byte >> 4];
+        out[(2 * i) + 1] = HEX_DIGITS[byte & 0x0F];
+    }
+    // NOLINTEND(cppcoreguidelines-pro-bounds-pointer-arithmetic,cppcoreguidelines-pro-bounds-constant-array-index)
+}
+
+static inline void toPrintableScalar(const char* data, size_t i, const size_t len, char* out)
+{
+    // NOLINTBEGIN(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+    for (; i < len; i++) {
+        const auto c = data[i];
+        out[i] = (c >= FIRST_PRINTABLE && c <= LAST_PRINTABLE) ? c : REPLACEMENT;
+    }
+    // NOLINTEND(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+}
+
+#ifdef HEXFORMATTER_X86
+// Nibbles 0-15 to '0'-'9', 'a'-'f'
+static inline __m128i nibblesToHexSse2(const __m128i nibbles)
+{
+    const auto letters = _mm_and_si128(_mm_cmpgt_epi8(nibbles, _mm_set1_epi8(9)), _mm_set1_epi8('a' - '0' - 10));
+    return _mm_add_epi8(_mm_add_epi8(nibbles, _mm_set1_epi8('0')), letters);
+}
+
+static size_t toHexSse2(const char* data, const size_t len, char* out)
+{
+    constexpr size_t WIDTH = 16;
+    const auto lowNibble = _mm_set1_epi8(0x0F);
+    size_t i {};
+
+    // NOLINTBEGIN(cppcoreguidelines-pro-type-reinterpret-cast,cppcoreguidelines-pro-bounds-pointer-arithmetic)
+    for (; i + WIDTH <= len; i += WIDTH) {
+        const auto v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+        const auto high = _mm_and_si128(_mm_srli_epi16(v, 4), lowNibble);
+        const auto low = _mm_and_si128(v, lowNibble);
+        // High nibble first
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + (2 * i)), nibblesToHexSse2(_mm_unpacklo_epi8(high, low)));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + (2 * i) + WIDTH), nibblesToHexSse2(_mm_unpackhi_epi8(high, low)));
+    }
+    // NOLINTEND(cppcoreguidelines-pro-type-reinterpret-cast,cppcoreguidelines-pro-bounds-pointer-arithmetic)
+    return i;
+}
+
+static size_t toPrintableSse2(const char* data, const size_t len, char* out)
+{
+    constexpr size_t WIDTH = 16;
+    // Signed compares, bytes >= 0x80 are negative and replaced as well
+    const auto beforeFirst = _mm_set1_epi8(FIRST_PRINTABLE - 1);
+    const auto afterLast = _mm_set1_epi8(LAST_PRINTABLE + 1);
+    const auto replacement = _mm_set1_epi8(REPLACEMENT);
+    size_t i {};
+
+    // NOLINTBEGIN(cppcoreguidelines-pro-type-reinterpret-cast,cppcoreguidelines-pro-bounds-pointer-arithmetic)
+    for (; i + WIDTH <= len; i += WIDTH) {
+        const auto v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+        const auto printable = _mm_and_si128(_mm_cmpgt_epi8(v, beforeFirst), _mm_cmplt_epi8(v, afterLast));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), _mm_or_si128(_mm_and_si128(printable, v), _mm_andnot_si128(printable, replacement)));
+    }
+    // NOLINTEND(cppcoreguidelines-pro-type-reinterpret-cast,cppcoreguidelines-pro-bounds-pointer-arithmetic)
+    return i;
+}
+
+__attribute__((target("avx2"))) static inline __m256i nibblesToHexAvx2(const __m256i nibbles)
+{
+    const auto letters = _mm256_and_si256(_mm256_cmpgt_epi8(nibbles, _mm256_set1_epi8(9)), _mm256_set1_epi8('a' - '0' - 10));
+    return _mm256_add_epi8(_mm256_add_epi8(nibbles, _mm256_set1_epi8('0')), letters);
+}
+
+__attribute__((target("avx2"))) static size_t toHexAvx2(const char* data, const size_t len, char* out)
+{
+    constexpr size_t WIDTH = 32;
+    const auto lowNibble = _mm256_set1_epi8(0x0F);
+    size_t i {};
+
+    // NOLINTBEGIN(cppcoreguidelines-pro-type-reinterpret-cast,cppcoreguidelines-pro-bounds-pointer-arithmetic)
+    for (; i + WIDTH <= len; i += WIDTH) {
+        const auto v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+        const auto high = _mm256_and_si256(_mm256_srli_epi16(v, 4), lowNibble);
+        const auto low = _mm256_and_si256(v, lowNibble);
+        // Unpacking works within the 128-bit lanes: bytes 0-7 and 16-23, 8-15 and 24-31
+        const auto first = _mm256_unpacklo_epi8(high, low);
+        const auto second = _mm256_unpackhi_epi8(high, low);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + (2 * i)), nibblesToHexAvx2(_mm256_permute2x128_si256(first, second, 0x20)));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + (2 * i) + WIDTH), nibblesToHexAvx2(_mm256_permute2x128_si256(first, second, 0x31)));
+    }
+    // NOLINTEND(cppcoreguidelines-pro-type-reinterpret-cast,cppcoreguidelines-pro-bounds-pointer-arithmetic)
+    return i;
+}
+
+__attribute__((target("avx2"))) static size_t toPrintableAvx2(const char* data, const size_t len, char* out)
+{
+    constexpr size_t WIDTH = 32;
+    const auto beforeFirst = _mm256_set1_epi8(FIRST_PRINTABLE - 1);
+    const auto last = _mm256_set1_epi8(LAST_PRINTABLE);
+    const auto replacement = _mm256_set1_epi8(REPLACEMENT);
+    size_t i {};
+
+    // NOLINTBEGIN(cppcoreguidelines-pro-type-reinterpret-cast,cppcoreguidelines-pro-bounds-pointer-arithmetic)
+    for (; i + WIDTH <= len; i += WIDTH) {
+        const auto v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+        // There's no "less than" compare in AVX2
+        const auto printable = _mm256_andnot_si256(_mm256_cmpgt_epi8(v, last), _mm256_cmpgt_epi8(v, beforeFirst));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), _mm256_blendv_epi8(replacement, v, printable));
+    }
+    // NOLINTEND(cppcoreguidelines-pro-type-reinterpret-cast,cppcoreguidelines-pro-bounds-pointer-arithmetic)
+    return i;
+}
+
+static bool hasAvx2()
+{
+    static const bool result = __builtin_cpu_supports("avx2");
+    return result;
+}
+#endif
+
+void HexFormatter::toHex(const char* data, const size_t len, char* out)
+{
+    size_t done {};
+#ifdef HEXFORMATTER_X86
+    done = hasAvx2() ? toHexAvx2(data, len, out) : toHexSse2(data, len, out);
+#endif
+    // Remainder that doesn't fill a vector, or everything if SIMD is not available
+    toHexScalar(data, done, len, out);
+}
+
+void HexFormatter::toPrintable(const char* data, const size_t len, char* out)
+{
+    size_t done {};
+#ifdef HEXFORMATTER_X86
+    done = hasAvx2() ? toPrintableAvx2(data, len, out) : toPrintableSse2(data, len, out);
+#endif
+    toPrintableScalar(data, done, len, out);
+}
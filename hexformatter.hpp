@@ -0,0 +1,17 @@
+#ifndef HEXFORMATTER_HPP
+#define HEXFORMATTER_HPP
+
+#include <cstddef>
+
+// Byte to text conversions of the hex view, the bytes on screen are converted in one call per column.
+// Uses AVX2 or SSE2 when available: the nibbles of a whole vector are split, interleaved and mapped to digits with
+// compares instead of a table lookup per byte.
+class HexFormatter final {
+public:
+    // Writes two lowercase hex digits per byte, `out` must hold 2 * len chars
+    static void toHex(const char* data, const size_t len, char* out);
+    // Copies printable ASCII and replaces everything else with '.', `out` must hold len chars
+    static void toPrintable(const char* data, const size_t len, char* out);
+};
+
+#endif // HEXFORMATTER_HPP
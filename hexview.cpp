@@ -0,0 +1,187 @@
+#include "hexview.hpp"
+#include "hexformatter.hpp"
+#include "rawbytestore.hpp"
+
+#include <QFontDatabase>
+#include <QKeyEvent>
+#include <QPaintEvent>
+#include <QPainter>
+#include <QScrollBar>
+
+#include <algorithm>
+#include <array>
+#include <climits>
+
+// Space between the offsets and the data
+static constexpr int MARGIN = 4;
+// "xx " per byte and one more space in the middle of the row
+static constexpr size_t HEX_COLUMNS = (HexView::BYTES_PER_ROW * 3) + 1;
+static constexpr size_t ROW_COLUMNS = HEX_COLUMNS + 1 + HexView::BYTES_PER_ROW;
+static constexpr int MIN_OFFSET_DIGITS = 8;
+
+HexView::HexView(QWidget* parent)
+    : QAbstractScrollArea(parent)
+{
+    setFont(QFontDatabase::systemFont(QFontDatabase::FixedFont));
+    setFocusPolicy(Qt::StrongFocus);
+}
+
+void HexView::setStore(const RawByteStore* newStore)
+{
+    store = newStore;
+    firstRow = store ? store->begin() / BYTES_PER_ROW : 0;
+    updateScrollBars();
+    verticalScrollBar()->setValue(verticalScrollBar()->maximum());
+    viewport()->update();
+}
+
+void HexView::storeChanged()
+{
+    auto* bar = verticalScrollBar();
+    const auto following = bar->value() == bar->maximum();
+
+    // Rows that were trimmed from the front, the rows on screen stay where they are
+    const auto newFirstRow = store ? store->begin() / BYTES_PER_ROW : 0;
+    const auto removed = newFirstRow > firstRow ? newFirstRow - firstRow : 0;
+    firstRow = newFirstRow;
+    const auto value = static_cast<qint64>(bar->value()) - static_cast<qint64>(std::min<uint64_t>(removed, INT_MAX));
+
+    updateScrollBars();
+    bar->setValue(following ? bar->maximum() : static_cast<int>(std::max<qint64>(value, 0)));
+    viewport()->update();
+}
+
+uint64_t HexView::rowCount() const
+{
+    if (!store) {
+        return 0;
+    }
+    // Including the partial row at the end. The store trims in blocks, so its first byte always starts a row.
+    return ((store->end() + BYTES_PER_ROW - 1) / BYTES_PER_ROW) - (store->begin() / BYTES_PER_ROW);
+}
+
+int HexView::lineHeight() const
+{
+    return fontMetrics().height();
+}
+
+int HexView::visibleRows() const
+{
+    return std::max(1, viewport()->height() / lineHeight());
+}
+
+int HexView::offsetDigits() const
+{
+    int digits = MIN_OFFSET_DIGITS;
+    // NOLINTNEXTLINE(altera-id-dependent-backward-branch)
+    while (store && digits < 16 && (store->end() >> (4 * digits)) != 0) {
+        digits++;
+    }
+    return digits;
+}
+
+void HexView::updateScrollBars()
+{
+    const auto rows = visibleRows();
+    verticalScrollBar()->setPageStep(rows);
+    verticalScrollBar()->setSingleStep(1);
+    verticalScrollBar()->setRange(0, static_cast<int>(std::clamp<qint64>(static_cast<qint64>(rowCount()) - rows, 0, INT_MAX)));
+
+    const auto charWidth = fontMetrics().horizontalAdvance(u'M');
+    const auto gutter = (charWidth * offsetDigits()) + (3 * MARGIN);
+    const auto textWidth = viewport()->width() - gutter;
+    horizontalScrollBar()->setPageStep(std::max(textWidth, 1));
+    horizontalScrollBar()->setSingleStep(charWidth);
+    horizontalScrollBar()->setRange(0, std::max(0, (static_cast<int>(ROW_COLUMNS) * charWidth) - textWidth));
+}
+
+void HexView::paintEvent(QPaintEvent* event)
+{
+    QPainter painter(viewport());
+    const auto& pal = palette();
+    painter.fillRect(event->rect(), pal.base());
+    if (!store || !store->size()) {
+        return;
+    }
+
+    const auto rowHeight = lineHeight();
+    const auto viewWidth = viewport()->width();
+    const auto charWidth = fontMetrics().horizontalAdvance(u'M');
+    const auto ascent = fontMetrics().ascent();
+    const auto digits = offsetDigits();
+    const auto gutter = (charWidth * digits) + (3 * MARGIN);
+    const auto xOffset = horizontalScrollBar()->value();
+    const auto first = firstRow + static_cast<uint64_t>(verticalScrollBar()->value());
+    const auto last = std::min(first + static_cast<uint64_t>(visibleRows()) + 1, firstRow + rowCount());
+    if (first >= last) {
+        return;
+    }
+
+    // Everything on screen is converted at once, one pass per column
+    const auto wanted = static_cast<size_t>((last - first) * BYTES_PER_ROW);
+    bytes.resize(wanted);
+    hex.resize(2 * wanted);
+    printable.resize(wanted);
+    const auto count = store->copy(first * BYTES_PER_ROW, wanted, bytes.data());
+    HexFormatter::toHex(bytes.data(), count, hex.data());
+    HexFormatter::toPrintable(bytes.data(), count, printable.data());
+
+    painter.fillRect(0, 0, gutter - MARGIN, viewport()->height(), pal.alternateBase());
+
+    std::array<char, ROW_COLUMNS> line {};
+    for (auto row = first; row < last; row++) {
+        const auto rowStart = static_cast<size_t>(row - first) * BYTES_PER_ROW;
+        if (rowStart >= count) {
+            break;
+        }
+        const auto rowBytes = std::min<size_t>(BYTES_PER_ROW, count - rowStart);
+        const auto y = static_cast<int>(row - first) * rowHeight;
+
+        painter.setPen(pal.color(QPalette::PlaceholderText));
+        painter.drawText(QRect(0, y, gutter - (2 * MARGIN), rowHeight), Qt::AlignRight | Qt::AlignVCenter,
+            QStringLiteral("%1").arg(row * BYTES_PER_ROW, digits, 16, QLatin1Char('0')));
+
+        line.fill(' ');
+        // NOLINTBEGIN(cppcoreguidelines-pro-bounds-constant-array-index)
+        for (size_t i = 0; i < rowBytes; i++) {
+            const auto column = (i * 3) + (i >= BYTES_PER_ROW / 2 ? 1U : 0U);
+            line[column] = hex[2 * (rowStart + i)];
+            line[column + 1] = hex[(2 * (rowStart + i)) + 1];
+            line[HEX_COLUMNS + 1 + i] = printable[rowStart + i];
+        }
+        // NOLINTEND(cppcoreguidelines-pro-bounds-constant-array-index)
+
+        painter.setClipRect(gutter - MARGIN, 0, viewWidth - gutter + MARGIN, viewport()->height());
+        painter.setPen(pal.color(QPalette::Text));
+        painter.drawText(gutter - xOffset, y + ascent, QString::fromLatin1(line.data(), static_cast<qsizetype>(HEX_COLUMNS + 1 + rowBytes)));
+        painter.setClipping(false);
+    }
+}
+
+void HexView::resizeEvent(QResizeEvent* event)
+{
+    const auto following = verticalScrollBar()->value() == verticalScrollBar()->maximum();
+    QAbstractScrollArea::resizeEvent(event);
+    updateScrollBars();
+    if (following) {
+        verticalScrollBar()->setValue(verticalScrollBar()->maximum());
+    }
+}
+
+void HexView::scrollContentsBy(int /*dx*/, int /*dy*/)
+{
+    viewport()->update();
+}
+
+void HexView::keyPressEvent(QKeyEvent* event)
+{
+    if (event->matches(QKeySequence::MoveToStartOfDocument)) {
+        verticalScrollBar()->setValue(verticalScrollBar()->minimum());
+        return;
+    }
+    if (event->matches(QKeySequence::MoveToEndOfDocument)) {
+        verticalScrollBar()->setValue(verticalScrollBar()->maximum());
+        return;
+    }
+    QAbstractScrollArea::keyPressEvent(event);
+}
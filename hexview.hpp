@@ -0,0 +1,54 @@
+#ifndef HEXVIEW_HPP
+#define HEXVIEW_HPP
+
+#include <QAbstractScrollArea>
+
+#include <cstdint>
+#include <vector>
+
+class RawByteStore;
+
+// Hex dump of a RawByteStore, BYTES_PER_ROW bytes per row with the offset and the printable characters.
+// Nothing is converted when data arrives, the rows on screen are formatted from the store on every paint, so the view
+// costs the same whether the store holds a KiB or hundreds of MiB. Scrolled to the bottom it follows new data.
+class HexView final : public QAbstractScrollArea {
+    Q_OBJECT
+
+public:
+    static constexpr int BYTES_PER_ROW = 16;
+
+    explicit HexView(QWidget* parent = nullptr);
+    HexView(const HexView&) = delete;
+    HexView(HexView&&) = delete;
+    HexView& operator=(const HexView&) = delete;
+    HexView& operator=(HexView&&) = delete;
+    ~HexView() override = default;
+
+    void setStore(const RawByteStore* newStore);
+    // Must be called after the store has changed, before the next paint
+    void storeChanged();
+
+protected:
+    void paintEvent(QPaintEvent* event) override;
+    void resizeEvent(QResizeEvent* event) override;
+    void keyPressEvent(QKeyEvent* event) override;
+    void scrollContentsBy(int dx, int dy) override;
+
+private:
+    const RawByteStore* store {};
+    // First row of the store when the scroll bar was last updated, the scroll position is relative to it
+    uint64_t firstRow {};
+
+    // Reused by every paint
+    std::vector<char> bytes;
+    std::vector<char> hex;
+    std::vector<char> printable;
+
+    [[nodiscard]] uint64_t rowCount() const;
+    [[nodiscard]] int lineHeight() const;
+    [[nodiscard]] int visibleRows() const;
+    [[nodiscard]] int offsetDigits() const;
+    void updateScrollBars();
+};
+
+#endif // HEXVIEW_HPP
@@ -0,0 +1,18 @@
+#include "journalrecovery.hpp"
+#include "archivewriter.hpp"
+
+JournalRecovery::JournalRecovery(QObject* parent)
+    : QThread(parent)
+{
+}
+
+JournalRecovery::~JournalRecovery()
+{
+    wait();
+}
+
+void JournalRecovery::run()
+{
+    const auto result = ArchiveWriter::recoverJournals();
+    emit recovered(result.journals, result.bytes, result.failed);
+}
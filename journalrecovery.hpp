@@ -0,0 +1,28 @@
+#ifndef JOURNALRECOVERY_HPP
+#define JOURNALRECOVERY_HPP
+
+#include <QThread>
+
+// Runs ArchiveWriter::recoverJournals() at startup on a low priority thread of its own. Compressing up to
+// CaptureJournal::CAPACITY bytes for each journal left behind by a crash must not delay the window.
+class JournalRecovery final : public QThread {
+    Q_OBJECT
+
+public:
+    explicit JournalRecovery(QObject* parent = nullptr);
+    JournalRecovery(const JournalRecovery&) = delete;
+    JournalRecovery(JournalRecovery&&) = delete;
+    JournalRecovery& operator=(const JournalRecovery&) = delete;
+    JournalRecovery& operator=(JournalRecovery&&) = delete;
+    // Waits for the recovery to finish, the journals are only removed once their data is in an archive
+    ~JournalRecovery() override;
+
+signals:
+    // Emitted once all stale journals have been processed, `failed` are kept for the next start
+    void recovered(qsizetype journals, qint64 bytes, qsizetype failed);
+
+protected:
+    void run() override;
+};
+
+#endif // JOURNALRECOVERY_HPP
@@ -0,0 +1,113 @@
+#include "linetimestamps.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <ctime>
+#include <iterator>
+
+int64_t LineTimestamps::now()
+{
+    timespec ts {};
+    clock_gettime(CLOCK_BOOTTIME, &ts);
+    return static_cast<int64_t>(ts.tv_sec) * 1'000'000 + ts.tv_nsec / 1000;
+}
+
+int64_t LineTimestamps::toEpochMs(const int64_t timeUs)
+{
+    const auto epochMs = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+    return static_cast<int64_t>(epochMs) - (now() - timeUs) / 1000;
+}
+
+void LineTimestamps::append(const int64_t timeUs, const size_t length, const std::span<const size_t> newlineOffsets)
+{
+    if (!length) {
+        return;
+    }
+
+    if (!lineOpen) {
+        push(timeUs);
+        lineOpen = true;
+    }
+    // The line after a newline starts in this chunk unless the newline is its last byte
+    for (const auto offset : newlineOffsets) {
+        if (offset + 1 < length) {
+            push(timeUs);
+        } else {
+            lineOpen = false;
+        }
+    }
+}
+
+void LineTimestamps::push(const int64_t timeUs)
+{
+    // The clock is monotonic, but the readers only guarantee that the time of a chunk is close to its arrival
+    const auto arrivalUs = std::max(timeUs, lastTimeUs);
+    if (endLine - firstBlockLine == blocks.size() * BLOCK_LINES) {
+        blocks.push_back({ arrivalUs, removedBytes + deltas.size() });
+    } else {
+        auto delta = static_cast<uint64_t>(arrivalUs - lastTimeUs);
+        // NOLINTNEXTLINE(altera-id-dependent-backward-branch)
+        while (delta >= 0x80) {
+            deltas.push_back(static_cast<uint8_t>(delta | 0x80));
+            delta >>= 7;
+        }
+        deltas.push_back(static_cast<uint8_t>(delta));
+    }
+    lastTimeUs = arrivalUs;
+    endLine++;
+}
+
+void LineTimestamps::removeFront(const size_t count)
+{
+    firstLine = std::min(firstLine + count, endLine);
+
+    // The block holding the last line stays so that appending can go on
+    // NOLINTNEXTLINE(altera-id-dependent-backward-branch)
+    while (blocks.size() > 1 && firstBlockLine + BLOCK_LINES <= firstLine) {
+        blocks.pop_front();
+        firstBlockLine += BLOCK_LINES;
+        const auto bytes = blocks.front().offset - removedBytes;
+        deltas.erase(deltas.begin(), std::next(deltas.begin(), static_cast<std::ptrdiff_t>(bytes)));
+        removedBytes += bytes;
+    }
+}
+
+void LineTimestamps::clear()
+{
+    blocks.clear();
+    deltas.clear();
+    removedBytes = 0;
+    firstBlockLine = 0;
+    firstLine = 0;
+    endLine = 0;
+    lastTimeUs = 0;
+    lineOpen = false;
+}
+
+int64_t LineTimestamps::at(const size_t line) const
+{
+    const auto index = firstLine + line;
+    if (index >= endLine) {
+        return -1;
+    }
+
+    const auto& block = blocks[static_cast<size_t>((index - firstBlockLine) / BLOCK_LINES)];
+    auto pos = std::next(deltas.begin(), static_cast<std::ptrdiff_t>(block.offset - removedBytes));
+    auto timeUs = block.firstTimeUs;
+    // NOLINTNEXTLINE(altera-id-dependent-backward-branch)
+    for (auto i = (index - firstBlockLine) % BLOCK_LINES; i > 0; i--) {
+        uint64_t delta {};
+        unsigned shift {};
+        // NOLINTNEXTLINE(altera-id-dependent-backward-branch)
+        for (;;) {
+            const auto byte = *pos++;
+            delta |= static_cast<uint64_t>(byte & 0x7F) << shift;
+            if (!(byte & 0x80)) {
+                break;
+            }
+            shift += 7;
+        }
+        timeUs += static_cast<int64_t>(delta);
+    }
+    return timeUs;
+}
@@ -0,0 +1,56 @@
+#ifndef LINETIMESTAMPS_HPP
+#define LINETIMESTAMPS_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <span>
+
+// Arrival time of every line in the document, kept next to the text instead of in it. A line gets the time of the
+// chunk its first byte arrived in. Times are stored as the varint encoded difference to the previous line, most lines
+// arrive in the same chunk as their predecessor and take a single byte. Every BLOCK_LINES lines the absolute time is
+// stored so that a line can be looked up without decoding everything before it.
+// Line numbers match ScrollbackTracker: removeFront() is called with the number of lines trimmed from the document.
+class LineTimestamps final {
+public:
+    // CLOCK_BOOTTIME in µs, the clock all times in here are on. Unlike CLOCK_MONOTONIC it keeps counting while the
+    // system is suspended, so the age of a time is right across a suspend.
+    [[nodiscard]] static int64_t now();
+    // Maps a time from now() to ms since epoch: the current wall clock time minus the age of the time
+    [[nodiscard]] static int64_t toEpochMs(const int64_t timeUs);
+
+    // Account for `length` bytes that arrived at `timeUs`, `newlineOffsets` are the positions of '\n' in them
+    void append(const int64_t timeUs, const size_t length, const std::span<const size_t> newlineOffsets);
+    void removeFront(const size_t count);
+    void clear();
+
+    // -1 if the line hasn't received any data yet (the empty line after a trailing newline)
+    [[nodiscard]] int64_t at(const size_t line) const;
+    [[nodiscard]] size_t size() const { return static_cast<size_t>(endLine - firstLine); }
+
+private:
+    static constexpr uint64_t BLOCK_LINES = 64;
+
+    struct Block {
+        int64_t firstTimeUs {};
+        // Position in `deltas` of the delta of the block's second line, counting removed bytes
+        uint64_t offset {};
+    };
+
+    std::deque<Block> blocks;
+    std::deque<uint8_t> deltas;
+    // Bytes removed from the front of `deltas`
+    uint64_t removedBytes {};
+    // Index of the first line of blocks.front(), and of the first and one past the last stored line. They count
+    // from the last clear() so that a line's position in its block stays the same when lines are removed.
+    uint64_t firstBlockLine {};
+    uint64_t firstLine {};
+    uint64_t endLine {};
+    int64_t lastTimeUs {};
+    // The last line has received data and therefore a time
+    bool lineOpen {};
+
+    void push(const int64_t timeUs);
+};
+
+#endif // LINETIMESTAMPS_HPP
@@ -0,0 +1,113 @@
+#include "literalsearch.hpp"
+
+#include <bit>
+#include <cstring>
+#include <string_view>
+#include <utility>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#define LITERALSEARCH_X86
+#endif
+
+static size_t findScalar(const char* data, const size_t len, const size_t from, const std::string& needle)
+{
+    const auto pos = std::string_view(data, len).find(needle, from);
+    return (pos == std::string_view::npos) ? LiteralSearch::NOT_FOUND : pos;
+}
+
+// Checks the candidate positions in `mask`, the first and last byte are known to match
+static inline size_t checkCandidates(const char* data, const size_t blockStart, uint64_t mask, const std::string& needle)
+{
+    // NOLINTNEXTLINE(altera-id-dependent-backward-branch)
+    for (; mask; mask &= mask - 1) {
+        const auto pos = blockStart + static_cast<size_t>(std::countr_zero(mask));
+        // NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+        if (needle.size() <= 2 || memcmp(data + pos + 1, needle.data() + 1, needle.size() - 2) == 0) {
+            return pos;
+        }
+    }
+    return LiteralSearch::NOT_FOUND;
+}
+
+#ifdef LITERALSEARCH_X86
+static size_t findSse2(const char* data, const size_t len, size_t& pos, const std::string& needle)
+{
+    constexpr size_t WIDTH = 16;
+    const auto first = _mm_set1_epi8(needle.front());
+    const auto last = _mm_set1_epi8(needle.back());
+    const auto lastOffset = needle.size() - 1;
+
+    // NOLINTNEXTLINE(altera-id-dependent-backward-branch)
+    for (; pos + lastOffset + WIDTH <= len; pos += WIDTH) {
+        // NOLINTBEGIN(cppcoreguidelines-pro-type-reinterpret-cast,cppcoreguidelines-pro-bounds-pointer-arithmetic)
+        const auto blockFirst = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + pos));
+        const auto blockLast = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + pos + lastOffset));
+        // NOLINTEND(cppcoreguidelines-pro-type-reinterpret-cast,cppcoreguidelines-pro-bounds-pointer-arithmetic)
+        const auto mask = static_cast<uint32_t>(_mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(first, blockFirst), _mm_cmpeq_epi8(last, blockLast))));
+
+        if (const auto found = checkCandidates(data, pos, mask, needle); found != LiteralSearch::NOT_FOUND) {
+            return found;
+        }
+    }
+    return LiteralSearch::NOT_FOUND;
+}
+
+__attribute__((target("avx2"))) static size_t findAvx2(const char* data, const size_t len, size_t& pos, const std::string& needle)
+{
+    constexpr size_t WIDTH = 32;
+    const auto first = _mm256_set1_epi8(needle.front());
+    const auto last = _mm256_set1_epi8(needle.back());
+    const auto lastOffset = needle.size() - 1;
+
+    // Two blocks per iteration, candidates are rare in text so a single test usually skips both
+    // NOLINTNEXTLINE(altera-id-dependent-backward-branch)
+    for (; pos + lastOffset + (2 * WIDTH) <= len; pos += 2 * WIDTH) {
+        // NOLINTBEGIN(cppcoreguidelines-pro-type-reinterpret-cast,cppcoreguidelines-pro-bounds-pointer-arithmetic)
+        const auto* const block = reinterpret_cast<const __m256i*>(data + pos);
+        const auto* const blockLast = reinterpret_cast<const __m256i*>(data + pos + lastOffset);
+        const auto low = _mm256_and_si256(_mm256_cmpeq_epi8(first, _mm256_loadu_si256(block)), _mm256_cmpeq_epi8(last, _mm256_loadu_si256(blockLast)));
+        const auto high = _mm256_and_si256(_mm256_cmpeq_epi8(first, _mm256_loadu_si256(block + 1)), _mm256_cmpeq_epi8(last, _mm256_loadu_si256(blockLast + 1)));
+        // NOLINTEND(cppcoreguidelines-pro-type-reinterpret-cast,cppcoreguidelines-pro-bounds-pointer-arithmetic)
+        const auto any = _mm256_or_si256(low, high);
+        if (_mm256_testz_si256(any, any)) {
+            continue;
+        }
+
+        const auto mask = static_cast<uint64_t>(static_cast<uint32_t>(_mm256_movemask_epi8(low)))
+            | (static_cast<uint64_t>(static_cast<uint32_t>(_mm256_movemask_epi8(high))) << WIDTH);
+        if (const auto found = checkCandidates(data, pos, mask, needle); found != LiteralSearch::NOT_FOUND) {
+            return found;
+        }
+    }
+    return LiteralSearch::NOT_FOUND;
+}
+
+static bool hasAvx2()
+{
+    static const bool result = __builtin_cpu_supports("avx2");
+    return result;
+}
+#endif
+
+LiteralSearch::LiteralSearch(std::string newNeedle)
+    : needleStr(std::move(newNeedle))
+{
+}
+
+size_t LiteralSearch::find(const char* data, const size_t len, const size_t from) const
+{
+    if (needleStr.empty()) {
+        return (from <= len) ? from : NOT_FOUND;
+    }
+
+    auto pos = from;
+#ifdef LITERALSEARCH_X86
+    const auto found = hasAvx2() ? findAvx2(data, len, pos, needleStr) : findSse2(data, len, pos, needleStr);
+    if (found != NOT_FOUND) {
+        return found;
+    }
+#endif
+    // Remainder that doesn't fill a vector, or everything if SIMD is not available
+    return findScalar(data, len, pos, needleStr);
+}
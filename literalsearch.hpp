@@ -0,0 +1,25 @@
+#ifndef LITERALSEARCH_HPP
+#define LITERALSEARCH_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Substring search used to skip text that can't match before running a regular expression on it.
+// Compares the first and the last byte of the needle at every position of a block at once with AVX2 or SSE2 when
+// available and only checks the remaining bytes where both match.
+class LiteralSearch final {
+public:
+    static constexpr size_t NOT_FOUND = SIZE_MAX;
+
+    explicit LiteralSearch(std::string newNeedle);
+
+    // Offset of the first occurrence in data[from, len), NOT_FOUND if there is none
+    [[nodiscard]] size_t find(const char* data, const size_t len, const size_t from = 0) const;
+    [[nodiscard]] const std::string& needle() const { return needleStr; }
+
+private:
+    std::string needleStr;
+};
+
+#endif // LITERALSEARCH_HPP
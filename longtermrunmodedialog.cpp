@@ -1,6 +1,7 @@
 #include "longtermrunmodedialog.h"
 #include "ui_longtermrunmodedialog.h"
 
+#include <QCheckBox>
 #include <QDebug>
 #include <QDialog>
 #include <QDir>
@@ -9,12 +10,16 @@
 #include <QIntValidator>
 #include <QMessageBox>
 #include <QPushButton>
+#include <QSpinBox>
 #include <QStandardPaths>
 #include <QStringLiteral>
 #include <QToolButton>
 #include <QUuid>
 #include <QWidget>
 
+#include <algorithm>
+#include <array>
+
 LongTermRunModeDialog::LongTermRunModeDialog(QWidget* parent)
     : QDialog(parent)
     , ui(new Ui::LongTermRunModeDialog)
@@ -51,6 +56,17 @@ LongTermRunModeDialog::LongTermRunModeDialog(QWidget* parent)
     ui->memoryLineEdit->setValidator(new QIntValidator(1, 512, this)); // NOLINT(cppcoreguidelines-owning-memory)
     ui->timeLineEdit->setValidator(new QIntValidator(1, 60, this)); // NOLINT(cppcoreguidelines-owning-memory)
 
+    connect(ui->adaptiveCheckBox, &QCheckBox::toggled, this, &LongTermRunModeDialog::onAdaptiveToggled);
+    onAdaptiveToggled(ui->adaptiveCheckBox->isChecked());
+    connect(ui->dictionaryCheckBox, &QCheckBox::toggled, ui->dictionaryTrainingSpinBox, &QSpinBox::setEnabled);
+    ui->dictionaryTrainingSpinBox->setEnabled(ui->dictionaryCheckBox->isChecked());
+    connect(ui->recompressCheckBox, &QCheckBox::toggled, ui->recompressLevelSpinBox, &QSpinBox::setEnabled);
+    ui->recompressLevelSpinBox->setEnabled(ui->recompressCheckBox->isChecked());
+    if (!ArchiveFile::isIoUringAvailable()) {
+        ui->ioUringCheckBox->setEnabled(false);
+        ui->ioUringCheckBox->setToolTip(QStringLiteral("io_uring is not supported by this build or the kernel"));
+    }
+
     onInputChanged();
 }
 
@@ -89,11 +105,17 @@ void LongTermRunModeDialog::onInputChanged()
     }
     ui->buttonBox->button(QDialogButtonBox::StandardButton::Ok)->setEnabled(true);
 
-    ui->msgLabel->setText(QStringLiteral("yeTTY will save the serial data every %1 minutes or %2 MiB"
-                                         " (whichever is earlier) and clear the contents from memory(and view)")
+    ui->msgLabel->setText(QStringLiteral("yeTTY will compress the serial data as it arrives and start a new file every %1 minutes or %2 MiB"
+                                         " (whichever is earlier). Data is synced to storage every few seconds")
             .arg(QString::number(timeInMinutes), QString::number(memoryInMiB)));
 }
 
+void LongTermRunModeDialog::onAdaptiveToggled(const bool checked)
+{
+    ui->cpuBudgetSpinBox->setEnabled(checked);
+    ui->levelLabel->setText(checked ? QStringLiteral("Initial level") : QStringLiteral("Level"));
+}
+
 void LongTermRunModeDialog::onToolButton()
 {
     const auto tmp = QFileDialog::getExistingDirectory();
@@ -140,3 +162,35 @@ QUrl LongTermRunModeDialog::getDirectory() const
 {
     return directory;
 }
+
+ArchiveWriter::Compression LongTermRunModeDialog::getCompression() const
+{
+    ArchiveWriter::Compression compression;
+    compression.level = ui->levelSpinBox->value();
+    compression.adaptive = ui->adaptiveCheckBox->isChecked();
+    compression.cpuBudgetPercent = ui->cpuBudgetSpinBox->value();
+    compression.dictionary = ui->dictionaryCheckBox->isChecked();
+    compression.dictionaryTrainingMiB = ui->dictionaryTrainingSpinBox->value();
+    return compression;
+}
+
+ArchiveFile::Options LongTermRunModeDialog::getIoOptions() const
+{
+    static constexpr std::array DURABILITIES { ArchiveFile::Durability::Flush, ArchiveFile::Durability::Rotation, ArchiveFile::Durability::None };
+
+    ArchiveFile::Options options;
+    options.backend = ui->ioUringCheckBox->isChecked() ? ArchiveFile::Backend::IoUring : ArchiveFile::Backend::Pwrite;
+    options.durability = DURABILITIES.at(static_cast<size_t>(std::max(0, ui->durabilityComboBox->currentIndex())));
+    options.directIo = ui->directIoCheckBox->isChecked();
+    return options;
+}
+
+ArchiveRetention::Policy LongTermRunModeDialog::getRetention() const
+{
+    ArchiveRetention::Policy policy;
+    policy.quotaBytes = static_cast<qint64>(ui->quotaSpinBox->value()) * 1024 * 1024 * 1024;
+    policy.maxAgeMs = static_cast<qint64>(ui->maxAgeSpinBox->value()) * 24 * 60 * 60 * 1000;
+    policy.recompress = ui->recompressCheckBox->isChecked();
+    policy.recompressLevel = ui->recompressLevelSpinBox->value();
+    return policy;
+}
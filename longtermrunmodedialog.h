@@ -1,6 +1,9 @@
 #ifndef LONGTERMRUNMODEDIALOG_H
 #define LONGTERMRUNMODEDIALOG_H
 
+#include "archiveretention.hpp"
+#include "archivewriter.hpp"
+
 #include <QDialog>
 #include <QUrl>
 #include <QWidget>
@@ -24,10 +27,14 @@ public:
     [[nodiscard]] int getMemory() const;
     [[nodiscard]] bool isEnabled() const;
     [[nodiscard]] QUrl getDirectory() const;
+    [[nodiscard]] ArchiveWriter::Compression getCompression() const;
+    [[nodiscard]] ArchiveFile::Options getIoOptions() const;
+    [[nodiscard]] ArchiveRetention::Policy getRetention() const;
 
 private slots:
     void onInputChanged();
     void onToolButton();
+    void onAdaptiveToggled(bool checked);
 
 private:
     Ui::LongTermRunModeDialog* ui;
@@ -7,6 +7,8 @@
 #include <cstdlib>
 #include <exception>
 #include <iostream>
+#include <string>
+#include <string_view>
 
 #include <QApplication>
 #include <QDBusConnection>
@@ -16,6 +18,7 @@
 #include <QMessageBox>
 #include <QStandardPaths>
 
+#include "archiveviewer.hpp"
 #include "mainwindow.h"
 #include "yetty.version.h"
 
@@ -24,6 +27,8 @@ static void printUsageAndExit()
     fputs("Usage:", stderr); // NOLINT(cert-err33-c)
     fputs("\tserial port: yetty PORTNAME BAUDRATE\n", stderr); // NOLINT(cert-err33-c)
     fputs("\tstdin: yetty -\n", stderr); // NOLINT(cert-err33-c)
+    fputs("\tarchive: yetty FILE.txt.zst\n", stderr); // NOLINT(cert-err33-c)
+    fputs("\treplay: yetty --replay FILE [SPEED|max]\n", stderr); // NOLINT(cert-err33-c)
     exit(EXIT_FAILURE); // NOLINT(concurrency-mt-unsafe)
 }
 
@@ -66,13 +71,32 @@ int main(int argc, char* argv[])
     ::signal(SIGSEGV, &signal_handler); // NOLINT(cert-err33-c)
     ::signal(SIGABRT, &signal_handler); // NOLINT(cert-err33-c)
 
-    if (argc > 3) {
+    const auto replay = argc > 2 && std::string_view(argv[1]) == "--replay"; // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+    if (argc > (replay ? 4 : 3)) {
         printUsageAndExit();
     }
     auto srcType = SourceType::Unknown;
     QString portLocation;
+    QString archiveFilename;
     int baud {};
-    if (argc == 3) {
+    if (replay) {
+        // The speed is passed on in place of the baud rate
+        srcType = SourceType::Replay;
+        portLocation = QString::fromLocal8Bit(argv[2]); // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+        baud = 1;
+        if (argc == 4) {
+            const std::string_view speed(argv[3]); // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+            try {
+                baud = (speed == "max") ? 0 : std::stoi(std::string(speed));
+            } catch (std::exception& e) {
+                qCritical() << "Failed to parse speed: " << e.what();
+                printUsageAndExit();
+            }
+            if (baud < 0) {
+                printUsageAndExit();
+            }
+        }
+    } else if (argc == 3) {
         srcType = SourceType::Serial;
         portLocation = argv[1]; // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
         try {
@@ -87,6 +111,8 @@ int main(int argc, char* argv[])
             qCritical() << "port name is invalid: " << portLocation;
             printUsageAndExit();
         }
+    } else if (argc == 2 && QString::fromLocal8Bit(argv[1]).endsWith(QStringLiteral(".zst"))) { // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+        archiveFilename = QString::fromLocal8Bit(argv[1]); // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
     } else if (argc == 2) {
         srcType = SourceType::Stdin;
         portLocation = argv[1]; // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
@@ -114,6 +140,12 @@ int main(int argc, char* argv[])
     qSetMessagePattern(QStringLiteral("%{type}:%{function}():%{line} %{message}"));
 
     try {
+        if (!archiveFilename.isEmpty()) {
+            ArchiveViewer viewer(archiveFilename);
+            viewer.show();
+            return QApplication::exec();
+        }
+
         const auto appArg = argc > 1 ? std::optional<std::tuple<SourceType, QString, int>> { std::in_place, srcType, portLocation, baud }
                                      : std::nullopt;
         MainWindow w(appArg);
@@ -1,29 +1,40 @@
 #include "mainwindow.h"
 #include "./ui_mainwindow.h"
 #include "aboutdialog.hpp"
+#include "archiveretention.hpp"
+#include "archiveviewer.hpp"
+#include "archivewriter.hpp"
 #include "autobauddetection.h"
 #include "backgroundcolorchange.h"
 #include "common.hpp"
 #include "dbus_common.hpp"
+#include "hexview.hpp"
+#include "journalrecovery.hpp"
 #include "longtermrunmodedialog.h"
 #include "portalreadyinusedialog.h"
 #include "portselectiondialog.h"
+#include "rawcapture.hpp"
+#include "rawcapturewriter.hpp"
+#include "replayreader.hpp"
+#include "serialreader.hpp"
 #include "settingsdialog.hpp"
+#include "timestampgutter.hpp"
 #include "triggersetupdialog.h"
 #include "yetty.version.h"
 
+#include <KTextEditor/Attribute>
 #include <KTextEditor/Document>
 #include <KTextEditor/Editor>
 #include <KTextEditor/Message>
+#include <KTextEditor/MovingRange>
 #include <KTextEditor/View>
 
-#include <zstd.h>
-
+#include <algorithm>
 #include <array>
 #include <cerrno>
 #include <cstring>
+#include <fcntl.h>
 #include <grp.h>
-#include <iostream>
 #include <malloc.h>
 #include <pwd.h>
 #include <random>
@@ -33,6 +44,7 @@
 #include <utility>
 
 #include <QApplication>
+#include <QColor>
 #include <QCoreApplication>
 #include <QDBusConnection>
 #include <QDateTime>
@@ -40,9 +52,13 @@
 #include <QDir>
 #include <QEvent>
 #include <QFile>
+#include <QFileDialog>
+#include <QFileInfo>
 #include <QFileSystemWatcher>
 #include <QIODevice>
+#include <QInputDialog>
 #include <QKeyEvent>
+#include <QLocale>
 #include <QMainWindow>
 #include <QMessageBox>
 #include <QProcess>
@@ -66,12 +82,16 @@ MainWindow::MainWindow(const std::optional<std::tuple<SourceType, QString, int>>
     : QMainWindow(parent)
     , ui(new Ui::MainWindow)
     , fsWatcher(new QFileSystemWatcher(this))
-    , serialPort(new QSerialPort(this))
+    , serialPort(new SerialReader(this))
+    , replayReader(new ReplayReader(this))
     , sound(new QSoundEffect(this))
     , autoRetryTimer(new QTimer(this))
     , statusBarTimer(new QTimer(this))
     , statusBarText(new QLabel(this))
-    , longTermRunModeTimer(new QTimer(this))
+    , rxBufferLabel(new QLabel(this))
+    , archiveWriter(new ArchiveWriter(this))
+    , archiveRetention(new ArchiveRetention(this))
+    , rawCaptureWriter(new RawCaptureWriter(this))
 {
     loadSettings();
     QString portLocation;
@@ -85,10 +105,13 @@ MainWindow::MainWindow(const std::optional<std::tuple<SourceType, QString, int>>
     }
 
     Q_ASSERT(!portLocation.isEmpty());
-    if (srcType != SourceType::Stdin) {
+    if (srcType == SourceType::Serial) {
         Q_ASSERT(baud > 0);
-    } else {
+    } else if (srcType == SourceType::Stdin) {
         Q_ASSERT(baud < 0);
+    } else {
+        // The replay speed
+        Q_ASSERT(srcType == SourceType::Replay && baud >= 0);
     }
 
     elapsedTimer.start();
@@ -102,10 +125,24 @@ MainWindow::MainWindow(const std::optional<std::tuple<SourceType, QString, int>>
     view = doc->createView(this);
     view->setStatusBarEnabled(false);
 
+    timestampGutter = new TimestampGutter(lineTimestamps, this);
+    view->setAnnotationModel(timestampGutter);
+
     ui->verticalLayout->insertWidget(0, view);
 
+    hexView = new HexView(this);
+    hexView->setStore(&rawBytes);
+    hexView->hide();
+    ui->verticalLayout->insertWidget(1, hexView);
+
+    connect(replayReader, &ReplayReader::readyRead, this, &MainWindow::handleReplayReadyRead);
+    connect(replayReader, &ReplayReader::replayFinished, this, &MainWindow::handleReplayFinished);
+    connect(replayReader, &ReplayReader::replayFailed, this, &MainWindow::handleReplayFailed);
+
     if (srcType == SourceType::Stdin) {
         connectToStdin();
+    } else if (srcType == SourceType::Replay) {
+        connectToReplay(portLocation, baud);
     } else {
         Q_ASSERT(srcType == SourceType::Serial);
         connectToSerialDevice(portLocation, baud);
@@ -119,6 +156,12 @@ MainWindow::MainWindow(const std::optional<std::tuple<SourceType, QString, int>>
     ui->actionConnectToDevice->setShortcut(QKeySequence::Open);
     ui->actionConnectToDevice->setIcon(QIcon::fromTheme(QStringLiteral("document-open")));
 
+    connect(ui->actionOpenArchive, &QAction::triggered, this, &MainWindow::handleOpenArchiveAction);
+    ui->actionOpenArchive->setIcon(QIcon::fromTheme(QStringLiteral("archive-extract")));
+
+    connect(ui->actionReplay, &QAction::triggered, this, &MainWindow::handleReplayAction);
+    ui->actionReplay->setIcon(QIcon::fromTheme(QStringLiteral("media-playlist-repeat")));
+
     connect(ui->actionSave, &QAction::triggered, this, &MainWindow::handleSaveAction);
     ui->actionSave->setShortcut(QKeySequence::Save);
     ui->actionSave->setIcon(QIcon::fromTheme(QStringLiteral("document-save")));
@@ -149,6 +192,19 @@ MainWindow::MainWindow(const std::optional<std::tuple<SourceType, QString, int>>
     ui->actionBackground_color_change->setIcon(QIcon::fromTheme(QStringLiteral("color-profile")));
     connect(ui->actionBackground_color_change, &QAction::triggered, this, &MainWindow::handleBgColorChangeAction);
 
+    ui->actionShowTimestamps->setIcon(QIcon::fromTheme(QStringLiteral("chronometer")));
+    ui->actionShowTimestamps->setChecked(QSettings().value(SETTINGS_SHOW_TIMESTAMPS, false).toBool());
+    view->setAnnotationBorderVisible(ui->actionShowTimestamps->isChecked());
+    connect(ui->actionShowTimestamps, &QAction::toggled, this, &MainWindow::handleShowTimestampsAction);
+
+    ui->actionHexView->setIcon(QIcon::fromTheme(QStringLiteral("view-binary")));
+    ui->actionHexView->setChecked(QSettings().value(SETTINGS_HEX_VIEW, false).toBool());
+    handleHexViewAction(ui->actionHexView->isChecked());
+    connect(ui->actionHexView, &QAction::toggled, this, &MainWindow::handleHexViewAction);
+
+    ui->actionRawCapture->setIcon(QIcon::fromTheme(QStringLiteral("application-octet-stream")));
+    connect(ui->actionRawCapture, &QAction::triggered, this, &MainWindow::handleRawCaptureAction);
+
     // Trying to get the copy and find actions from KateViewInternal and put that into our mainwindow
     // Is there a better way to do this?
     for (auto& i : QApplication::allWidgets()) {
@@ -164,19 +220,28 @@ MainWindow::MainWindow(const std::optional<std::tuple<SourceType, QString, int>>
 
     connect(ui->startStopButton, &QPushButton::pressed, this, &MainWindow::handleStartStopButton);
 
-    connect(serialPort, &QSerialPort::readyRead, this, &MainWindow::handleReadyRead);
-    connect(serialPort, &QSerialPort::errorOccurred, this, &MainWindow::handleError);
+    connect(serialPort, &SerialReader::readyRead, this, &MainWindow::handleReadyRead);
+    connect(serialPort, &SerialReader::errorOccurred, this, &MainWindow::handleError);
 
     connect(autoRetryTimer, &QTimer::timeout, this, &MainWindow::handleRetryConnection);
     connect(statusBarTimer, &QTimer::timeout, this, &MainWindow::handleStatusBarTimer);
     statusBarTimer->setSingleShot(true);
-    connect(longTermRunModeTimer, &QTimer::timeout, this, &MainWindow::handleLongTermRunModeTimer);
+    connect(archiveWriter, &ArchiveWriter::fileWritten, this, &MainWindow::handleArchiveWritten);
+    connect(archiveWriter, &ArchiveWriter::writeFailed, this, &MainWindow::handleArchiveWriteFailed);
+    connect(archiveWriter, &ArchiveWriter::fileWritten, archiveRetention, &ArchiveRetention::schedule);
+    connect(rawCaptureWriter, &RawCaptureWriter::writeFailed, this, &MainWindow::handleRawCaptureFailed);
+    connect(rawCaptureWriter, &RawCaptureWriter::droppingStarted, this, &MainWindow::handleRawCaptureDropping);
+    // Data captured in long term run mode that didn't make it into an archive before a crash
+    auto* journalRecovery = new JournalRecovery(this); // NOLINT(cppcoreguidelines-owning-memory)
+    connect(journalRecovery, &JournalRecovery::recovered, this, &MainWindow::handleJournalsRecovered);
+    journalRecovery->start(QThread::LowPriority);
 
     connect(fsWatcher, &QFileSystemWatcher::fileChanged, this, &MainWindow::handleFileWatchEvent);
 
     sound->setSource(QUrl::fromLocalFile(QStringLiteral(":/notify.wav")));
 
     ui->statusbar->addWidget(statusBarText);
+    ui->statusbar->addPermanentWidget(rxBufferLabel);
 
     QDBusConnection connection = QDBusConnection::sessionBus();
 
@@ -199,6 +264,10 @@ MainWindow::MainWindow(const std::optional<std::tuple<SourceType, QString, int>>
     inactivityTimer = new QTimer(this); // NOLINT(cppcoreguidelines-owning-memory)
     connect(inactivityTimer, &QTimer::timeout, this, &MainWindow::executeTriggerAction);
 
+    docCommitTimer = new QTimer(this); // NOLINT(cppcoreguidelines-owning-memory)
+    docCommitTimer->setSingleShot(true);
+    connect(docCommitTimer, &QTimer::timeout, this, &MainWindow::commitPendingText);
+
     qDebug() << "Init complete in:" << elapsedTimer.elapsed();
 }
 
@@ -231,9 +300,17 @@ MainWindow::~MainWindow()
         sync();
     }
 
+    if (settings.value(SETTINGS_REFRESH_RATE, DEFAULT_REFRESH_RATE).toInt() != displayRefreshRate) {
+        settings.setValue(SETTINGS_REFRESH_RATE, displayRefreshRate);
+        sync();
+    }
+
+    // Make sure the queued archives make it to storage
+    archiveWriter->close();
+    archiveRetention->close();
+    rawCaptureWriter->close();
+    restoreStdinFlags();
     delete ui;
-    ZSTD_freeCCtx(zstdCtx);
-    zstdCtx = nullptr;
 }
 
 // NOLINTNEXTLINE(bugprone-easily-swappable-parameters)
@@ -267,57 +344,108 @@ void MainWindow::portName(QString& out)
     out = serialPort->portName();
 }
 
-void MainWindow::handleNewData(QByteArray newData)
+void MainWindow::handleNewData(QByteArray newData, const int64_t arrivalUs)
 {
+    if (rawCaptureWriter->isOpen()) {
+        // Before the scrubber touches the data, which makes it detach from the queued copy
+        rawCaptureWriter->append(newData, arrivalUs);
+    }
+    if (ui->actionHexView->isChecked()) {
+        rawBytes.append(newData.constData(), static_cast<size_t>(newData.size()));
+    }
+
     // Need to remove '\0' from the input or else we might mess up the text shown or
-    // affect string operation downstream
-    newData.replace('\0', ' ');
+    // affect string operation downstream. This also normalizes line endings and finds all newlines in one pass.
+    newData.resize(static_cast<qsizetype>(scrubber.process(newData.data(), static_cast<size_t>(newData.size()))));
+    const auto& newlines = scrubber.newlineOffsets();
 
-    processTriggers(newData);
+    processTriggers(newData, newlines);
 
-    if (!bgColorChangeStr.isEmpty()) {
-        if (newData.contains(bgColorChangeStr.toUtf8())) {
-            currentMark++;
-            if (currentMark > KTextEditor::Document::markType31) {
-                currentMark = KTextEditor::Document::markType01;
-            }
-        }
+    if (longTermRunModeEnabled) {
+        // Shares the buffer with pendingText, the writer thread only reads it
+        archiveWriter->append(newData, LineTimestamps::toEpochMs(arrivalUs));
+        archiveRetention->noteActivity();
     }
 
-    const auto linesStart = doc->lines();
+    if (!bgColorChangeMatcher.empty()) {
+        bool resetFound = false;
+        bgColorChangeMatcherState = bgColorChangeMatcher.search({ newData.constData(), static_cast<size_t>(newData.size()) },
+            bgColorChangeMatcherState, [&resetFound](size_t, size_t) { resetFound = true; });
 
-    doc->setReadWrite(true);
-    doc->insertText(doc->documentEnd(), newData);
-    doc->setReadWrite(false);
+        if (resetFound) {
+            // Text received before the reset keeps the previous color
+            commitPendingText();
+            startColorSegment();
+        }
+    }
 
-    const auto linesEnd = doc->lines();
+    lineTimestamps.append(arrivalUs, static_cast<size_t>(newData.size()), newlines);
+    const auto pendingSize = static_cast<size_t>(pendingText.size());
+    for (const auto offset : newlines) {
+        pendingNewlines.push_back(pendingSize + offset);
+    }
+    pendingText.append(newData);
+    if (!docCommitTimer->isActive()) {
+        docCommitTimer->start(1000 / displayRefreshRate);
+    }
+}
 
-    if (currentMark) {
-        for (int i = linesStart - 1; i <= linesEnd - 1; i++) {
-            doc->setMark(i, currentMark);
-        }
+size_t MainWindow::scrollbackLimit() const
+{
+    // With an unlimited buffer, long term run mode would otherwise keep everything in memory
+    size_t limit = static_cast<size_t>(txtBufferSize) * 1024;
+    if (!limit && longTermRunModeEnabled) {
+        limit = static_cast<size_t>(longTermRunModeMaxMemory) * 1024 * 1024;
     }
+    return limit;
+}
 
-    if (txtBufferSize) {
-        int loopLimit = 0xFFFF;
-        // We don't bother finding the exact number of bytes, we just keep removing lines till document character count
-        // falls below the threshold
-        while (static_cast<size_t>(doc->totalCharacters()) / 1024 > txtBufferSize) {
+void MainWindow::commitPendingText()
+{
+    docCommitTimer->stop();
+    // The hex view repaints at the same rate as the text, even if the data was all '\0'
+    const auto limit = scrollbackLimit();
+    rawBytes.trim(limit ? limit : MAX_RAW_BYTES);
+    hexView->storeChanged();
+    if (pendingText.isEmpty()) {
+        return;
+    }
 
-            // Make sure we don't end up in an infinite loop
-            loopLimit--;
-            if (loopLimit <= 0) {
-                qWarning() << "loop upper limit hit: " << doc->totalCharacters() << " " << doc->lines() << " " << txtBufferSize;
-                break;
-            }
+    // Everything below is a single edit, the view only updates once at the end of the transaction
+    const KTextEditor::Document::EditingTransaction transaction(doc);
+    doc->setReadWrite(true);
 
-            doc->setReadWrite(true);
-            if (!doc->removeLine(0)) {
-                qWarning() << "Failed to remove line: " << doc->totalCharacters() << " " << doc->lines() << " " << txtBufferSize;
+    // The current color segment expands to the right, so it covers the new text without any extra work
+    doc->insertText(doc->documentEnd(), QString::fromUtf8(pendingText));
+    scrollback.append(static_cast<size_t>(pendingText.size()), pendingNewlines);
+    pendingText.resize(0);
+    pendingNewlines.clear();
+
+    if (const auto bufferLimit = scrollbackLimit(); bufferLimit) {
+        const auto trimmed = scrollback.trim(bufferLimit);
+        if (const auto linesToRemove = trimmed.lines; linesToRemove) {
+            Q_ASSERT(scrollback.lineCount() == static_cast<size_t>(doc->lines()));
+            if (!doc->removeText(KTextEditor::Range(0, 0, static_cast<int>(linesToRemove), 0))) {
+                qWarning() << "Failed to remove lines: " << linesToRemove << " " << doc->lines() << " " << bufferLimit;
+            }
+            pruneColorSegments();
+            lineTimestamps.removeFront(linesToRemove);
+            timestampGutter->linesRemoved();
+        }
+        if (trimmed.partialLineBytes) {
+            // The tracker counts bytes, the document UTF-16 code units, which is the same for ASCII and close enough
+            // otherwise. Never cut a surrogate pair in half.
+            auto column = static_cast<int>(std::min<size_t>(trimmed.partialLineBytes, static_cast<size_t>(doc->lineLength(0))));
+            if (doc->characterAt(KTextEditor::Cursor(0, column)).isLowSurrogate()) {
+                column++;
+            }
+            if (!doc->removeText(KTextEditor::Range(0, 0, 0, column))) {
+                qWarning() << "Failed to shorten the last line: " << column << " " << doc->lineLength(0);
             }
-            doc->setReadWrite(false);
         }
     }
+
+    doc->setReadWrite(false);
 }
 
 void MainWindow::setProgramState(const ProgramState newState)
@@ -369,7 +497,58 @@ std::pair<QString, int> MainWindow::getPortFromUser()
 
 void MainWindow::handleReadyRead()
 {
-    handleNewData(serialPort->readAll());
+    auto newData = serialPort->readAll();
+    if (newData.isEmpty()) {
+        return;
+    }
+    handleNewReads(std::move(newData), serialPort->arrivalTimes());
+    updateRxBufferLabel();
+}
+
+void MainWindow::handleReplayReadyRead()
+{
+    auto newData = replayReader->readAll();
+    if (newData.isEmpty()) {
+        return;
+    }
+    handleNewReads(std::move(newData), replayReader->arrivalTimes());
+}
+
+void MainWindow::handleNewReads(QByteArray data, const std::vector<ArrivalQueue::Mark>& arrivals)
+{
+    const auto timeOf = [](const ArrivalQueue::Mark& mark) { return mark.timeUs >= 0 ? mark.timeUs : LineTimestamps::now(); };
+    if (arrivals.size() == 1) {
+        handleNewData(std::move(data), timeOf(arrivals.front()));
+        return;
+    }
+
+    // The GUI thread was behind, the line timestamps, the archive time index and the raw capture get the time of each
+    // read rather than that of the oldest one
+    for (size_t i = 0; i < arrivals.size(); i++) {
+        const auto start = static_cast<qsizetype>(arrivals[i].position);
+        const auto end = (i + 1 < arrivals.size()) ? static_cast<qsizetype>(arrivals[i + 1].position) : data.size();
+        handleNewData(data.sliced(start, end - start), timeOf(arrivals[i]));
+    }
+}
+
+void MainWindow::handleReplayFinished(qint64 bytes, qint64 elapsedMs)
+{
+    commitPendingText();
+    setProgramState(ProgramState::Stopped);
+
+    const auto seconds = static_cast<double>(std::max<qint64>(elapsedMs, 1)) / 1000;
+    const auto rate = static_cast<double>(bytes) / seconds / (1024 * 1024);
+    qInfo() << "Replayed" << bytes << "bytes in" << elapsedMs << "ms," << rate << "MiB/s";
+    statusBarText->setText(QStringLiteral("Replay finished: %1 in %2 s (%3 MiB/s)")
+            .arg(QLocale().formattedDataSize(bytes))
+            .arg(seconds, 0, 'f', 1)
+            .arg(rate, 0, 'f', 1));
+}
+
+void MainWindow::handleReplayFailed(const QString& error)
+{
+    setProgramState(ProgramState::Stopped);
+    statusBarText->setText(QStringLiteral("Replay failed: %1").arg(error));
 }
 
 void MainWindow::handleError(const QSerialPort::SerialPortError error)
@@ -410,22 +589,35 @@ void MainWindow::handleError(const QSerialPort::SerialPortError error)
 
 void MainWindow::handleSaveAction()
 {
+    commitPendingText();
     doc->documentSave();
 }
 
-void MainWindow::handleClearAction(const bool force)
+void MainWindow::handleClearAction()
 {
-    if (longTermRunModeEnabled && !force) {
-        QMessageBox::critical(this, QStringLiteral("Long term run mode active"),
-            QStringLiteral("Long term run mode is active, please disable it before attempting to clear text"));
-        return;
-    }
+    // The archive is written from the incoming data, clearing the view doesn't affect it
+    docCommitTimer->stop();
+    pendingText.resize(0);
+    pendingNewlines.clear();
+    scrollback.clear();
+    lineTimestamps.clear();
+    timestampGutter->linesRemoved();
+    // A '\r' before the clear must not swallow a '\n' after it
+    scrubber.reset();
+    rawBytes.clear();
+    hexView->storeChanged();
     doc->setReadWrite(true);
     doc->setModified(false);
     doc->closeUrl();
     if (!doc->setHighlightingMode(HIGHLIGHT_MODE)) {
         qWarning() << "Failed to set highlighting";
     }
+    // Keep using the current color for the text that follows
+    colorSegments.clear();
+    if (colorSegmentCounter) {
+        colorSegmentCounter--;
+        startColorSegment();
+    }
     void(malloc_trim(0));
     doc->setReadWrite(false);
 }
@@ -438,6 +630,11 @@ void MainWindow::handleQuitAction()
 
 void MainWindow::handleScrollToEnd()
 {
+    if (hexView->isVisible()) {
+        hexView->setFocus();
+        QCoreApplication::postEvent(hexView, new QKeyEvent(QEvent::KeyPress, Qt::Key_End, Qt::ControlModifier)); // NOLINT(cppcoreguidelines-owning-memory)
+        return;
+    }
     view->setFocus();
     QCoreApplication::postEvent(view, new QKeyEvent(QEvent::KeyPress, Qt::Key_End, Qt::ControlModifier)); // NOLINT(cppcoreguidelines-owning-memory)
 }
@@ -450,12 +647,13 @@ void MainWindow::handleAboutAction()
 
 void MainWindow::handleSettingsAction()
 {
-    SettingsDialog dlg(txtBufferSize, this);
+    SettingsDialog dlg(txtBufferSize, displayRefreshRate, this);
     if (dlg.exec() == QDialog::Accepted) {
         const auto newBufferSize = dlg.getBufferSize();
         if (newBufferSize != txtBufferSize) {
             txtBufferSize = newBufferSize;
         }
+        displayRefreshRate = dlg.getRefreshRate();
     }
 }
 
@@ -478,6 +676,50 @@ void MainWindow::handleConnectAction()
     }
 }
 
+void MainWindow::handleOpenArchiveAction()
+{
+    const auto filename = QFileDialog::getOpenFileName(this, QStringLiteral("Open archive"), longTermRunModePath,
+        QStringLiteral("Archives (*.txt.zst);;All files (*)"));
+    if (filename.isEmpty()) {
+        return;
+    }
+    // Independent of the capture, it keeps running while the archive is viewed
+    auto* const viewer = new ArchiveViewer(filename, this);
+    viewer->setWindowFlag(Qt::Window);
+    viewer->setAttribute(Qt::WA_DeleteOnClose);
+    viewer->show();
+}
+
+void MainWindow::handleReplayAction()
+{
+    if (longTermRunModeEnabled) {
+        QMessageBox::critical(this, QStringLiteral("Long term run mode active"),
+            QStringLiteral("Long term run mode is active, please disable it before starting a replay"));
+        return;
+    }
+    const auto filename = QFileDialog::getOpenFileName(this, QStringLiteral("Replay capture"), longTermRunModePath,
+        QStringLiteral("Captures (*.txt.zst *.yraw *.yraw.zst *.txt *.log);;All files (*)"));
+    if (filename.isEmpty()) {
+        return;
+    }
+
+    // Same order as SPEED_FACTORS
+    static const QStringList SPEEDS = { QStringLiteral("Maximum speed"), QStringLiteral("Original speed"), QStringLiteral("2x"),
+        QStringLiteral("5x"), QStringLiteral("10x"), QStringLiteral("100x") };
+    static constexpr std::array SPEED_FACTORS = { 0, 1, 2, 5, 10, 100 };
+    bool ok {};
+    const auto choice = QInputDialog::getItem(this, QStringLiteral("Replay capture"), QStringLiteral("Speed:"), SPEEDS, 1, false, &ok);
+    if (!ok) {
+        return;
+    }
+
+    stop();
+    autoRetryTimer->stop();
+    handleClearAction();
+    srcType = SourceType::Replay;
+    connectToReplay(filename, SPEED_FACTORS.at(static_cast<size_t>(SPEEDS.indexOf(choice))));
+}
+
 void MainWindow::handleTriggerSetupAction()
 {
     if (!triggerSetupDialog) {
@@ -493,11 +735,36 @@ void MainWindow::handleTriggerSetupDialogDone(int result)
         triggerType = triggerSetupDialog->getTriggerType();
 
         if (triggerType == TriggerSetupDialog::TriggerType::StringMatch) {
-            const auto newKeyword = triggerSetupDialog->getKeyword().toUtf8();
-            if (newKeyword != triggerKeyword) {
-                qInfo() << "Setting new trigger keyword: " << triggerKeyword << " " << newKeyword;
-                triggerKeyword = newKeyword;
-                triggerMatchCount = 0;
+            auto newRules = triggerSetupDialog->getRules();
+            if (newRules != triggerRules) {
+                qInfo() << "Setting new trigger rules: " << newRules.size();
+                triggerRules = std::move(newRules);
+
+                std::vector<std::string> keywords;
+                triggerLiteralRules.clear();
+                regexTriggers.clear();
+                for (size_t i = 0; i < triggerRules.size(); i++) {
+                    const auto& rule = triggerRules[i];
+                    if (rule.isRegex) {
+                        QRegularExpression expression(rule.keyword);
+                        // Compile and JIT now instead of on the first line received
+                        expression.optimize();
+                        if (!expression.isValid()) {
+                            qWarning() << "Ignoring invalid regex trigger" << rule.keyword << expression.errorString();
+                            continue;
+                        }
+                        regexTriggers.push_back({ i, std::move(expression) });
+                    } else {
+                        keywords.push_back(rule.keyword.toStdString());
+                        triggerLiteralRules.push_back(i);
+                    }
+                }
+                triggerMatcher = AhoCorasick(keywords);
+                triggerMatchCounts.assign(triggerRules.size(), 0);
+                triggerMatcherState = AhoCorasick::ROOT;
+                regexLineBuffer.clear();
+                regexStatsTimer.start();
+                statusBarText->setToolTip({});
             }
         }
 
@@ -586,21 +853,25 @@ void MainWindow::handleLongTermRunModeDialogDone(int result)
         longTermRunModeEnabled = longTermRunModeDialog->isEnabled();
 
         if (longTermRunModeEnabled) {
-            longTermRunModeTimer->start(5000);
             longTermRunModeMaxTime = longTermRunModeDialog->getMinutes();
             longTermRunModeMaxMemory = longTermRunModeDialog->getMemory();
-            longTermRunModeStartTime = elapsedTimer.elapsed();
             longTermRunModePath = longTermRunModeDialog->getDirectory().path();
 
             Q_ASSERT(!longTermRunModePath.isEmpty());
             qInfo() << "Long term run mode enabled:" << longTermRunModeMaxMemory << longTermRunModeMaxTime << longTermRunModePath;
+            archiveWriter->open(longTermRunModePath, getArchivePortName(),
+                static_cast<qint64>(longTermRunModeMaxMemory) * 1024 * 1024, static_cast<qint64>(longTermRunModeMaxTime) * 60 * 1000,
+                longTermRunModeDialog->getCompression(), longTermRunModeDialog->getIoOptions());
+            archiveRetention->open(longTermRunModePath, longTermRunModeDialog->getRetention());
             ui->LTRTextLabel->setText(QStringLiteral("Long term run mode active (location: %1)")
                     .arg(longTermRunModePath));
         } else {
             qInfo() << "Long term run mode disabled";
+            // Finishes writing whatever is still queued
+            archiveWriter->close();
+            archiveRetention->close();
             fileCounter = 0;
             errCtr = 0;
-            longTermRunModeTimer->stop();
         }
 
         ui->LTRIconLabel->setVisible(longTermRunModeEnabled);
@@ -608,52 +879,33 @@ void MainWindow::handleLongTermRunModeDialogDone(int result)
     }
 }
 
-void MainWindow::handleLongTermRunModeTimer()
+void MainWindow::handleArchiveWritten(const QString& filename, const qint64 size, const qint64 latencyMs, const qsizetype queueDepth)
 {
-    Q_ASSERT(elapsedTimer.elapsed() > longTermRunModeStartTime);
-
-    const auto timeSinceLastSave = elapsedTimer.elapsed() - longTermRunModeStartTime;
-    bool shouldSave {};
-    if (timeSinceLastSave > (static_cast<qint64>(longTermRunModeMaxTime) * 60 * 1000)) {
-        shouldSave = true;
-        qInfo() << "Time since last save: " << timeSinceLastSave;
-    }
+    qInfo() << "Archive written:" << filename << size << "bytes, latency:" << latencyMs << "ms queue depth:" << queueDepth;
+    fileCounter++;
+    updateLongTermRunModeLabel(QStringLiteral(", last rotation took %1 ms, %2 queued").arg(latencyMs).arg(queueDepth));
+}
 
-    if (const auto textSize = doc->text().size(); textSize > (longTermRunModeMaxMemory * 1024 * 1024)) {
-        shouldSave = true;
-        qInfo() << "text size: " << textSize;
-    }
+void MainWindow::handleArchiveWriteFailed(const QString& error, const qsizetype queueDepth)
+{
+    errCtr++;
+    updateLongTermRunModeLabel(QStringLiteral(", %1 queued").arg(queueDepth));
 
-    if (shouldSave) {
-        longTermRunModeStartTime = elapsedTimer.elapsed();
+    if (!longTermRunModeErrMsgActive) {
+        longTermRunModeErrMsgActive = true;
+        auto* msg = new KTextEditor::Message(error, KTextEditor::Message::Error); // NOLINT(cppcoreguidelines-owning-memory)
 
-        const auto utfTxt = doc->text().toUtf8();
-        if (utfTxt.isEmpty()) {
-            qInfo() << "Nothing to save";
-            return;
-        }
-        try {
-            writeCompressedFile(utfTxt);
-            handleClearAction(true);
-        } catch (std::exception& e) {
-            // In case of errors we don't clear the logs, hopefully in the next attempt it would work
-            qCritical() << e.what();
-            errCtr++;
-
-            if (!longTermRunModeErrMsgActive) {
-                longTermRunModeErrMsgActive = true;
-                auto* msg = new KTextEditor::Message(e.what(), KTextEditor::Message::Error); // NOLINT(cppcoreguidelines-owning-memory)
-
-                connect(msg, &KTextEditor::Message::closed, this, [this](KTextEditor::Message*) { longTermRunModeErrMsgActive = false; });
-                doc->postMessage(msg);
-            }
-        }
+        connect(msg, &KTextEditor::Message::closed, this, [this](KTextEditor::Message*) { longTermRunModeErrMsgActive = false; });
+        doc->postMessage(msg);
+    }
+}
 
-        const QString errStr = errCtr ? (QStringLiteral(" <b>(%1 errors)</b>").arg(QString::number(errCtr))) : QLatin1String("");
+void MainWindow::updateLongTermRunModeLabel(const QString& extra)
+{
+    const QString errStr = errCtr ? (QStringLiteral(" <b>(%1 errors)</b>").arg(QString::number(errCtr))) : QLatin1String("");
 
-        ui->LTRTextLabel->setText(QStringLiteral("Long term run mode active (%1 files%2 saved in %3)")
-                .arg(QString::number(fileCounter), errStr, longTermRunModePath));
-    }
+    ui->LTRTextLabel->setText(QStringLiteral("Long term run mode active (%1 files%2 saved in %3%4)")
+            .arg(QString::number(fileCounter), errStr, longTermRunModePath, extra));
 }
 
 void MainWindow::handleFileWatchEvent(const QString& path)
@@ -695,7 +947,96 @@ void MainWindow::handleBgColorChangeAction()
 {
     auto dlg = std::make_unique<BackgroundColorChange>(bgColorChangeStr, this);
     dlg->exec();
-    bgColorChangeStr = dlg->getString();
+    if (const auto newStr = dlg->getString(); newStr != bgColorChangeStr) {
+        bgColorChangeStr = newStr;
+        bgColorChangeMatcher = bgColorChangeStr.isEmpty() ? AhoCorasick() : AhoCorasick({ bgColorChangeStr.toStdString() });
+        bgColorChangeMatcherState = AhoCorasick::ROOT;
+    }
+}
+
+void MainWindow::handleShowTimestampsAction(bool checked)
+{
+    view->setAnnotationBorderVisible(checked);
+    QSettings settings;
+    settings.setValue(SETTINGS_SHOW_TIMESTAMPS, checked);
+}
+
+void MainWindow::handleHexViewAction(bool checked)
+{
+    // The hex view starts with the data received from now on, the raw bytes aren't kept while it's off
+    view->setVisible(!checked);
+    hexView->setVisible(checked);
+    if (checked) {
+        hexView->storeChanged();
+        hexView->setFocus();
+    } else {
+        rawBytes.clear();
+        hexView->storeChanged();
+        view->setFocus();
+    }
+    QSettings settings;
+    settings.setValue(SETTINGS_HEX_VIEW, checked);
+}
+
+void MainWindow::handleRawCaptureAction(bool checked)
+{
+    if (!checked) {
+        rawCaptureWriter->close();
+        statusBarText->setText(QStringLiteral("Raw capture saved to %1").arg(rawCaptureWriter->fileName()));
+        return;
+    }
+
+    const auto directory = longTermRunModePath.isEmpty() ? QDir::homePath() : longTermRunModePath;
+    const auto suggestion = QDir(directory).filePath(QStringLiteral("%1_%2%3").arg(getArchivePortName(),
+        QDateTime::currentDateTime().toString(QStringLiteral("yyyy-MM-dd-hh_mm-ss")), RawCapture::compressedSuffix()));
+    auto filename = QFileDialog::getSaveFileName(this, QStringLiteral("Raw capture"), suggestion,
+        QStringLiteral("Compressed raw captures (*.yraw.zst);;Raw captures (*.yraw)"));
+    if (filename.isEmpty()) {
+        ui->actionRawCapture->setChecked(false);
+        return;
+    }
+    // Replay recognizes raw captures by their suffix
+    if (!RawCapture::isRawCapture(filename)) {
+        filename += RawCapture::compressedSuffix();
+    }
+
+    try {
+        const auto compressed = filename.endsWith(RawCapture::compressedSuffix());
+        rawCaptureWriter->open(filename, compressed ? RawCaptureWriter::DEFAULT_COMPRESSION_LEVEL : 0);
+    } catch (std::exception& e) {
+        ui->actionRawCapture->setChecked(false);
+        QMessageBox::critical(this, QStringLiteral("Error"), QStringLiteral("Failed to start the raw capture: %1").arg(QString::fromUtf8(e.what())));
+        return;
+    }
+    qInfo() << "Raw capture to" << filename;
+    statusBarText->setText(QStringLiteral("Raw capture to %1").arg(filename));
+}
+
+void MainWindow::handleJournalsRecovered(const qsizetype journals, const qint64 bytes, const qsizetype failed)
+{
+    if (journals) {
+        statusBarText->setText(QStringLiteral("Recovered %1 KiB captured before yeTTY stopped unexpectedly").arg(bytes / 1024));
+    }
+    if (failed) {
+        auto* msg = new KTextEditor::Message( // NOLINT(cppcoreguidelines-owning-memory)
+            QStringLiteral("Failed to recover %1 capture journal(s) into archives, see the log. Trying again at the next start.").arg(failed),
+            KTextEditor::Message::Warning);
+        doc->postMessage(msg);
+    }
+}
+
+void MainWindow::handleRawCaptureFailed(const QString& error)
+{
+    rawCaptureWriter->close();
+    ui->actionRawCapture->setChecked(false);
+
+    auto* msg = new KTextEditor::Message(QStringLiteral("Raw capture stopped: %1").arg(error), KTextEditor::Message::Error); // NOLINT(cppcoreguidelines-owning-memory)
+    doc->postMessage(msg);
+}
+
+void MainWindow::handleRawCaptureDropping()
+{
+    statusBarText->setText(QStringLiteral("Raw capture can't keep up with the storage, data is being dropped"));
 }
 
 void MainWindow::start()
@@ -707,6 +1048,9 @@ void MainWindow::start()
     case SourceType::Stdin:
         connectToStdin();
         break;
+    case SourceType::Replay:
+        connectToReplay(replayReader->filename(), replayReader->speed());
+        break;
     case SourceType::Unknown:
         [[fallthrough]];
     default:
@@ -724,6 +1068,9 @@ void MainWindow::stop()
     case SourceType::Stdin:
         closeStdin();
         break;
+    case SourceType::Replay:
+        closeReplay();
+        break;
     case SourceType::Unknown:
         [[fallthrough]];
     default:
@@ -749,32 +1096,103 @@ void MainWindow::handleSocketNotifierActivated(QSocketDescriptor socket, QSocket
         return;
     }
 
-    if (std::string line; std::getline(std::cin, line)) {
-        handleNewData((line + "\n").c_str());
-    } else {
-        // Handle EOF in input
-        std::cin.clear();
+    // stdin is non-blocking, keep reading until there is nothing left
+    for (int i = 0; i < STDIN_MAX_READS_PER_WAKEUP; i++) {
+        const auto result = ::read(STDIN_FILENO, stdinBuffer.data(), stdinBuffer.size());
+
+        if (result > 0) {
+            handleNewData(QByteArray(stdinBuffer.data(), result), LineTimestamps::now());
+            continue;
+        }
+
+        if (result < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                qWarning() << "Failed to read stdin:" << getErrorStr().c_str();
+            }
+            return;
+        }
+
+        // Handle EOF in input. The file description is about to be closed, give it back the way we found it.
+        restoreStdinFlags();
         if (freopen("/dev/tty", "r", stdin) == nullptr) { // NOLINT(cppcoreguidelines-owning-memory)
             qCritical() << "Failed to reopen stdin" << errno;
+            // Nothing more to read, stop the notifier from firing on EOF forever
+            sockNotifier->setEnabled(false);
+            return;
         }
-        qInfo() << std::cin.good() << std::cin.eof();
+        setStdinNonBlocking();
+        qInfo() << "EOF on stdin";
+        return;
     }
 }
 
+void MainWindow::setStdinNonBlocking()
+{
+    const auto flags = fcntl(STDIN_FILENO, F_GETFL);
+    if (flags < 0 || fcntl(STDIN_FILENO, F_SETFL, flags | O_NONBLOCK) < 0) {
+        qWarning() << "Failed to make stdin non-blocking:" << getErrorStr().c_str();
+        return;
+    }
+    stdinOriginalFlags = flags;
+}
+
+void MainWindow::restoreStdinFlags()
+{
+    if (stdinOriginalFlags < 0) {
+        return;
+    }
+    if (fcntl(STDIN_FILENO, F_SETFL, stdinOriginalFlags) < 0) {
+        qWarning() << "Failed to restore stdin flags:" << getErrorStr().c_str();
+    }
+    stdinOriginalFlags = -1;
+}
+
 void MainWindow::connectToStdin()
 {
     Q_ASSERT(sockNotifier == nullptr);
+    // Line ending state carried over from the previous connection or source
+    scrubber.reset();
+
+    stdinBuffer.resize(STDIN_BUFFER_SIZE);
+    setStdinNonBlocking();
 
-    sockNotifier = new QSocketNotifier(fileno(stdin), QSocketNotifier::Read, this); // NOLINT(cppcoreguidelines-owning-memory)
+    sockNotifier = new QSocketNotifier(STDIN_FILENO, QSocketNotifier::Read, this); // NOLINT(cppcoreguidelines-owning-memory)
     connect(sockNotifier, &QSocketNotifier::activated, this, &MainWindow::handleSocketNotifierActivated);
     setProgramState(ProgramState::Started);
 
     ui->portInfoLabel->setText(QStringLiteral("stdin"));
 }
 
+void MainWindow::connectToReplay(const QString& filename, const int speed)
+{
+    Q_ASSERT(srcType == SourceType::Replay);
+    // Line ending state carried over from the previous connection or source
+    scrubber.reset();
+    replayReader->close();
+    replayReader->setFilename(filename);
+    replayReader->setSpeed(speed);
+
+    setWindowTitle(QFileInfo(filename).fileName());
+    ui->portInfoLabel->setText(QStringLiteral("Replay: %1 | %2").arg(filename, speed ? QStringLiteral("%1x").arg(speed) : QStringLiteral("maximum speed")));
+
+    qInfo() << "Replaying" << filename << "at speed" << speed;
+    if (!replayReader->open()) {
+        QMessageBox::warning(this, QStringLiteral("Replay failed"), replayReader->errorString());
+        ui->startStopButton->setEnabled(false);
+        return;
+    }
+    ui->startStopButton->setEnabled(true);
+    setProgramState(ProgramState::Started);
+}
+
 void MainWindow::connectToSerialDevice(const QString& port, const int baud, const bool showMsgOnOpenErr)
 {
     Q_ASSERT(srcType == SourceType::Serial);
+    // Line ending state carried over from the previous connection or source
+    scrubber.reset();
     serialPort->setPortName(port);
     serialPort->setBaudRate(baud);
 
@@ -794,9 +1212,7 @@ void MainWindow::connectToSerialDevice(const QString& port, const int baud, cons
     if (autoRetryCounter <= 1) {
         qInfo() << "Connecting to: " << port << baud;
     }
-    serialPort->clearError();
-
-    if (serialPort->open(QIODevice::ReadOnly)) {
+    if (serialPort->open()) {
         manufacturer = tmpManufacturer;
         description = tmpDescription;
         serialNumber = tmpSerialNumber;
@@ -948,25 +1364,29 @@ void MainWindow::executeTriggerAction()
     case TriggerSetupDialog::TriggerActionType::PlaySound:
         audioAlert();
         break;
-    case TriggerSetupDialog::TriggerActionType::ExecuteCommand: {
-        auto parts = triggerSetupDialog->getTriggerActionCommand().split(' ');
-        Q_ASSERT(!parts.isEmpty());
-
-        auto* process = new QProcess(this); // NOLINT(cppcoreguidelines-owning-memory)
-        process->setProgram(parts.at(0));
+    case TriggerSetupDialog::TriggerActionType::ExecuteCommand:
+        executeCommand(triggerSetupDialog->getTriggerActionCommand());
+        break;
+    default:
+        Q_ASSERT(false);
+    }
+}
 
-        if (parts.size() > 1) {
-            parts.removeFirst();
-            process->setArguments(parts);
-        }
+void MainWindow::executeCommand(const QString& command)
+{
+    auto parts = command.split(' ');
+    Q_ASSERT(!parts.isEmpty());
 
-        connect(process, &QProcess::finished, process, &QObject::deleteLater);
-        process->start();
+    auto* process = new QProcess(this); // NOLINT(cppcoreguidelines-owning-memory)
+    process->setProgram(parts.at(0));
 
-    } break;
-    default:
-        Q_ASSERT(false);
+    if (parts.size() > 1) {
+        parts.removeFirst();
+        process->setArguments(parts);
     }
+
+    connect(process, &QProcess::finished, process, &QObject::deleteLater);
+    process->start();
 }
 
 void MainWindow::audioAlert()
@@ -984,85 +1404,22 @@ std::string MainWindow::getErrorStr()
     return errStr ? errStr : "";
 }
 
-void MainWindow::writeCompressedFile(const QByteArray& contents)
+QString MainWindow::getArchivePortName() const
 {
-    const auto contentsLen = contents.size();
-
-    if (!contentsLen) {
-        qWarning() << "Attempt to write empty file";
-        return;
-    }
-
-    QString portName = QStringLiteral("yetty");
-
     switch (srcType) {
     case SourceType::Serial:
-        portName = serialPort->portName();
-        break;
+        return serialPort->portName();
     case SourceType::Stdin:
-        portName = QStringLiteral("stdin");
-        break;
+        return QStringLiteral("stdin");
+    case SourceType::Replay:
+        return QStringLiteral("replay");
     case SourceType::Unknown:
         [[fallthrough]];
     default:
         Q_ASSERT(false);
         break;
     }
-
-    const auto curDate = QDateTime::currentDateTime();
-    const auto filename = QString(QStringLiteral("%1/%2_%3_%4.txt.zst"))
-                              .arg(longTermRunModePath, portName,
-                                  curDate.toString(QStringLiteral("yyyy-MM-dd-hh_mm-ss")),
-                                  (QStringLiteral("%1").arg(fileCounter, 8, 10, QLatin1Char('0'))));
-
-    qInfo() << "Saving" << filename << contentsLen << "bytes";
-
-    QFile file(filename);
-    if (const auto result = file.open(QIODevice::WriteOnly | QIODevice::NewOnly); !result) {
-        const auto msg = QString(QStringLiteral("Failed to open: %1 %2")).arg(filename, file.errorString());
-        qCritical() << msg;
-        throw std::runtime_error(msg.toStdString());
-    }
-
-    if (!zstdCtx) {
-        zstdCtx = ZSTD_createCCtx();
-        if (!zstdCtx) {
-            throw std::runtime_error("Failed to create zstd ctx");
-        }
-        validateZstdResult(ZSTD_CCtx_setParameter(zstdCtx, ZSTD_c_checksumFlag, 1));
-        validateZstdResult(ZSTD_CCtx_setParameter(zstdCtx, ZSTD_c_strategy, ZSTD_fast));
-        zstdOutBuffer.resize(ZSTD_CStreamOutSize()); // This returns approx 128KiB
-    } else {
-        validateZstdResult(ZSTD_CCtx_reset(zstdCtx, ZSTD_reset_session_only));
-    }
-
-    Q_ASSERT(contentsLen > 0);
-    ZSTD_inBuffer input = { contents.data(), static_cast<size_t>(contentsLen), 0 };
-
-    bool finished {};
-
-    // NOLINTNEXTLINE(altera-id-dependent-backward-branch)
-    while (!finished) {
-        ZSTD_outBuffer out = { zstdOutBuffer.data(), zstdOutBuffer.size(), 0 };
-        const auto remaining = ZSTD_compressStream2(zstdCtx, &out, &input, ZSTD_e_end);
-        validateZstdResult(remaining);
-
-        file.write(zstdOutBuffer.data(), static_cast<qint64>(out.pos));
-
-        finished = (remaining == 0);
-    }
-
-    file.flush();
-    fsync(file.handle());
-    file.close();
-    fileCounter++;
-}
-
-void MainWindow::validateZstdResult(const size_t result, const std::experimental::source_location& srcLoc)
-{
-    if (ZSTD_isError(result)) {
-        throw std::runtime_error(std::string("ZSTD error: ") + ZSTD_getErrorName(result) + " " + std::to_string(srcLoc.line()));
-    }
+    return QStringLiteral("yetty");
 }
 
 QString MainWindow::getSerialPortPath() const
@@ -1077,14 +1434,20 @@ void MainWindow::closeStdin()
     sockNotifier->setEnabled(false);
     delete sockNotifier;
     sockNotifier = nullptr;
+    restoreStdinFlags();
+}
+
+void MainWindow::closeReplay()
+{
+    Q_ASSERT(srcType == SourceType::Replay);
+    replayReader->close();
 }
 
 void MainWindow::closeSerialPort()
 {
     Q_ASSERT(srcType == SourceType::Serial);
-    if (serialPort->isOpen()) {
-        serialPort->close();
-    }
+    // Also joins a reader thread that has already exited due to an error
+    serialPort->close();
 }
 
 std::tuple<QString, QString, QString> MainWindow::getPortInfo(QString portLocation)
@@ -1220,39 +1583,42 @@ void MainWindow::handlePortAccessError(const QString& port)
     qWarning() << "Permission denied, possibly just enumerated";
 }
 
-int MainWindow::stringMatchCount(QByteArray haystack, const QByteArray& needle)
-{
-    qsizetype idx {};
-    int count {};
-
-    while ((idx = haystack.indexOf(needle)) >= 0) {
-        count++;
-        haystack.slice(idx + needle.size());
-    }
-
-    return count;
-}
-
-void MainWindow::processTriggers(const QByteArray& newData)
+void MainWindow::processTriggers(const QByteArray& newData, const std::vector<size_t>& newlines)
 {
     if (triggerType == TriggerSetupDialog::TriggerType::Disabled) {
         return;
     }
 
     if (triggerType == TriggerSetupDialog::TriggerType::StringMatch) {
-        triggerSearchLine.append(newData);
+        // Rules that matched in this chunk, each one is executed once. Every occurrence is reported exactly once,
+        // in the chunk that contains its last byte.
+        std::vector<size_t> matchedRules;
+        triggerMatcherState = triggerMatcher.search({ newData.constData(), static_cast<size_t>(newData.size()) }, triggerMatcherState,
+            [this, &matchedRules](const size_t pattern, size_t) {
+                const auto rule = triggerLiteralRules[pattern];
+                triggerMatchCounts[rule]++;
+                if (std::find(matchedRules.begin(), matchedRules.end(), rule) == matchedRules.end()) {
+                    matchedRules.push_back(rule);
+                }
+            });
+
+        if (!regexTriggers.empty()) {
+            matchRegexTriggers(newData, newlines, matchedRules);
+            updateRegexTriggerStats();
+        }
 
-        if (triggerSearchLine.contains(triggerKeyword)) {
-            triggerMatchCount += stringMatchCount(triggerSearchLine, triggerKeyword);
-            statusBarText->setText(QStringLiteral("<b>%1 matches for %2</b>").arg(triggerMatchCount).arg(triggerKeyword.data()));
+        if (!matchedRules.empty()) {
+            const auto lastRule = matchedRules.back();
+            statusBarText->setText(QStringLiteral("<b>%1 matches for %2</b>").arg(triggerMatchCounts[lastRule]).arg(triggerRules[lastRule].keyword));
             statusBarTimer->start(5000);
 
-            executeTriggerAction();
-            triggerSearchLine.resize(0);
-        }
-
-        if (const auto lastIdx = triggerSearchLine.lastIndexOf('\n'); lastIdx > 0) {
-            triggerSearchLine.slice(lastIdx + 1);
+            for (const auto rule : matchedRules) {
+                if (triggerRules[rule].command.isEmpty()) {
+                    executeTriggerAction();
+                } else {
+                    executeCommand(triggerRules[rule].command);
+                }
+            }
         }
 
     } else if (triggerType == TriggerSetupDialog::TriggerType::Activity) {
@@ -1262,6 +1628,140 @@ void MainWindow::processTriggers(const QByteArray& newData)
     }
 }
 
+void MainWindow::matchRegexTriggers(const QByteArray& newData, const std::vector<size_t>& newlines, std::vector<size_t>& matchedRules)
+{
+    qsizetype lineStart {};
+    for (const auto offset : newlines) {
+        const QByteArrayView line(newData.constData() + lineStart, static_cast<qsizetype>(offset) - lineStart);
+        if (regexLineBuffer.isEmpty()) {
+            matchRegexTriggersOnLine(line, matchedRules);
+        } else {
+            regexLineBuffer.append(line);
+            matchRegexTriggersOnLine(regexLineBuffer, matchedRules);
+            regexLineBuffer.resize(0);
+        }
+        lineStart = static_cast<qsizetype>(offset) + 1;
+    }
+
+    regexLineBuffer.append(newData.constData() + lineStart, newData.size() - lineStart);
+    // Don't let a device that never sends a newline grow the buffer forever, match what we have and start over
+    if (regexLineBuffer.size() > REGEX_MAX_LINE_LENGTH) {
+        matchRegexTriggersOnLine(regexLineBuffer, matchedRules);
+        regexLineBuffer.resize(0);
+    }
+}
+
+void MainWindow::matchRegexTriggersOnLine(const QByteArrayView line, std::vector<size_t>& matchedRules)
+{
+    // Decode once for all the expressions
+    const auto text = QString::fromUtf8(line);
+
+    for (auto& trigger : regexTriggers) {
+        QElapsedTimer timer;
+        timer.start();
+        const auto matched = trigger.expression.match(text).hasMatch();
+        trigger.evalTimeNs += timer.nsecsElapsed();
+        trigger.evalCount++;
+
+        if (matched) {
+            triggerMatchCounts[trigger.rule]++;
+            if (std::find(matchedRules.begin(), matchedRules.end(), trigger.rule) == matchedRules.end()) {
+                matchedRules.push_back(trigger.rule);
+            }
+        }
+    }
+}
+
+void MainWindow::updateRegexTriggerStats()
+{
+    if (regexStatsTimer.elapsed() < REGEX_STATS_INTERVAL_MS) {
+        return;
+    }
+    regexStatsTimer.start();
+
+    QString stats = QStringLiteral("Regex trigger cost per line:");
+    for (auto& trigger : regexTriggers) {
+        if (trigger.evalCount == 0) {
+            continue;
+        }
+        const auto avgNs = trigger.evalTimeNs / trigger.evalCount;
+        const auto& keyword = triggerRules[trigger.rule].keyword;
+        stats += QStringLiteral("\n%1: %2 µs (%3 lines)").arg(keyword).arg(static_cast<double>(avgNs) / 1000.0, 0, 'f', 2).arg(trigger.evalCount);
+
+        if (avgNs > REGEX_COST_WARNING_NS && !trigger.costWarningShown) {
+            trigger.costWarningShown = true;
+            const auto msg = QStringLiteral("Regex trigger \"%1\" takes %2 µs per line and may slow down the display").arg(keyword).arg(avgNs / 1000);
+            qWarning() << msg;
+
+            auto* warnMsg = new KTextEditor::Message(msg, KTextEditor::Message::Warning); // NOLINT(cppcoreguidelines-owning-memory)
+            warnMsg->setAutoHide(5000);
+            doc->postMessage(warnMsg);
+        }
+    }
+    statusBarText->setToolTip(stats);
+}
+
+void MainWindow::startColorSegment()
+{
+    // Low alpha so that the text stays readable with both light and dark color schemes
+    static const std::array<QColor, 6> PALETTE {
+        QColor(255, 80, 80, 48),
+        QColor(80, 200, 80, 48),
+        QColor(80, 140, 255, 48),
+        QColor(255, 200, 40, 48),
+        QColor(200, 80, 255, 48),
+        QColor(40, 210, 210, 48),
+    };
+
+    // The new segment starts at the beginning of the last line, which is where the reset was received
+    const KTextEditor::Cursor start(doc->lines() - 1, 0);
+    if (!colorSegments.empty()) {
+        auto& previous = colorSegments.back();
+        if (previous->start().toCursor() >= start) {
+            // Nothing was received in this color before the next reset
+            colorSegments.pop_back();
+        } else {
+            previous->setInsertBehaviors(KTextEditor::MovingRange::DoNotExpand);
+            previous->setRange(KTextEditor::Range(previous->start().toCursor(), start));
+        }
+    }
+
+    KTextEditor::Attribute::Ptr attr(new KTextEditor::Attribute());
+    attr->setBackground(PALETTE.at(colorSegmentCounter % PALETTE.size()));
+    attr->setBackgroundFillWhitespace(true);
+    colorSegmentCounter++;
+
+    std::unique_ptr<KTextEditor::MovingRange> range(
+        doc->newMovingRange(KTextEditor::Range(start, doc->documentEnd()), KTextEditor::MovingRange::ExpandRight, KTextEditor::MovingRange::AllowEmpty));
+    range->setAttribute(attr);
+    colorSegments.push_back(std::move(range));
+
+    pruneColorSegments();
+}
+
+void MainWindow::pruneColorSegments()
+{
+    // Segments whose text has been trimmed from the scrollback collapse to an empty range, the last one is
+    // kept even if it is empty since it receives the text that follows
+    while (colorSegments.size() > 1 && colorSegments.front()->isEmpty()) {
+        colorSegments.pop_front();
+    }
+}
+
+void MainWindow::updateRxBufferLabel()
+{
+    const auto peak = serialPort->bufferHighWaterMark();
+    if (peak == rxBufferPeak) {
+        return;
+    }
+    rxBufferPeak = peak;
+
+    rxBufferLabel->setText(QStringLiteral("Rx buffer peak: %1 KiB").arg(peak / 1024));
+    rxBufferLabel->setToolTip(QStringLiteral("Largest amount of data waiting to be displayed.\nCapacity: %1 KiB, reader stalled %2 times")
+            .arg(serialPort->bufferCapacity() / 1024)
+            .arg(serialPort->bufferFullCount()));
+}
+
 int MainWindow::getRandomNumber()
 {
     std::random_device rd;
@@ -1283,4 +1783,12 @@ void MainWindow::loadSettings()
             qWarning() << "Failed to read settings: " << SETTINGS_BUFFER_SIZE << " " << settings.value(SETTINGS_BUFFER_SIZE);
         }
     }
+
+    bool ok {};
+    const auto refreshRate = settings.value(SETTINGS_REFRESH_RATE, DEFAULT_REFRESH_RATE).toInt(&ok);
+    if (ok && refreshRate > 0) {
+        displayRefreshRate = refreshRate;
+    } else {
+        qWarning() << "Failed to read settings: " << SETTINGS_REFRESH_RATE << " " << settings.value(SETTINGS_REFRESH_RATE);
+    }
 }
@@ -1,6 +1,12 @@
 #ifndef MAINWINDOW_H
 #define MAINWINDOW_H
 
+#include "ahocorasick.hpp"
+#include "arrivalqueue.hpp"
+#include "chunkscrubber.hpp"
+#include "linetimestamps.hpp"
+#include "rawbytestore.hpp"
+#include "scrollbacktracker.hpp"
 #include "triggersetupdialog.h"
 
 #include <QDBusAbstractAdaptor>
@@ -8,6 +14,7 @@
 #include <QElapsedTimer>
 #include <QMainWindow>
 #include <QPointer>
+#include <QRegularExpression>
 #include <QSocketDescriptor>
 #include <QString>
 #include <QWidget>
@@ -15,11 +22,11 @@
 
 #include <cstdint>
 #include <cstdlib>
-#include <experimental/source_location>
+#include <deque>
+#include <memory>
 #include <optional>
 #include <utility>
 #include <vector>
-#include <zstd.h>
 
 QT_BEGIN_NAMESPACE
 namespace Ui {
@@ -32,6 +39,7 @@ class Editor; // NOLINT(cppcoreguidelines-virtual-class-destructor)
 class Document;
 class View;
 class Message;
+class MovingRange;
 } // namespace KTextEditor
 
 enum class ProgramState : std::uint8_t {
@@ -43,7 +51,8 @@ enum class ProgramState : std::uint8_t {
 enum class SourceType : std::uint8_t {
     Unknown,
     Serial,
-    Stdin
+    Stdin,
+    Replay
 };
 
 class QSocketNotifier;
@@ -53,6 +62,13 @@ class LongTermRunModeDialog;
 class QElapsedTimer;
 class QLabel;
 class QFileSystemWatcher;
+class SerialReader;
+class ReplayReader;
+class ArchiveRetention;
+class ArchiveWriter;
+class RawCaptureWriter;
+class TimestampGutter;
+class HexView;
 
 class MainWindow final : public QMainWindow {
     Q_OBJECT
@@ -70,35 +86,51 @@ public slots:
     Q_SCRIPTABLE void portName(QString& out);
 
 private slots:
-    void handleNewData(QByteArray newData);
+    // `arrivalUs` is the LineTimestamps::now() time at which the data was read
+    void handleNewData(QByteArray newData, const int64_t arrivalUs);
+    void commitPendingText();
     void handleReadyRead();
     void handleError(const QSerialPort::SerialPortError error);
 
     void handleSaveAction();
-    void handleClearAction(const bool force = false);
+    void handleClearAction();
     static void handleQuitAction();
     void handleScrollToEnd();
     void handleAboutAction();
     void handleSettingsAction();
     void handleConnectAction();
+    void handleOpenArchiveAction();
+    void handleReplayAction();
+    void handleReplayReadyRead();
+    void handleReplayFinished(qint64 bytes, qint64 elapsedMs);
+    void handleReplayFailed(const QString& error);
     void handleTriggerSetupAction();
     void handleTriggerSetupDialogDone(int result);
     void handleStartStopButton();
     void handleRetryConnection();
     void handleLongTermRunModeAction();
     void handleLongTermRunModeDialogDone(int result);
-    void handleLongTermRunModeTimer();
+    void handleArchiveWritten(const QString& filename, qint64 size, qint64 latencyMs, qsizetype queueDepth);
+    void handleArchiveWriteFailed(const QString& error, qsizetype queueDepth);
     void handleFileWatchEvent(const QString& path);
     void handleStatusBarTimer();
     void handleCancelAutoRetry();
     void handleAutoBaudRateDetection();
     void handleBgColorChangeAction();
+    void handleShowTimestampsAction(bool checked);
+    void handleHexViewAction(bool checked);
+    void handleRawCaptureAction(bool checked);
+    void handleRawCaptureFailed(const QString& error);
+    void handleRawCaptureDropping();
+    void handleJournalsRecovered(const qsizetype journals, const qint64 bytes, const qsizetype failed);
 
     void handleSocketNotifierActivated(QSocketDescriptor socket, QSocketNotifier::Type);
 
 private:
     void start();
     void stop();
+    // Bytes of scrollback to keep, 0 means no limit
+    [[nodiscard]] size_t scrollbackLimit() const;
     void stopAutoRetryTimer(const bool deleteMsg = true);
     static constexpr std::string_view DEV_PREFIX = "/dev/";
     Ui::MainWindow* ui {};
@@ -111,14 +143,24 @@ private:
     [[nodiscard]] static std::pair<QString, int> getPortFromUser();
 
     void connectToStdin();
+    // `speed` is a multiple of the original speed, 0 replays as fast as possible
+    void connectToReplay(const QString& filename, const int speed);
     void connectToSerialDevice(const QString& port, const int baud, const bool showMsgOnOpenErr = true);
 
     // Qt is unable to detect disconnection, we need to use inotify to monitor the serial port file path.
     QFileSystemWatcher* fsWatcher;
 
     QSocketNotifier* sockNotifier {};
+    // Reused for every read from stdin
+    std::vector<char> stdinBuffer;
+    static constexpr size_t STDIN_BUFFER_SIZE = 1024 * 1024;
+    // Upper limit on the amount of data read per notifier activation so that the GUI stays responsive
+    static constexpr int STDIN_MAX_READS_PER_WAKEUP = 16;
+    // File status flags of stdin before O_NONBLOCK was added, -1 if they haven't been changed
+    int stdinOriginalFlags = -1;
     SourceType srcType = SourceType::Unknown;
-    QSerialPort* serialPort {};
+    SerialReader* serialPort {};
+    ReplayReader* replayReader {};
     QString manufacturer;
     QString description;
     QString serialNumber;
@@ -128,12 +170,52 @@ private:
     QSoundEffect* sound {};
     TriggerSetupDialog::TriggerType triggerType = TriggerSetupDialog::TriggerType::Disabled;
     std::unique_ptr<TriggerSetupDialog> triggerSetupDialog;
-    QByteArray triggerKeyword;
-    int triggerMatchCount {};
+    std::vector<TriggerSetupDialog::TriggerRule> triggerRules;
+    // All literal rule keywords compiled into one automaton, pattern index -> rule index is in triggerLiteralRules
+    AhoCorasick triggerMatcher;
+    std::vector<size_t> triggerLiteralRules;
+    // Matcher state is carried over between chunks so that keywords split across two reads are found
+    uint32_t triggerMatcherState = AhoCorasick::ROOT;
+    std::vector<int> triggerMatchCounts;
+
+    // Regex rules are compiled (and JIT compiled) once when the rules are set and run against complete lines
+    struct RegexTrigger {
+        size_t rule {};
+        QRegularExpression expression;
+        qint64 evalTimeNs {};
+        qint64 evalCount {};
+        bool costWarningShown {};
+    };
+    std::vector<RegexTrigger> regexTriggers;
+    // Last incomplete line, kept until its newline arrives
+    QByteArray regexLineBuffer;
+    static constexpr qsizetype REGEX_MAX_LINE_LENGTH = 64 * 1024;
+    // Average time per line above which a regex is reported as too expensive
+    static constexpr qint64 REGEX_COST_WARNING_NS = 100'000;
+    static constexpr qint64 REGEX_STATS_INTERVAL_MS = 1000;
+    QElapsedTimer regexStatsTimer;
     QTimer* inactivityTimer {};
     static constexpr auto INACTIVITY_TIMEOUT = 10'000;
 
     quint32 txtBufferSize {};
+    ScrollbackTracker scrollback;
+    // Arrival time of each line, shown in the annotation border when enabled
+    LineTimestamps lineTimestamps;
+    TimestampGutter* timestampGutter {};
+    // The received bytes before scrubbing, shown by hexView in place of the text view. Only filled while the hex view
+    // is enabled, trimmed with the scrollback or to MAX_RAW_BYTES if the scrollback is unlimited.
+    static constexpr size_t MAX_RAW_BYTES = 256 * 1024 * 1024;
+    RawByteStore rawBytes;
+    HexView* hexView {};
+
+    // Incoming text is collected here and added to the document at most `displayRefreshRate` times per second
+    QByteArray pendingText;
+    // Offsets of '\n' in pendingText
+    std::vector<size_t> pendingNewlines;
+    ChunkScrubber scrubber;
+    QTimer* docCommitTimer {};
+    static constexpr int DEFAULT_REFRESH_RATE = 30;
+    int displayRefreshRate = DEFAULT_REFRESH_RATE;
 
     ProgramState currentProgramState = ProgramState::Unknown;
     QTimer* autoRetryTimer {};
@@ -141,7 +223,9 @@ private:
     QTimer* statusBarTimer {};
 
     QLabel* statusBarText {};
-    QByteArray triggerSearchLine;
+    // Shows how far the GUI thread has fallen behind the serial reader thread
+    QLabel* rxBufferLabel {};
+    size_t rxBufferPeak {};
 
     // Long term run mode
     std::unique_ptr<LongTermRunModeDialog> longTermRunModeDialog;
@@ -150,10 +234,11 @@ private:
     qsizetype longTermRunModeMaxMemory {};
     int longTermRunModeMaxTime {};
     QString longTermRunModePath;
-    qint64 longTermRunModeStartTime {};
-    QTimer* longTermRunModeTimer {};
-    ZSTD_CCtx* zstdCtx {};
-    std::vector<char> zstdOutBuffer;
+    ArchiveWriter* archiveWriter {};
+    // Prunes and recompresses the archives in longTermRunModePath
+    ArchiveRetention* archiveRetention {};
+    // Byte exact copy of the received data, independent of long term run mode
+    RawCaptureWriter* rawCaptureWriter {};
     bool serialPortErrMsgActive {};
     bool serialPortErrMsgShown {};
     KTextEditor::Message* serialPortErrMsg {};
@@ -161,8 +246,13 @@ private:
     int fileCounter {};
     int errCtr {};
     // Text background color control
-    uint currentMark {};
     QString bgColorChangeStr;
+    // Finds bgColorChangeStr in the stream, the state is carried over so that a marker split across two reads is found
+    AhoCorasick bgColorChangeMatcher;
+    uint32_t bgColorChangeMatcherState = AhoCorasick::ROOT;
+    // One range per reset, the last one grows as text is appended. 0 means no reset seen yet
+    std::deque<std::unique_ptr<KTextEditor::MovingRange>> colorSegments;
+    size_t colorSegmentCounter {};
 
     static constexpr auto HIGHLIGHT_MODE = "Log File (advanced)";
     static constexpr auto GROUP_DIALOUT = "dialout";
@@ -176,12 +266,17 @@ private:
 #endif
 
     void executeTriggerAction();
+    void executeCommand(const QString& command);
     void audioAlert();
     [[nodiscard]] static std::string getErrorStr();
-    void writeCompressedFile(const QByteArray& contents);
-    static void validateZstdResult(const size_t result, const std::experimental::source_location& srcLoc = std::experimental::source_location::current());
+    [[nodiscard]] QString getArchivePortName() const;
+    void updateLongTermRunModeLabel(const QString& extra = {});
     [[nodiscard]] QString getSerialPortPath() const;
     void closeStdin();
+    void closeReplay();
+    void setStdinNonBlocking();
+    // The file description is usually shared with the shell that started us, which doesn't expect O_NONBLOCK
+    void restoreStdinFlags();
     void closeSerialPort();
     [[nodiscard]] static std::tuple<QString, QString, QString> getPortInfo(QString portLocation);
     // Checks if the user is in "dialout" group
@@ -189,9 +284,15 @@ private:
     bool handlePortBusy(const QString& port);
     void handlePortAccessError(const QString& port);
 
-    [[nodiscard]] static int stringMatchCount(QByteArray haystack, const QByteArray& needle);
-
-    void processTriggers(const QByteArray& newData);
+    // Passes each read in `data` to handleNewData() with its own arrival time
+    void handleNewReads(QByteArray data, const std::vector<ArrivalQueue::Mark>& arrivals);
+    void processTriggers(const QByteArray& newData, const std::vector<size_t>& newlines);
+    void matchRegexTriggers(const QByteArray& newData, const std::vector<size_t>& newlines, std::vector<size_t>& matchedRules);
+    void matchRegexTriggersOnLine(QByteArrayView line, std::vector<size_t>& matchedRules);
+    void updateRegexTriggerStats();
+    void updateRxBufferLabel();
+    void startColorSegment();
+    void pruneColorSegments();
     [[nodiscard]] static int getRandomNumber();
     void loadSettings();
 };
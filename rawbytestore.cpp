@@ -0,0 +1,57 @@
+#include "rawbytestore.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+void RawByteStore::append(const char* data, const size_t len)
+{
+    size_t done {};
+    // NOLINTNEXTLINE(altera-id-dependent-backward-branch)
+    while (done < len) {
+        if (blocks.empty() || blocks.back().size() == BLOCK_SIZE) {
+            blocks.emplace_back().reserve(BLOCK_SIZE);
+        }
+        auto& block = blocks.back();
+        const auto count = std::min(len - done, BLOCK_SIZE - block.size());
+        block.insert(block.end(), data + done, data + done + count); // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+        done += count;
+    }
+    endOffset += len;
+}
+
+void RawByteStore::trim(const size_t limit)
+{
+    // NOLINTNEXTLINE(altera-id-dependent-backward-branch)
+    while (limit && blocks.size() > 1 && size() - BLOCK_SIZE >= limit) {
+        blocks.pop_front();
+        firstOffset += BLOCK_SIZE;
+    }
+}
+
+void RawByteStore::clear()
+{
+    blocks.clear();
+    firstOffset = 0;
+    endOffset = 0;
+}
+
+size_t RawByteStore::copy(const uint64_t offset, const size_t len, char* out) const
+{
+    if (offset < firstOffset || offset >= endOffset) {
+        return 0;
+    }
+
+    auto index = static_cast<size_t>((offset - firstOffset) / BLOCK_SIZE);
+    auto pos = static_cast<size_t>((offset - firstOffset) % BLOCK_SIZE);
+    size_t done {};
+    // NOLINTNEXTLINE(altera-id-dependent-backward-branch)
+    while (done < len && index < blocks.size()) {
+        const auto& block = blocks[index];
+        const auto count = std::min(len - done, block.size() - pos);
+        memcpy(out + done, block.data() + pos, count); // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+        done += count;
+        index++;
+        pos = 0;
+    }
+    return done;
+}
@@ -0,0 +1,37 @@
+#ifndef RAWBYTESTORE_HPP
+#define RAWBYTESTORE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+// The received bytes exactly as they were read, for the hex view. Stored in fixed size blocks, so appending never
+// moves the data already stored and trimming drops whole blocks from the front.
+// Offsets count from the last clear(), they stay the same when the front is trimmed.
+class RawByteStore final {
+public:
+    // A multiple of any sensible row width, so that trimming doesn't shift the rows of a hex dump
+    static constexpr size_t BLOCK_SIZE = 64 * 1024;
+
+    void append(const char* data, const size_t len);
+    // Drops blocks from the front as long as at least `limit` bytes remain, 0 means no limit
+    void trim(const size_t limit);
+    void clear();
+
+    // Offset of the first stored byte and one past the last
+    [[nodiscard]] uint64_t begin() const { return firstOffset; }
+    [[nodiscard]] uint64_t end() const { return endOffset; }
+    [[nodiscard]] size_t size() const { return static_cast<size_t>(endOffset - firstOffset); }
+
+    // Copies up to `len` bytes from `offset`, which must be in [begin(), end()], returns the number of bytes copied
+    size_t copy(const uint64_t offset, const size_t len, char* out) const;
+
+private:
+    // All blocks but the last one are full
+    std::deque<std::vector<char>> blocks;
+    uint64_t firstOffset {};
+    uint64_t endOffset {};
+};
+
+#endif // RAWBYTESTORE_HPP
@@ -0,0 +1,53 @@
+#ifndef RAWCAPTURE_HPP
+#define RAWCAPTURE_HPP
+
+#include <QByteArray>
+#include <QString>
+
+#include <cstdint>
+
+// Layout of raw captures, a byte exact record of everything received, in the chunks it was read in.
+// The text view and the archives only get the data after '\0' has been replaced and line endings normalized, raw
+// captures keep binary protocols and corrupted bytes for post-mortem analysis and replay.
+// Header: magic, version and the start of the capture in µs since epoch, all little endian.
+// Records: time since the previous record (the start for the first one) in µs and length, both as LEB128 varints,
+// followed by the bytes. A record cut short by a crash is ignored.
+// Version 2 adds gap records for data the writer had to drop because the storage couldn't keep up: a length of 0,
+// followed by the number of bytes dropped as a varint. The time is that of the first dropped chunk.
+// Compressed captures (.yraw.zst) are a zstd stream of exactly that, `zstd -d` turns them into plain ones.
+namespace RawCapture {
+
+constexpr uint32_t MAGIC = 0x57415259; // "YRAW"
+constexpr uint32_t VERSION = 2;
+constexpr qsizetype HEADER_SIZE = 16;
+// Longest varint of a 64-bit value
+constexpr qsizetype MAX_VARINT_SIZE = 10;
+
+inline QString suffix()
+{
+    return QStringLiteral(".yraw");
+}
+
+inline QString compressedSuffix()
+{
+    return QStringLiteral(".yraw.zst");
+}
+
+inline bool isRawCapture(const QString& filename)
+{
+    return filename.endsWith(suffix()) || filename.endsWith(compressedSuffix());
+}
+
+inline void appendVarint(QByteArray& out, uint64_t value)
+{
+    // NOLINTNEXTLINE(altera-id-dependent-backward-branch)
+    while (value >= 0x80) {
+        out.append(static_cast<char>((value & 0x7F) | 0x80));
+        value >>= 7;
+    }
+    out.append(static_cast<char>(value));
+}
+
+} // namespace RawCapture
+
+#endif // RAWCAPTURE_HPP
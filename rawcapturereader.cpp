@@ -0,0 +1,143 @@
+#include "rawcapturereader.hpp"
+#include "rawcapture.hpp"
+#include "seekableformat.hpp"
+
+#include <QIODevice>
+
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+
+// Anything longer is corruption, the writer splits larger chunks
+static constexpr uint64_t MAX_RECORD_SIZE = 64 * 1024 * 1024;
+
+RawCaptureReader::RawCaptureReader(const QString& filename)
+    : file(filename)
+{
+    if (!file.open(QIODevice::ReadOnly)) {
+        throw std::runtime_error(QStringLiteral("Failed to open %1: %2").arg(filename, file.errorString()).toStdString());
+    }
+
+    // Compressed captures are recognized by their content, whatever they are called
+    if (const auto magic = file.peek(4); magic.size() == 4 && SeekableFormat::readLE32(magic.constData()) == ZSTD_MAGICNUMBER) {
+        dctx = ZSTD_createDCtx();
+        if (!dctx) {
+            throw std::runtime_error("Failed to create zstd decompression context");
+        }
+    }
+
+    try {
+        if (!fill(RawCapture::HEADER_SIZE) || SeekableFormat::readLE32(buffer.constData()) != RawCapture::MAGIC) {
+            throw std::runtime_error(QStringLiteral("%1 is not a raw capture").arg(filename).toStdString());
+        }
+        if (const auto version = SeekableFormat::readLE32(buffer.constData() + 4); version > RawCapture::VERSION) { // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+            throw std::runtime_error(QStringLiteral("%1 is a raw capture of an unsupported version %2").arg(filename).arg(version).toStdString());
+        }
+        startUs = static_cast<int64_t>(SeekableFormat::readLE64(buffer.constData() + 8)); // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+        pos = RawCapture::HEADER_SIZE;
+    } catch (...) {
+        ZSTD_freeDCtx(dctx);
+        throw;
+    }
+}
+
+RawCaptureReader::~RawCaptureReader()
+{
+    ZSTD_freeDCtx(dctx);
+}
+
+std::optional<RawCaptureReader::Record> RawCaptureReader::next()
+{
+    uint64_t delta {};
+    uint64_t length {};
+    const auto deltaSize = readVarint(0, delta);
+    if (!deltaSize) {
+        return std::nullopt;
+    }
+    const auto lengthSize = readVarint(deltaSize, length);
+    if (!lengthSize) {
+        return std::nullopt;
+    }
+    if (length > MAX_RECORD_SIZE) {
+        throw std::runtime_error(QStringLiteral("%1 is corrupt: record of %2 bytes").arg(file.fileName()).arg(length).toStdString());
+    }
+
+    if (!length) {
+        uint64_t dropped {};
+        const auto droppedSize = readVarint(deltaSize + lengthSize, dropped);
+        if (!droppedSize) {
+            return std::nullopt;
+        }
+        lastTimeUs += static_cast<int64_t>(delta);
+        pos += deltaSize + lengthSize + droppedSize;
+        return Record { lastTimeUs, {}, static_cast<qint64>(dropped) };
+    }
+
+    const auto headerSize = deltaSize + lengthSize;
+    if (!fill(headerSize + static_cast<qsizetype>(length))) {
+        return std::nullopt;
+    }
+    lastTimeUs += static_cast<int64_t>(delta);
+    Record record { lastTimeUs, buffer.sliced(pos + headerSize, static_cast<qsizetype>(length)), 0 };
+    pos += headerSize + static_cast<qsizetype>(length);
+    return record;
+}
+
+qsizetype RawCaptureReader::readVarint(const qsizetype offset, uint64_t& value)
+{
+    value = 0;
+    // NOLINTNEXTLINE(altera-id-dependent-backward-branch)
+    for (qsizetype i = 0; i < RawCapture::MAX_VARINT_SIZE; i++) {
+        if (!fill(offset + i + 1)) {
+            return 0;
+        }
+        const auto byte = static_cast<uint8_t>(buffer.at(pos + offset + i));
+        value |= static_cast<uint64_t>(byte & 0x7F) << (7 * i);
+        if (!(byte & 0x80)) {
+            return i + 1;
+        }
+    }
+    throw std::runtime_error(QStringLiteral("%1 is corrupt: invalid record header").arg(file.fileName()).toStdString());
+}
+
+bool RawCaptureReader::fill(const qsizetype count)
+{
+    // NOLINTNEXTLINE(altera-id-dependent-backward-branch)
+    while (buffer.size() - pos < count) {
+        if (pos) {
+            buffer.remove(0, pos);
+            pos = 0;
+        }
+
+        if (!dctx || (inputPos == input.size() && !outputPending)) {
+            auto data = file.read(std::max(READ_SIZE, count - buffer.size()));
+            if (data.isEmpty()) {
+                if (file.error() != QFileDevice::NoError) {
+                    throw std::runtime_error(QStringLiteral("Failed to read %1: %2").arg(file.fileName(), file.errorString()).toStdString());
+                }
+                // Whatever is left is the part of a record that was being written when the capture stopped
+                return false;
+            }
+            if (!dctx) {
+                buffer.append(data);
+                continue;
+            }
+            input = std::move(data);
+            inputPos = 0;
+        }
+
+        const auto used = buffer.size();
+        const auto outSize = ZSTD_DStreamOutSize();
+        buffer.resize(used + static_cast<qsizetype>(outSize));
+        ZSTD_inBuffer in = { input.constData(), static_cast<size_t>(input.size()), static_cast<size_t>(inputPos) };
+        ZSTD_outBuffer out = { buffer.data() + used, outSize, 0 }; // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+        const auto result = ZSTD_decompressStream(dctx, &out, &in);
+        if (ZSTD_isError(result)) {
+            throw std::runtime_error(QStringLiteral("Failed to decompress %1: %2").arg(file.fileName(), QString::fromUtf8(ZSTD_getErrorName(result))).toStdString());
+        }
+        inputPos = static_cast<qsizetype>(in.pos);
+        buffer.resize(used + static_cast<qsizetype>(out.pos));
+        outputPending = out.pos == out.size;
+    }
+    return true;
+}
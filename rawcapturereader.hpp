@@ -0,0 +1,61 @@
+#ifndef RAWCAPTUREREADER_HPP
+#define RAWCAPTUREREADER_HPP
+
+#include <QByteArray>
+#include <QFile>
+#include <QString>
+
+#include <cstdint>
+#include <optional>
+#include <zstd.h>
+
+// Reads a raw capture (see rawcapture.hpp) from the beginning, one record at a time.
+// Compressed captures are decompressed as they are read, so memory use doesn't depend on the size of the capture.
+class RawCaptureReader final {
+public:
+    struct Record {
+        // µs since the start of the capture
+        int64_t timeUs {};
+        QByteArray data;
+        // Gap records have no data, only the number of bytes the writer dropped at `timeUs`
+        qint64 droppedBytes {};
+    };
+
+    // Throws std::runtime_error if the file can't be opened or isn't a raw capture
+    explicit RawCaptureReader(const QString& filename);
+    RawCaptureReader(const RawCaptureReader&) = delete;
+    RawCaptureReader(RawCaptureReader&&) = delete;
+    RawCaptureReader& operator=(const RawCaptureReader&) = delete;
+    RawCaptureReader& operator=(RawCaptureReader&&) = delete;
+    ~RawCaptureReader();
+
+    // µs since epoch
+    [[nodiscard]] int64_t startTimeUs() const { return startUs; }
+
+    // nullopt at the end of the capture, throws std::runtime_error on read errors
+    [[nodiscard]] std::optional<Record> next();
+
+private:
+    static constexpr qsizetype READ_SIZE = 1024 * 1024;
+
+    QFile file;
+    ZSTD_DCtx* dctx {};
+    // Compressed data read ahead
+    QByteArray input;
+    qsizetype inputPos {};
+    // Data of the capture, the part before `pos` has been returned
+    QByteArray buffer;
+    qsizetype pos {};
+    // The decoder has output left that didn't fit into the last call
+    bool outputPending {};
+
+    int64_t startUs {};
+    int64_t lastTimeUs {};
+
+    // Makes sure `count` bytes are available after `pos`, false if the capture ends before that
+    [[nodiscard]] bool fill(const qsizetype count);
+    // Reads a varint at `offset` after `pos`, returns the number of bytes it takes, 0 if the capture ends before it
+    [[nodiscard]] qsizetype readVarint(const qsizetype offset, uint64_t& value);
+};
+
+#endif // RAWCAPTUREREADER_HPP
@@ -0,0 +1,271 @@
+#include "rawcapturewriter.hpp"
+#include "linetimestamps.hpp"
+#include "rawcapture.hpp"
+#include "seekableformat.hpp"
+
+#include <QDateTime>
+#include <QDeadlineTimer>
+#include <QDebug>
+#include <QFile>
+#include <QMutexLocker>
+
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+static void checkZstdResult(const size_t result)
+{
+    if (ZSTD_isError(result)) {
+        throw std::runtime_error(std::string("ZSTD error: ") + ZSTD_getErrorName(result));
+    }
+}
+
+RawCaptureWriter::RawCaptureWriter(QObject* parent)
+    : QThread(parent)
+{
+}
+
+RawCaptureWriter::~RawCaptureWriter()
+{
+    close();
+    ZSTD_freeCCtx(zstdCtx);
+    zstdCtx = nullptr;
+}
+
+void RawCaptureWriter::open(const QString& filename, const int compressionLevel)
+{
+    close();
+
+    QFile::remove(filename);
+    try {
+        file = ArchiveFile::create(filename, {});
+        if (compressionLevel > 0) {
+            zstdCtx = ZSTD_createCCtx();
+            if (!zstdCtx) {
+                throw std::runtime_error("Failed to create zstd compression context");
+            }
+            checkZstdResult(ZSTD_CCtx_setParameter(zstdCtx, ZSTD_c_checksumFlag, 1));
+            checkZstdResult(ZSTD_CCtx_setParameter(zstdCtx, ZSTD_c_compressionLevel, compressionLevel));
+            zstdOutBuffer.resize(ZSTD_CStreamOutSize());
+        }
+
+        QByteArray header;
+        SeekableFormat::appendLE32(header, RawCapture::MAGIC);
+        SeekableFormat::appendLE32(header, RawCapture::VERSION);
+        SeekableFormat::appendLE64(header, static_cast<uint64_t>(QDateTime::currentMSecsSinceEpoch()) * 1000);
+        lastTimeUs = LineTimestamps::now();
+        write(header.constData(), static_cast<size_t>(header.size()));
+    } catch (...) {
+        file.reset();
+        ZSTD_freeCCtx(zstdCtx);
+        zstdCtx = nullptr;
+        QFile::remove(filename);
+        throw;
+    }
+
+    {
+        const QMutexLocker locker(&mutex);
+        stopRequested = false;
+        failed = false;
+        queuedBytes = 0;
+        droppedBytes = 0;
+        gapBytes = 0;
+    }
+    name = filename;
+    unsynced = true;
+    sinceFlush.start();
+    opened = true;
+    start(QThread::LowPriority);
+}
+
+void RawCaptureWriter::close()
+{
+    if (!opened) {
+        return;
+    }
+
+    {
+        const QMutexLocker locker(&mutex);
+        stopRequested = true;
+    }
+    dataAvailable.wakeAll();
+    wait();
+    opened = false;
+
+    const QMutexLocker locker(&mutex);
+    if (droppedBytes) {
+        qWarning() << "Raw capture" << name << "is missing" << droppedBytes << "bytes, the storage couldn't keep up";
+    }
+}
+
+void RawCaptureWriter::append(const QByteArray& data, const int64_t timeUs)
+{
+    {
+        QMutexLocker locker(&mutex);
+        if (failed || stopRequested || data.isEmpty()) {
+            return;
+        }
+        if (queuedBytes + data.size() > MAX_QUEUED_BYTES) {
+            droppedBytes += data.size();
+            const auto starting = !gapBytes;
+            if (starting) {
+                gapTimeUs = timeUs;
+            }
+            gapBytes += data.size();
+            locker.unlock();
+            if (starting) {
+                emit droppingStarted();
+            }
+            return;
+        }
+        chunks.push_back({ data, timeUs });
+        queuedBytes += data.size();
+    }
+    dataAvailable.wakeOne();
+}
+
+void RawCaptureWriter::run()
+{
+    QMutexLocker locker(&mutex);
+
+    // NOLINTNEXTLINE(altera-id-dependent-backward-branch)
+    while (true) {
+        if (chunks.empty() && !stopRequested) {
+            // Wake up without new data when the data written so far has to be synced
+            if (!unsynced) {
+                dataAvailable.wait(&mutex);
+            } else if (const auto remaining = static_cast<qint64>(FLUSH_INTERVAL_MS) - sinceFlush.elapsed(); remaining > 0) {
+                dataAvailable.wait(&mutex, QDeadlineTimer(remaining));
+            }
+        }
+
+        std::deque<Chunk> batch;
+        batch.swap(chunks);
+        queuedBytes = 0;
+        // Everything that was dropped came after the queued chunks and before any that are queued from now on
+        const auto gap = std::exchange(gapBytes, 0);
+        const auto gapStartUs = gapTimeUs;
+        const auto stopping = stopRequested;
+        locker.unlock();
+
+        try {
+            for (const auto& chunk : batch) {
+                writeRecord(chunk);
+            }
+            if (gap) {
+                writeGap(gapStartUs, gap);
+            }
+            if (stopping) {
+                flush(true);
+                return;
+            }
+            if (unsynced && sinceFlush.elapsed() >= static_cast<qint64>(FLUSH_INTERVAL_MS)) {
+                flush(false);
+            }
+        } catch (std::exception& e) {
+            const auto error = QString::fromUtf8(e.what());
+            qCritical() << "Raw capture failed:" << error;
+            try {
+                file->close();
+            } catch (std::exception& closeError) {
+                qWarning() << closeError.what();
+            }
+            file.reset();
+            ZSTD_freeCCtx(zstdCtx);
+            zstdCtx = nullptr;
+
+            locker.relock();
+            failed = true;
+            chunks.clear();
+            queuedBytes = 0;
+            emit writeFailed(error);
+            return;
+        }
+
+        locker.relock();
+    }
+}
+
+uint64_t RawCaptureWriter::nextDelta(const int64_t timeUs)
+{
+    const auto delta = static_cast<uint64_t>(std::max<int64_t>(timeUs - lastTimeUs, 0));
+    lastTimeUs = std::max(timeUs, lastTimeUs);
+    return delta;
+}
+
+void RawCaptureWriter::writeRecord(const Chunk& chunk)
+{
+    // The parts of a split chunk arrived at the same time
+    auto delta = nextDelta(chunk.timeUs);
+
+    // NOLINTNEXTLINE(altera-id-dependent-backward-branch)
+    for (qsizetype offset = 0; offset < chunk.data.size(); offset += MAX_RECORD_SIZE) {
+        const auto length = std::min(chunk.data.size() - offset, MAX_RECORD_SIZE);
+        recordHeader.resize(0);
+        RawCapture::appendVarint(recordHeader, delta);
+        RawCapture::appendVarint(recordHeader, static_cast<uint64_t>(length));
+        write(recordHeader.constData(), static_cast<size_t>(recordHeader.size()));
+        write(chunk.data.constData() + offset, static_cast<size_t>(length)); // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+        delta = 0;
+    }
+
+    if (!unsynced) {
+        unsynced = true;
+        sinceFlush.start();
+    }
+}
+
+void RawCaptureWriter::writeGap(const int64_t timeUs, const qint64 bytes)
+{
+    recordHeader.resize(0);
+    RawCapture::appendVarint(recordHeader, nextDelta(timeUs));
+    RawCapture::appendVarint(recordHeader, 0);
+    RawCapture::appendVarint(recordHeader, static_cast<uint64_t>(bytes));
+    write(recordHeader.constData(), static_cast<size_t>(recordHeader.size()));
+
+    if (!unsynced) {
+        unsynced = true;
+        sinceFlush.start();
+    }
+}
+
+void RawCaptureWriter::write(const char* data, const size_t len)
+{
+    if (!zstdCtx) {
+        file->write(data, len);
+        return;
+    }
+
+    ZSTD_inBuffer input = { data, len, 0 };
+    // NOLINTNEXTLINE(altera-id-dependent-backward-branch)
+    while (input.pos < input.size) {
+        ZSTD_outBuffer out = { zstdOutBuffer.data(), zstdOutBuffer.size(), 0 };
+        checkZstdResult(ZSTD_compressStream2(zstdCtx, &out, &input, ZSTD_e_continue));
+        file->write(zstdOutBuffer.data(), out.pos);
+    }
+}
+
+void RawCaptureWriter::flush(const bool finish)
+{
+    if (zstdCtx) {
+        ZSTD_inBuffer input = { nullptr, 0, 0 };
+        size_t remaining {};
+        // NOLINTNEXTLINE(altera-id-dependent-backward-branch)
+        do {
+            ZSTD_outBuffer out = { zstdOutBuffer.data(), zstdOutBuffer.size(), 0 };
+            remaining = ZSTD_compressStream2(zstdCtx, &out, &input, finish ? ZSTD_e_end : ZSTD_e_flush);
+            checkZstdResult(remaining);
+            file->write(zstdOutBuffer.data(), out.pos);
+        } while (remaining);
+    }
+
+    file->sync(finish);
+    unsynced = false;
+    if (finish) {
+        file->close();
+        file.reset();
+        ZSTD_freeCCtx(zstdCtx);
+        zstdCtx = nullptr;
+    }
+}
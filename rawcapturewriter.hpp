@@ -0,0 +1,102 @@
+#ifndef RAWCAPTUREWRITER_HPP
+#define RAWCAPTUREWRITER_HPP
+
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QMutex>
+#include <QString>
+#include <QThread>
+#include <QWaitCondition>
+
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <vector>
+#include <zstd.h>
+
+#include "archivefile.hpp"
+
+// Writes a raw capture (see rawcapture.hpp) of the data exactly as it was read, on a thread of its own like
+// ArchiveWriter. The GUI thread only queues a reference to the chunk it already has. Records go through ArchiveFile's
+// 1 MiB buffers, so the file is written with large sequential appends, and are optionally zstd compressed.
+// Every FLUSH_INTERVAL_MS the compressor is flushed and the file synced, a crash loses at most one interval.
+class RawCaptureWriter final : public QThread {
+    Q_OBJECT
+
+public:
+    // Fast enough for any serial port on a single core
+    static constexpr int DEFAULT_COMPRESSION_LEVEL = 3;
+
+    explicit RawCaptureWriter(QObject* parent = nullptr);
+    RawCaptureWriter(const RawCaptureWriter&) = delete;
+    RawCaptureWriter(RawCaptureWriter&&) = delete;
+    RawCaptureWriter& operator=(const RawCaptureWriter&) = delete;
+    RawCaptureWriter& operator=(RawCaptureWriter&&) = delete;
+    ~RawCaptureWriter() override;
+
+    // Replaces `filename` and starts the writer thread, `compressionLevel` 0 writes an uncompressed capture.
+    // Throws std::runtime_error if the file can't be created.
+    void open(const QString& filename, const int compressionLevel);
+    // Writes out whatever is still queued and finishes the file
+    void close();
+    [[nodiscard]] bool isOpen() const { return opened; }
+    [[nodiscard]] QString fileName() const { return name; }
+
+    // Queues `data`, read at `timeUs` (LineTimestamps::now()), never blocks on I/O
+    void append(const QByteArray& data, const int64_t timeUs);
+
+signals:
+    // The capture has stopped, nothing more is written
+    void writeFailed(const QString& error);
+    // The storage can't keep up and data is being dropped, the capture gets a gap record for it
+    void droppingStarted();
+
+protected:
+    void run() override;
+
+private:
+    static constexpr unsigned long FLUSH_INTERVAL_MS = 5000;
+    // Only reached if the storage can't keep up, the newest data is dropped beyond this
+    static constexpr qint64 MAX_QUEUED_BYTES = 64 * 1024 * 1024;
+    // Longer chunks are split into several records
+    static constexpr qsizetype MAX_RECORD_SIZE = 8 * 1024 * 1024;
+
+    struct Chunk {
+        QByteArray data;
+        int64_t timeUs {};
+    };
+
+    // Only accessed by the thread calling open(), close() and append()
+    bool opened {};
+    QString name;
+
+    mutable QMutex mutex;
+    QWaitCondition dataAvailable;
+    std::deque<Chunk> chunks;
+    qint64 queuedBytes {};
+    qint64 droppedBytes {};
+    // Dropped since the last batch was taken, written as a gap record after it
+    qint64 gapBytes {};
+    int64_t gapTimeUs {};
+    bool stopRequested {};
+    bool failed {};
+
+    // Only accessed by the writer thread while it is running
+    std::unique_ptr<ArchiveFile> file;
+    ZSTD_CCtx* zstdCtx {};
+    std::vector<char> zstdOutBuffer;
+    int64_t lastTimeUs {};
+    QByteArray recordHeader;
+    QElapsedTimer sinceFlush;
+    bool unsynced {};
+
+    void writeRecord(const Chunk& chunk);
+    void writeGap(const int64_t timeUs, const qint64 bytes);
+    // Time since the previous record, for a record at `timeUs`
+    [[nodiscard]] uint64_t nextDelta(const int64_t timeUs);
+    void write(const char* data, const size_t len);
+    // Flushes the compressor and syncs the file, `finish` ends the zstd stream and closes the file
+    void flush(const bool finish);
+};
+
+#endif // RAWCAPTUREWRITER_HPP
@@ -0,0 +1,377 @@
+#include "replayreader.hpp"
+#include "archivereader.hpp"
+#include "linetimestamps.hpp"
+#include "rawcapture.hpp"
+#include "rawcapturereader.hpp"
+#include "seekableformat.hpp"
+#include "timeindex.hpp"
+
+#include <QByteArrayView>
+#include <QDebug>
+#include <QFile>
+#include <QIODevice>
+
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <vector>
+
+// Size of the chunks of captures without timing information, about 90 ms at REPLAY_BAUD
+static constexpr qsizetype UNTIMED_CHUNK_SIZE = 1024;
+
+// A recorded capture, split into the chunks it arrived in as far as that is known
+class ReplaySource {
+public:
+    struct Chunk {
+        QByteArray data;
+        // Arrival time relative to the start of the capture, -1 if unknown
+        qint64 timeMs = -1;
+    };
+
+    ReplaySource() = default;
+    ReplaySource(const ReplaySource&) = delete;
+    ReplaySource(ReplaySource&&) = delete;
+    ReplaySource& operator=(const ReplaySource&) = delete;
+    ReplaySource& operator=(ReplaySource&&) = delete;
+    virtual ~ReplaySource() = default;
+
+    // nullopt at the end of the capture, throws std::runtime_error on read errors
+    [[nodiscard]] virtual std::optional<Chunk> next() = 0;
+};
+
+class PlainReplaySource final : public ReplaySource {
+public:
+    explicit PlainReplaySource(const QString& filename)
+        : file(filename)
+    {
+        if (!file.open(QIODevice::ReadOnly)) {
+            throw std::runtime_error(QStringLiteral("Failed to open %1: %2").arg(filename, file.errorString()).toStdString());
+        }
+    }
+
+    [[nodiscard]] std::optional<Chunk> next() override
+    {
+        auto data = file.read(UNTIMED_CHUNK_SIZE);
+        if (data.isEmpty()) {
+            if (file.error() != QFileDevice::NoError) {
+                throw std::runtime_error(QStringLiteral("Failed to read %1: %2").arg(file.fileName(), file.errorString()).toStdString());
+            }
+            return std::nullopt;
+        }
+        return Chunk { std::move(data) };
+    }
+
+private:
+    QFile file;
+};
+
+// Long term run mode archive. The time index has the arrival time of the line at which the first chunk of every
+// second started, the lines from one entry to the next are replayed at once at the time of the entry.
+class ArchiveReplaySource final : public ReplaySource {
+public:
+    explicit ArchiveReplaySource(const QString& filename)
+        : reader(filename, true)
+    {
+        try {
+            times = TimeIndex::load(TimeIndex::filenameFor(filename));
+        } catch (std::exception& e) {
+            qInfo() << "Replaying" << filename << "without timing information:" << e.what();
+        }
+    }
+
+    [[nodiscard]] std::optional<Chunk> next() override
+    {
+        if (pos == buffer.size() && !loadFrame()) {
+            return std::nullopt;
+        }
+
+        if (nextEntry >= times.size()) {
+            return Chunk { take(-1, UNTIMED_CHUNK_SIZE) };
+        }
+
+        // Long lines are split, the parts get the same time
+        const auto endLine = (nextEntry + 1 < times.size()) ? times[nextEntry + 1].line : -1;
+        Chunk chunk { take(endLine, SeekableFormat::MAX_FRAME_SIZE), times[nextEntry].timeMs - times.front().timeMs };
+        if (endLine >= 0 && line >= endLine) {
+            nextEntry++;
+        }
+        return chunk;
+    }
+
+private:
+    ArchiveReader reader;
+    std::vector<TimeIndex::Entry> times;
+    size_t nextEntry {};
+
+    // Decompressed data, the part before `pos` has been replayed
+    QByteArray buffer;
+    qsizetype pos {};
+    size_t nextFrame {};
+    // Number of '\n' before `pos`
+    qint64 line {};
+
+    bool loadFrame()
+    {
+        // An archive without a seek table is indexed as it's replayed
+        if (nextFrame >= reader.frames().size() && !reader.scanNext()) {
+            return false;
+        }
+        buffer = buffer.sliced(pos) + reader.readFrame(nextFrame++);
+        pos = 0;
+        return true;
+    }
+
+    // Up to `maxBytes` of the data before line `endLine`, or of the remaining data if `endLine` is -1
+    [[nodiscard]] QByteArray take(const qint64 endLine, const qsizetype maxBytes)
+    {
+        QByteArray data;
+        // NOLINTNEXTLINE(altera-id-dependent-backward-branch)
+        while (data.size() < maxBytes && (endLine < 0 || line < endLine)) {
+            if (pos == buffer.size() && !loadFrame()) {
+                break;
+            }
+
+            auto end = std::min(buffer.size(), pos + (maxBytes - data.size()));
+            if (endLine >= 0) {
+                auto newlines = endLine - line;
+                // NOLINTNEXTLINE(altera-id-dependent-backward-branch)
+                for (auto p = pos; newlines > 0; newlines--) {
+                    const auto newline = buffer.indexOf('\n', p);
+                    if (newline < 0 || newline >= end) {
+                        break;
+                    }
+                    p = newline + 1;
+                    if (newlines == 1) {
+                        end = p;
+                    }
+                }
+            }
+
+            const QByteArrayView part(buffer.constData() + pos, end - pos); // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+            data.append(part);
+            line += part.count('\n');
+            pos = end;
+        }
+        return data;
+    }
+};
+
+// Raw capture, replayed byte for byte in the chunks it was read in
+class RawReplaySource final : public ReplaySource {
+public:
+    explicit RawReplaySource(const QString& filename)
+        : reader(filename)
+    {
+    }
+
+    [[nodiscard]] std::optional<Chunk> next() override
+    {
+        auto record = reader.next();
+        // NOLINTNEXTLINE(altera-id-dependent-backward-branch)
+        while (record && record->droppedBytes) {
+            qWarning() << "Raw capture is missing" << record->droppedBytes << "bytes at" << record->timeUs / 1000 << "ms, the storage couldn't keep up";
+            record = reader.next();
+        }
+        if (!record) {
+            return std::nullopt;
+        }
+        if (firstTimeUs < 0) {
+            firstTimeUs = record->timeUs;
+        }
+        return Chunk { std::move(record->data), (record->timeUs - firstTimeUs) / 1000 };
+    }
+
+private:
+    RawCaptureReader reader;
+    int64_t firstTimeUs = -1;
+};
+
+ReplayReader::ReplayReader(QObject* parent)
+    : QThread(parent)
+{
+}
+
+ReplayReader::~ReplayReader()
+{
+    close();
+}
+
+void ReplayReader::setFilename(const QString& newFilename)
+{
+    Q_ASSERT(!isRunning());
+    name = newFilename;
+}
+
+void ReplayReader::setSpeed(const int newSpeed)
+{
+    Q_ASSERT(!isRunning());
+    speedFactor = std::max(newSpeed, 0);
+}
+
+bool ReplayReader::open()
+{
+    wait();
+    // Left over from the previous replay
+    void(readAll());
+
+    start();
+    openDone.acquire();
+
+    if (!openResult) {
+        wait();
+        return false;
+    }
+    return true;
+}
+
+void ReplayReader::close()
+{
+    requestInterruption();
+    wait();
+}
+
+bool ReplayReader::isOpen() const
+{
+    return opened;
+}
+
+QByteArray ReplayReader::readAll()
+{
+    // Clear the flag before reading so that anything committed after this point triggers a new notification
+    notifyPending = false;
+
+    QByteArray result;
+    result.reserve(static_cast<qsizetype>(ring.size()));
+    const auto begin = ring.readPosition();
+
+    // At most two iterations, the second one picks up the part that wrapped around
+    for (auto span = ring.readableSpan(); !span.empty(); span = ring.readableSpan()) {
+        result.append(span.data(), static_cast<qsizetype>(span.size()));
+        ring.commitRead(span.size());
+    }
+
+    readArrivals = arrivals.take(begin, ring.readPosition());
+    return result;
+}
+
+void ReplayReader::run()
+{
+    // The source is created here, opening a file does I/O
+    std::unique_ptr<ReplaySource> source;
+    try {
+        if (RawCapture::isRawCapture(name)) {
+            source = std::make_unique<RawReplaySource>(name);
+        } else if (name.endsWith(QStringLiteral(".zst"))) {
+            source = std::make_unique<ArchiveReplaySource>(name);
+        } else {
+            source = std::make_unique<PlainReplaySource>(name);
+        }
+        openResult = true;
+    } catch (std::exception& e) {
+        openError = QString::fromLocal8Bit(e.what());
+        openResult = false;
+    }
+    opened = openResult;
+    openDone.release();
+
+    if (!openResult) {
+        return;
+    }
+
+    QElapsedTimer clock;
+    clock.start();
+    qint64 bytes {};
+    // NOLINTNEXTLINE(altera-id-dependent-backward-branch)
+    while (!isInterruptionRequested()) {
+        std::optional<ReplaySource::Chunk> chunk;
+        try {
+            chunk = source->next();
+        } catch (std::exception& e) {
+            qWarning() << "Replay of" << name << "failed:" << e.what();
+            opened = false;
+            emit replayFailed(QString::fromLocal8Bit(e.what()));
+            return;
+        }
+
+        if (!chunk) {
+            // The throughput includes the GUI thread
+            // NOLINTNEXTLINE(altera-id-dependent-backward-branch)
+            while (ring.size() && !isInterruptionRequested()) {
+                msleep(RING_FULL_RETRY_MS);
+            }
+            opened = false;
+            if (!isInterruptionRequested()) {
+                emit replayFinished(bytes, clock.elapsed());
+            }
+            return;
+        }
+
+        if (speedFactor > 0) {
+            // Without timing information the data arrives like from a serial port, 10 bits per byte
+            const auto dueMs = (chunk->timeMs >= 0 ? chunk->timeMs : bytes * 10 * 1000 / REPLAY_BAUD) / speedFactor;
+            if (!sleepUntil(clock, dueMs)) {
+                break;
+            }
+        }
+        if (!push(chunk->data)) {
+            break;
+        }
+        bytes += chunk->data.size();
+    }
+
+    opened = false;
+}
+
+bool ReplayReader::sleepUntil(const QElapsedTimer& clock, const qint64 dueMs)
+{
+    // NOLINTNEXTLINE(altera-id-dependent-backward-branch)
+    while (!isInterruptionRequested()) {
+        const auto remaining = dueMs - clock.elapsed();
+        if (remaining <= 0) {
+            return true;
+        }
+        msleep(static_cast<unsigned long>(std::min(remaining, MAX_SLEEP_MS)));
+    }
+    return false;
+}
+
+bool ReplayReader::push(const QByteArray& data)
+{
+    // A mark that didn't fit while the GUI thread was behind
+    void(arrivals.flush());
+    const auto pushTime = LineTimestamps::now();
+    qsizetype offset {};
+    // NOLINTNEXTLINE(altera-id-dependent-backward-branch)
+    while (offset < data.size()) {
+        if (isInterruptionRequested()) {
+            return false;
+        }
+        const auto span = ring.writableSpan();
+        if (span.empty()) {
+            // The GUI thread is behind, make sure it knows there's data waiting
+            notify();
+            msleep(RING_FULL_RETRY_MS);
+            continue;
+        }
+        const auto count = std::min(span.size(), static_cast<size_t>(data.size() - offset));
+        memcpy(span.data(), data.constData() + offset, count); // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+        // Before the data is visible to the GUI thread, the whole chunk shares one time
+        if (offset == 0) {
+            arrivals.mark(ring.writePosition(), pushTime);
+        }
+        ring.commitWrite(count);
+        offset += static_cast<qsizetype>(count);
+    }
+    notify();
+    return true;
+}
+
+void ReplayReader::notify()
+{
+    // Only one readyRead() is kept in flight, the GUI thread drains everything available when it gets to it
+    if (!notifyPending.exchange(true)) {
+        emit readyRead();
+    }
+}
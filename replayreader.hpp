@@ -0,0 +1,90 @@
+#ifndef REPLAYREADER_HPP
+#define REPLAYREADER_HPP
+
+#include "arrivalqueue.hpp"
+#include "spscringbuffer.hpp"
+
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QSemaphore>
+#include <QString>
+#include <QThread>
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+// Plays a recorded capture back into the live pipeline, on a thread of its own and through the same kind of ring
+// buffer as SerialReader, so the GUI thread sees exactly what it would see from a serial port.
+// Raw captures (.yraw, .yraw.zst) are replayed in their original chunks and timing, long term run mode archives (.zst)
+// with the arrival times from their time index when there is one, everything else is paced like a serial port at
+// REPLAY_BAUD. At speed 0 the data is pushed as fast as the GUI thread
+// takes it, which measures the throughput of the whole ingest and display path.
+class ReplayReader final : public QThread {
+    Q_OBJECT
+
+public:
+    // 8N1, the pace of captures without timing information
+    static constexpr int REPLAY_BAUD = 115200;
+
+    explicit ReplayReader(QObject* parent = nullptr);
+    ReplayReader(const ReplayReader&) = delete;
+    ReplayReader(ReplayReader&&) = delete;
+    ReplayReader& operator=(const ReplayReader&) = delete;
+    ReplayReader& operator=(ReplayReader&&) = delete;
+    ~ReplayReader() override;
+
+    void setFilename(const QString& newFilename);
+    [[nodiscard]] QString filename() const { return name; }
+    // Multiple of the original speed, 0 for as fast as possible
+    void setSpeed(const int newSpeed);
+    [[nodiscard]] int speed() const { return speedFactor; }
+
+    // Opens the capture and starts replaying it from the beginning, errorString() tells why it failed
+    bool open();
+    void close();
+    [[nodiscard]] bool isOpen() const;
+    [[nodiscard]] QString errorString() const { return openError; }
+
+    // Must only be called from the thread that owns this object
+    [[nodiscard]] QByteArray readAll();
+    // When the data returned by the last readAll() was read (LineTimestamps::now()), one mark per read, see
+    // ArrivalQueue::take()
+    [[nodiscard]] const std::vector<ArrivalQueue::Mark>& arrivalTimes() const { return readArrivals; }
+
+signals:
+    void readyRead();
+    // Everything has been replayed and read, emitted after the last readyRead()
+    void replayFinished(qint64 bytes, qint64 elapsedMs);
+    void replayFailed(const QString& error);
+
+protected:
+    void run() override;
+
+private:
+    static constexpr size_t RING_BUFFER_SIZE = 8 * 1024 * 1024;
+    // Longest sleep, so that close() doesn't have to wait for a long gap in the capture
+    static constexpr qint64 MAX_SLEEP_MS = 100;
+    static constexpr unsigned long RING_FULL_RETRY_MS = 1;
+
+    QString name;
+    int speedFactor = 1;
+
+    SpscRingBuffer ring { RING_BUFFER_SIZE };
+    std::atomic_bool notifyPending {};
+    ArrivalQueue arrivals;
+    std::vector<ArrivalQueue::Mark> readArrivals;
+    std::atomic_bool opened {};
+
+    QSemaphore openDone;
+    bool openResult {};
+    QString openError;
+
+    void notify();
+    // Sleeps until `dueMs` on the replay clock, returns false if interrupted
+    [[nodiscard]] bool sleepUntil(const QElapsedTimer& clock, const qint64 dueMs);
+    // Returns false if interrupted
+    [[nodiscard]] bool push(const QByteArray& data);
+};
+
+#endif // REPLAYREADER_HPP
@@ -0,0 +1,47 @@
+#include "scrollbacktracker.hpp"
+
+void ScrollbackTracker::append(const size_t length, const std::span<const size_t> newlineOffsets)
+{
+    totalSize += length;
+
+    size_t lineStart {};
+    for (const auto offset : newlineOffsets) {
+        lineLengths.push_back(partialLineLength + (offset - lineStart) + 1);
+        partialLineLength = 0;
+        lineStart = offset + 1;
+    }
+    partialLineLength += length - lineStart;
+}
+
+ScrollbackTracker::Trimmed ScrollbackTracker::trim(const size_t limit)
+{
+    if (totalSize <= limit) {
+        return {};
+    }
+
+    const auto target = limit - (limit / TRIM_SLACK_DIVISOR);
+    Trimmed result;
+
+    // NOLINTNEXTLINE(altera-id-dependent-backward-branch)
+    while (totalSize > target && !lineLengths.empty()) {
+        totalSize -= lineLengths.front();
+        lineLengths.pop_front();
+        result.lines++;
+    }
+
+    // The last (incomplete) line stays, but only its end is kept
+    if (totalSize > target) {
+        result.partialLineBytes = totalSize - target;
+        partialLineLength -= result.partialLineBytes;
+        totalSize = target;
+    }
+
+    return result;
+}
+
+void ScrollbackTracker::clear()
+{
+    lineLengths.clear();
+    partialLineLength = 0;
+    totalSize = 0;
+}
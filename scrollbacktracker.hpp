@@ -0,0 +1,45 @@
+#ifndef SCROLLBACKTRACKER_HPP
+#define SCROLLBACKTRACKER_HPP
+
+#include <cstddef>
+#include <deque>
+#include <span>
+
+// Keeps track of the size of each line in the document as text is appended, so that the scrollback can be trimmed
+// by removing a block of lines in one go instead of removing and re-measuring one line at a time.
+// Sizes are in bytes of the received data, which is close enough to the character count for a size limit.
+class ScrollbackTracker final {
+public:
+    // Account for `length` bytes appended to the end of the document, `newlineOffsets` are the positions of '\n' in it
+    void append(const size_t length, const std::span<const size_t> newlineOffsets);
+
+    struct Trimmed {
+        // Lines to remove from the beginning of the document
+        size_t lines {};
+        // Bytes to remove from the beginning of the last line once it is the only one left, a stream without
+        // newlines would otherwise grow without limit
+        size_t partialLineBytes {};
+    };
+
+    // Drops lines from the top once the total size exceeds `limit`. Trimming goes a bit further than the limit so that
+    // it happens in blocks instead of on every commit.
+    [[nodiscard]] Trimmed trim(const size_t limit);
+
+    void clear();
+
+    [[nodiscard]] size_t size() const { return totalSize; }
+    // Number of lines in the document, the last line may be incomplete
+    [[nodiscard]] size_t lineCount() const { return lineLengths.size() + 1; }
+
+private:
+    // Fraction of the limit that is freed up when trimming
+    static constexpr size_t TRIM_SLACK_DIVISOR = 16;
+
+    // Size of each complete line including the newline
+    std::deque<size_t> lineLengths;
+    // Size of the last line, which has not received a newline yet
+    size_t partialLineLength {};
+    size_t totalSize {};
+};
+
+#endif // SCROLLBACKTRACKER_HPP
@@ -0,0 +1,103 @@
+#ifndef SEEKABLEFORMAT_HPP
+#define SEEKABLEFORMAT_HPP
+
+#include <QByteArray>
+
+#include <cstdint>
+#include <span>
+
+// Layout of the long term run mode archives. The archives are written in the zstd seekable format
+// (https://github.com/facebook/zstd/blob/dev/contrib/seekable_format/zstd_seekable_compression_format.md):
+// independent zstd frames followed by a skippable frame holding the seek table, so any plain zstd decoder can
+// still decompress them. yeTTY adds one more skippable frame right before the seek table with the number of lines in
+// each frame, which lets a line range be mapped to the frames containing it.
+// Frames streamed during the capture have no content size in their header, recompressed archives have it
+// (see archiveretention.hpp).
+namespace SeekableFormat {
+
+// Skippable frame: magic, content size, content
+constexpr uint32_t SKIPPABLE_MAGIC_MASK = 0xFFFFFFF0;
+constexpr uint32_t SKIPPABLE_MAGIC_BASE = 0x184D2A50;
+constexpr uint32_t SKIPPABLE_HEADER_SIZE = 8;
+
+// Seek table: skippable frame with one (compressed size, decompressed size) entry per frame and this footer
+constexpr uint32_t SEEK_TABLE_MAGIC = 0x184D2A5E;
+constexpr uint32_t SEEKABLE_MAGIC = 0x8F92EAB1;
+// Number of frames, descriptor, seekable magic
+constexpr uint32_t SEEK_TABLE_FOOTER_SIZE = 9;
+constexpr uint8_t CHECKSUM_FLAG = 0x80;
+
+// Line index: skippable frame with the number of '\n' in each frame
+constexpr uint32_t LINE_INDEX_MAGIC = 0x184D2A5D;
+
+// Frames are ended at this size even before the flush interval so that random access stays cheap
+constexpr uint32_t MAX_FRAME_SIZE = 1024 * 1024;
+
+// ZSTD_FRAMEHEADERSIZE_MAX, which zstd.h only declares with ZSTD_STATIC_LINKING_ONLY
+constexpr qint64 MAX_FRAME_HEADER_SIZE = 18;
+
+struct FrameEntry {
+    uint32_t compressedSize {};
+    uint32_t size {};
+    uint32_t lines {};
+};
+
+inline void appendLE32(QByteArray& out, const uint32_t value)
+{
+    for (int shift = 0; shift < 32; shift += 8) {
+        out.append(static_cast<char>((value >> shift) & 0xFF));
+    }
+}
+
+inline uint32_t readLE32(const char* data)
+{
+    uint32_t value {};
+    for (int i = 0; i < 4; i++) {
+        value |= static_cast<uint32_t>(static_cast<unsigned char>(data[i])) << (i * 8); // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+    }
+    return value;
+}
+
+inline void appendLE64(QByteArray& out, const uint64_t value)
+{
+    appendLE32(out, static_cast<uint32_t>(value));
+    appendLE32(out, static_cast<uint32_t>(value >> 32));
+}
+
+inline uint64_t readLE64(const char* data)
+{
+    return readLE32(data) | (static_cast<uint64_t>(readLE32(data + 4)) << 32); // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+}
+
+inline bool isSkippableMagic(const uint32_t magic)
+{
+    return (magic & SKIPPABLE_MAGIC_MASK) == SKIPPABLE_MAGIC_BASE;
+}
+
+// Line index and seek table for the given frames, to be appended after the last one
+inline QByteArray serializeIndex(const std::span<const FrameEntry> frames)
+{
+    const auto count = static_cast<uint32_t>(frames.size());
+    QByteArray index;
+
+    appendLE32(index, LINE_INDEX_MAGIC);
+    appendLE32(index, count * 4);
+    for (const auto& entry : frames) {
+        appendLE32(index, entry.lines);
+    }
+
+    appendLE32(index, SEEK_TABLE_MAGIC);
+    appendLE32(index, (count * 8) + SEEK_TABLE_FOOTER_SIZE);
+    for (const auto& entry : frames) {
+        appendLE32(index, entry.compressedSize);
+        appendLE32(index, entry.size);
+    }
+    appendLE32(index, count);
+    index.append('\0'); // No checksums
+    appendLE32(index, SEEKABLE_MAGIC);
+    return index;
+}
+
+} // namespace SeekableFormat
+
+#endif // SEEKABLEFORMAT_HPP
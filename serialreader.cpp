@@ -0,0 +1,181 @@
+#include "serialreader.hpp"
+#include "linetimestamps.hpp"
+
+#include <QDebug>
+
+#include <cerrno>
+
+SerialReader::SerialReader(QObject* parent)
+    : QThread(parent)
+{
+}
+
+SerialReader::~SerialReader()
+{
+    close();
+}
+
+void SerialReader::setPortName(const QString& newName)
+{
+    Q_ASSERT(!opened);
+    // A reader that has reported an error may still be on its way out of run(), which reads the settings
+    wait();
+    name = newName;
+}
+
+QString SerialReader::portName() const
+{
+    static constexpr QLatin1StringView DEV_PREFIX("/dev/");
+    if (name.startsWith(DEV_PREFIX)) {
+        return name.sliced(DEV_PREFIX.size());
+    }
+    return name;
+}
+
+void SerialReader::setBaudRate(const int newBaud)
+{
+    Q_ASSERT(!opened);
+    // A reader that has reported an error may still be on its way out of run(), which reads the settings
+    wait();
+    baud = newBaud;
+}
+
+int SerialReader::baudRate() const
+{
+    return baud;
+}
+
+bool SerialReader::open()
+{
+    // The previous reader might still be winding down after reporting an error
+    wait();
+
+    start(QThread::TimeCriticalPriority);
+    openDone.acquire();
+
+    if (!openResult) {
+        wait();
+        errno = openErrno;
+        return false;
+    }
+    return true;
+}
+
+void SerialReader::close()
+{
+    requestInterruption();
+    wait();
+}
+
+bool SerialReader::isOpen() const
+{
+    return opened;
+}
+
+QByteArray SerialReader::readAll()
+{
+    // Clear the flag before reading so that anything committed after this point triggers a new notification
+    notifyPending = false;
+
+    QByteArray result;
+    result.reserve(static_cast<qsizetype>(ring.size()));
+    const auto begin = ring.readPosition();
+
+    // At most two iterations, the second one picks up the part that wrapped around
+    for (auto span = ring.readableSpan(); !span.empty(); span = ring.readableSpan()) {
+        result.append(span.data(), static_cast<qsizetype>(span.size()));
+        ring.commitRead(span.size());
+    }
+
+    readArrivals = arrivals.take(begin, ring.readPosition());
+    return result;
+}
+
+size_t SerialReader::bufferCapacity() const
+{
+    return ring.capacity();
+}
+
+size_t SerialReader::bufferHighWaterMark() const
+{
+    return ring.highWaterMark();
+}
+
+uint64_t SerialReader::bufferFullCount() const
+{
+    return ringFullCount;
+}
+
+void SerialReader::run()
+{
+    // The port is created here so that it belongs to this thread
+    QSerialPort port;
+    port.setPortName(name);
+    port.setBaudRate(baud);
+
+    errno = 0;
+    openResult = port.open(QIODevice::ReadOnly);
+    openErrno = errno;
+    opened = openResult;
+    openDone.release();
+
+    if (!openResult) {
+        return;
+    }
+
+    // NOLINTNEXTLINE(altera-id-dependent-backward-branch)
+    while (!isInterruptionRequested()) {
+        // QSerialPort's internal buffer is unbounded, so we keep moving data out of the kernel even when the ring is full.
+        // In that case we only wait briefly so that the leftover data is moved into the ring as soon as possible.
+        const auto waitTime = port.bytesAvailable() ? RING_FULL_RETRY_MS : POLL_INTERVAL_MS;
+        if (!port.waitForReadyRead(waitTime)) {
+            const auto error = port.error();
+            if (error != QSerialPort::NoError && error != QSerialPort::TimeoutError) {
+                opened = false;
+                notify();
+                emit errorOccurred(error);
+                return;
+            }
+            port.clearError();
+        }
+
+        // A mark that didn't fit while the GUI thread was behind
+        void(arrivals.flush());
+
+        bool newData {};
+        const auto readTime = LineTimestamps::now();
+        while (port.bytesAvailable() > 0) {
+            const auto span = ring.writableSpan();
+            if (span.empty()) {
+                ringFullCount++;
+                break;
+            }
+
+            const auto count = port.read(span.data(), static_cast<qint64>(span.size()));
+            if (count <= 0) {
+                break;
+            }
+            // Before the data is visible to the GUI thread, everything read after one wakeup shares its time
+            if (!newData) {
+                arrivals.mark(ring.writePosition(), readTime);
+            }
+            ring.commitWrite(static_cast<size_t>(count));
+            newData = true;
+        }
+
+        if (newData) {
+            notify();
+        }
+    }
+
+    port.close();
+    opened = false;
+}
+
+void SerialReader::notify()
+{
+    // Only one readyRead() is kept in flight, the GUI thread drains everything available when it gets to it
+    if (!notifyPending.exchange(true)) {
+        emit readyRead();
+    }
+}
@@ -0,0 +1,82 @@
+#ifndef SERIALREADER_HPP
+#define SERIALREADER_HPP
+
+#include "arrivalqueue.hpp"
+#include "spscringbuffer.hpp"
+
+#include <QByteArray>
+#include <QSemaphore>
+#include <QString>
+#include <QThread>
+#include <QtSerialPort/QSerialPort>
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+// Reads the serial port on a dedicated thread so that a busy GUI thread (KTextEditor relayout, highlighting, ...)
+// cannot cause the UART to overflow. Data is handed over to the GUI thread through a lock-free ring buffer.
+// The interface mimics the parts of QSerialPort used by MainWindow.
+class SerialReader final : public QThread {
+    Q_OBJECT
+
+public:
+    explicit SerialReader(QObject* parent = nullptr);
+    SerialReader(const SerialReader&) = delete;
+    SerialReader(SerialReader&&) = delete;
+    SerialReader& operator=(const SerialReader&) = delete;
+    SerialReader& operator=(SerialReader&&) = delete;
+    ~SerialReader() override;
+
+    void setPortName(const QString& newName);
+    // Port name without the "/dev/" prefix, same as QSerialPort::portName()
+    [[nodiscard]] QString portName() const;
+    void setBaudRate(const int newBaud);
+    [[nodiscard]] int baudRate() const;
+
+    // Opens the port and starts the reader thread. On failure errno is set to the error returned by the open call
+    bool open();
+    void close();
+    [[nodiscard]] bool isOpen() const;
+
+    // Must only be called from the thread that owns this object
+    [[nodiscard]] QByteArray readAll();
+    // When the data returned by the last readAll() was read (LineTimestamps::now()), one mark per read, see
+    // ArrivalQueue::take()
+    [[nodiscard]] const std::vector<ArrivalQueue::Mark>& arrivalTimes() const { return readArrivals; }
+
+    [[nodiscard]] size_t bufferCapacity() const;
+    [[nodiscard]] size_t bufferHighWaterMark() const;
+    // Number of times the reader had to wait because the ring buffer was full
+    [[nodiscard]] uint64_t bufferFullCount() const;
+
+signals:
+    void readyRead();
+    void errorOccurred(QSerialPort::SerialPortError error);
+
+protected:
+    void run() override;
+
+private:
+    static constexpr size_t RING_BUFFER_SIZE = 8 * 1024 * 1024;
+    static constexpr int POLL_INTERVAL_MS = 100;
+    static constexpr int RING_FULL_RETRY_MS = 1;
+
+    QString name;
+    int baud {};
+
+    SpscRingBuffer ring { RING_BUFFER_SIZE };
+    std::atomic_bool notifyPending {};
+    ArrivalQueue arrivals;
+    std::vector<ArrivalQueue::Mark> readArrivals;
+    std::atomic_bool opened {};
+    std::atomic<uint64_t> ringFullCount {};
+
+    QSemaphore openDone;
+    bool openResult {};
+    int openErrno {};
+
+    void notify();
+};
+
+#endif // SERIALREADER_HPP
@@ -2,7 +2,7 @@
 #include "ui_settingsdialog.h"
 #include <QPushButton>
 
-SettingsDialog::SettingsDialog(const size_t newBufferSize, QWidget* parent)
+SettingsDialog::SettingsDialog(const size_t newBufferSize, const int newRefreshRate, QWidget* parent)
     : QDialog(parent)
     , ui(new Ui::SettingsDialog)
     , validator(1, 100 * 1024 * 1024, this)
@@ -20,6 +20,7 @@ SettingsDialog::SettingsDialog(const size_t newBufferSize, QWidget* parent)
     } else {
         ui->infiniteRadioButton->toggle();
     }
+    ui->refreshRateSpinBox->setValue(newRefreshRate);
 }
 
 SettingsDialog::~SettingsDialog()
@@ -41,6 +42,11 @@ quint32 SettingsDialog::getBufferSize() const
     return 0;
 }
 
+int SettingsDialog::getRefreshRate() const
+{
+    return ui->refreshRateSpinBox->value();
+}
+
 void SettingsDialog::updateOkButtonState()
 {
     const auto& txt = ui->lineEdit->text();
@@ -12,11 +12,12 @@ class SettingsDialog : public QDialog {
     Q_OBJECT
 
 public:
-    explicit SettingsDialog(const size_t newBufferSize,
+    explicit SettingsDialog(const size_t newBufferSize, const int newRefreshRate,
         QWidget* parent = nullptr);
     ~SettingsDialog() override;
 
     [[nodiscard]] quint32 getBufferSize() const;
+    [[nodiscard]] int getRefreshRate() const;
 
     SettingsDialog(const SettingsDialog&) = delete;
     SettingsDialog(SettingsDialog&&) = delete;
@@ -0,0 +1,101 @@
+#ifndef SPSCRINGBUFFER_HPP
+#define SPSCRINGBUFFER_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <span>
+#include <stdexcept>
+
+// Lock-free single producer/single consumer byte ring.
+// The producer only writes `writeIdx` and the consumer only writes `readIdx`, the indices are never wrapped, only
+// the offsets derived from them are. All storage is allocated up front, nothing is allocated while streaming.
+class SpscRingBuffer final {
+public:
+    explicit SpscRingBuffer(const size_t capacity)
+        : bufferCapacity(capacity)
+        , mask(capacity - 1)
+    {
+        if (capacity == 0 || (capacity & (capacity - 1)) != 0) {
+            throw std::invalid_argument("Ring buffer capacity must be a power of two");
+        }
+        // NOLINTNEXTLINE(cppcoreguidelines-avoid-c-arrays,hicpp-avoid-c-arrays,modernize-avoid-c-arrays)
+        buffer = std::make_unique<char[]>(capacity);
+    }
+    SpscRingBuffer(const SpscRingBuffer&) = delete;
+    SpscRingBuffer(SpscRingBuffer&&) = delete;
+    SpscRingBuffer& operator=(const SpscRingBuffer&) = delete;
+    SpscRingBuffer& operator=(SpscRingBuffer&&) = delete;
+    ~SpscRingBuffer() = default;
+
+    // Producer: contiguous free space, may be smaller than the total free space when the free region wraps around
+    [[nodiscard]] std::span<char> writableSpan() noexcept
+    {
+        const auto head = writeIdx.load(std::memory_order_relaxed);
+        const auto tail = readIdx.load(std::memory_order_acquire);
+        const auto offset = head & mask;
+        const auto freeSpace = bufferCapacity - (head - tail);
+
+        return { buffer.get() + offset, std::min(freeSpace, bufferCapacity - offset) }; // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+    }
+
+    // Producer: publish `count` bytes written into the span returned by writableSpan()
+    void commitWrite(const size_t count) noexcept
+    {
+        const auto head = writeIdx.load(std::memory_order_relaxed) + count;
+        writeIdx.store(head, std::memory_order_release);
+
+        // Only the producer updates the peak, a relaxed load of the consumer index is good enough for statistics
+        const auto used = head - readIdx.load(std::memory_order_relaxed);
+        if (used > peak.load(std::memory_order_relaxed)) {
+            peak.store(used, std::memory_order_relaxed);
+        }
+    }
+
+    // Consumer: contiguous readable data, call again after commitRead() to get the part that wrapped around
+    [[nodiscard]] std::span<const char> readableSpan() const noexcept
+    {
+        const auto tail = readIdx.load(std::memory_order_relaxed);
+        const auto head = writeIdx.load(std::memory_order_acquire);
+        const auto offset = tail & mask;
+
+        return { buffer.get() + offset, std::min(head - tail, bufferCapacity - offset) }; // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+    }
+
+    // Consumer: release `count` bytes returned by readableSpan()
+    void commitRead(const size_t count) noexcept
+    {
+        readIdx.store(readIdx.load(std::memory_order_relaxed) + count, std::memory_order_release);
+    }
+
+    [[nodiscard]] size_t size() const noexcept
+    {
+        return writeIdx.load(std::memory_order_acquire) - readIdx.load(std::memory_order_acquire);
+    }
+
+    [[nodiscard]] size_t capacity() const noexcept { return bufferCapacity; }
+
+    // Producer: number of bytes committed so far, which is the position of the next byte written
+    [[nodiscard]] size_t writePosition() const noexcept { return writeIdx.load(std::memory_order_relaxed); }
+    // Consumer: number of bytes released so far
+    [[nodiscard]] size_t readPosition() const noexcept { return readIdx.load(std::memory_order_relaxed); }
+
+    // Largest number of bytes that were waiting in the ring at any point
+    [[nodiscard]] size_t highWaterMark() const noexcept { return peak.load(std::memory_order_relaxed); }
+
+private:
+    static constexpr size_t CACHE_LINE_SIZE = 64;
+
+    // NOLINTNEXTLINE(cppcoreguidelines-avoid-c-arrays,hicpp-avoid-c-arrays,modernize-avoid-c-arrays)
+    std::unique_ptr<char[]> buffer;
+    const size_t bufferCapacity;
+    const size_t mask;
+
+    // Keep the indices on separate cache lines so that the producer and consumer don't keep invalidating each other
+    alignas(CACHE_LINE_SIZE) std::atomic<size_t> writeIdx {};
+    alignas(CACHE_LINE_SIZE) std::atomic<size_t> readIdx {};
+    alignas(CACHE_LINE_SIZE) std::atomic<size_t> peak {};
+};
+
+#endif // SPSCRINGBUFFER_HPP
@@ -0,0 +1,101 @@
+#include "timeindex.hpp"
+#include "seekableformat.hpp"
+
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QIODevice>
+
+#include <algorithm>
+#include <iterator>
+#include <stdexcept>
+
+QString TimeIndex::filenameFor(const QString& archive)
+{
+    return archive + QStringLiteral(".tidx");
+}
+
+QByteArray TimeIndex::serialize(const std::span<const Entry> entries, const bool withHeader)
+{
+    QByteArray out;
+    out.reserve(HEADER_SIZE + (static_cast<qsizetype>(entries.size()) * ENTRY_SIZE));
+
+    if (withHeader) {
+        SeekableFormat::appendLE32(out, MAGIC);
+        SeekableFormat::appendLE32(out, static_cast<uint32_t>(BUCKET_MS));
+    }
+    for (const auto& entry : entries) {
+        SeekableFormat::appendLE64(out, static_cast<uint64_t>(entry.timeMs));
+        SeekableFormat::appendLE32(out, entry.frame);
+        SeekableFormat::appendLE64(out, static_cast<uint64_t>(entry.line));
+    }
+
+    return out;
+}
+
+std::vector<TimeIndex::Entry> TimeIndex::load(const QString& filename)
+{
+    QFile file(filename);
+    if (!file.open(QIODevice::ReadOnly)) {
+        throw std::runtime_error(QStringLiteral("Failed to open %1: %2").arg(filename, file.errorString()).toStdString());
+    }
+    const auto data = file.readAll();
+    if (data.size() < HEADER_SIZE || SeekableFormat::readLE32(data.constData()) != MAGIC) {
+        throw std::runtime_error(QStringLiteral("%1 is not a time index").arg(filename).toStdString());
+    }
+
+    // A partial entry at the end is what a crash while appending leaves behind
+    const auto count = (data.size() - HEADER_SIZE) / ENTRY_SIZE;
+    std::vector<Entry> entries;
+    entries.reserve(static_cast<size_t>(count));
+    for (qsizetype i = 0; i < count; i++) {
+        const auto* const entry = data.constData() + HEADER_SIZE + (i * ENTRY_SIZE); // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+        entries.push_back({ static_cast<qint64>(SeekableFormat::readLE64(entry)),
+            SeekableFormat::readLE32(entry + 8), // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+            static_cast<qint64>(SeekableFormat::readLE64(entry + 12)) }); // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+    }
+
+    return entries;
+}
+
+std::vector<TimeIndex::Match> TimeIndex::find(const QString& directory, const QString& portName, const qint64 fromMs, const qint64 toMs)
+{
+    std::vector<Match> matches;
+    const auto pattern = (portName.isEmpty() ? QStringLiteral("*") : portName + QStringLiteral("_*")) + QStringLiteral(".txt.zst.tidx");
+    const auto files = QDir(directory).entryInfoList({ pattern }, QDir::Files);
+
+    // NOLINTNEXTLINE(altera-id-dependent-backward-branch)
+    for (const auto& info : files) {
+        std::vector<Entry> entries;
+        try {
+            entries = load(info.filePath());
+        } catch (std::exception& e) {
+            qWarning() << e.what();
+            continue;
+        }
+        // The last bucket can hold data up to BUCKET_MS after its first chunk
+        if (entries.empty() || entries.front().timeMs > toMs || entries.back().timeMs + BUCKET_MS <= fromMs) {
+            continue;
+        }
+
+        Match match;
+        match.archive = info.filePath();
+        match.archive.chop(QStringLiteral(".tidx").size());
+        match.startMs = entries.front().timeMs;
+
+        // Start at the bucket `fromMs` falls in
+        const auto first = std::upper_bound(entries.cbegin(), entries.cend(), fromMs,
+            [](const qint64 value, const Entry& entry) { return value < entry.timeMs; });
+        match.firstLine = (first == entries.cbegin()) ? 0 : std::prev(first)->line;
+
+        // End with the line the first chunk after `toMs` starts in, it may have begun before
+        const auto last = std::upper_bound(entries.cbegin(), entries.cend(), toMs,
+            [](const qint64 value, const Entry& entry) { return value < entry.timeMs; });
+        match.endLine = (last == entries.cend()) ? -1 : last->line + 1;
+
+        matches.push_back(match);
+    }
+
+    std::sort(matches.begin(), matches.end(), [](const Match& a, const Match& b) { return a.startMs < b.startMs; });
+    return matches;
+}
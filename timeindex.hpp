@@ -0,0 +1,51 @@
+#ifndef TIMEINDEX_HPP
+#define TIMEINDEX_HPP
+
+#include <QByteArray>
+#include <QString>
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+// Sidecar index of when the data in a long term run mode archive arrived, stored as <archive>.tidx.
+// There's one entry per BUCKET_MS interval in which data arrived: the arrival time of the first chunk in that
+// interval, the frame it was written to and the line it starts in. Entries are only ever appended, so an index cut
+// short by a crash is still valid for the frames it covers.
+class TimeIndex final {
+public:
+    static constexpr qint64 BUCKET_MS = 1000;
+
+    struct Entry {
+        // ms since epoch
+        qint64 timeMs {};
+        uint32_t frame {};
+        // Number of '\n' in the archive before the chunk
+        qint64 line {};
+    };
+
+    // Lines of an archive that arrived in the requested interval
+    struct Match {
+        QString archive;
+        qint64 startMs {};
+        qint64 firstLine {};
+        // Exclusive, -1 for the end of the archive
+        qint64 endLine {};
+    };
+
+    [[nodiscard]] static QString filenameFor(const QString& archive);
+    [[nodiscard]] static QByteArray serialize(const std::span<const Entry> entries, const bool withHeader);
+    // Throws std::runtime_error if the file can't be read or isn't an index
+    [[nodiscard]] static std::vector<Entry> load(const QString& filename);
+
+    // Archives in `directory` holding data that arrived in [fromMs, toMs], oldest first.
+    // `portName` restricts the search to the archives of one port. The line ranges are widened to whole buckets.
+    [[nodiscard]] static std::vector<Match> find(const QString& directory, const QString& portName, const qint64 fromMs, const qint64 toMs);
+
+private:
+    static constexpr uint32_t MAGIC = 0x58495459; // "YTIX"
+    static constexpr qsizetype HEADER_SIZE = 8;
+    static constexpr qsizetype ENTRY_SIZE = 20;
+};
+
+#endif // TIMEINDEX_HPP
@@ -0,0 +1,42 @@
+#include "timestampgutter.hpp"
+#include "linetimestamps.hpp"
+
+#include <QDateTime>
+#include <QLocale>
+
+TimestampGutter::TimestampGutter(const LineTimestamps& newTimestamps, QObject* parent)
+    : KTextEditor::AnnotationModel(parent)
+    , timestamps(newTimestamps)
+{
+}
+
+QVariant TimestampGutter::data(int line, Qt::ItemDataRole role) const
+{
+    if (line < 0 || (role != Qt::DisplayRole && role != Qt::ToolTipRole)) {
+        return {};
+    }
+
+    const auto timeUs = timestamps.at(static_cast<size_t>(line));
+    if (timeUs < 0) {
+        return {};
+    }
+
+    const auto arrival = QDateTime::fromMSecsSinceEpoch(LineTimestamps::toEpochMs(timeUs));
+    if (role == Qt::DisplayRole) {
+        return arrival.toString(QStringLiteral("HH:mm:ss.zzz"));
+    }
+
+    auto toolTip = QLocale().toString(arrival, QLocale::LongFormat);
+    if (line > 0) {
+        if (const auto previousUs = timestamps.at(static_cast<size_t>(line - 1)); previousUs >= 0) {
+            const auto deltaMs = static_cast<double>(timeUs - previousUs) / 1000;
+            toolTip += QStringLiteral("\n+%1 ms after the previous line").arg(deltaMs, 0, 'f', 3);
+        }
+    }
+    return toolTip;
+}
+
+void TimestampGutter::linesRemoved()
+{
+    emit reset();
+}
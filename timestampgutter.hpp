@@ -0,0 +1,32 @@
+#ifndef TIMESTAMPGUTTER_HPP
+#define TIMESTAMPGUTTER_HPP
+
+#include <KTextEditor/AnnotationInterface>
+
+#include <QVariant>
+
+class LineTimestamps;
+
+// Shows the arrival time of each line in the annotation border of the view. The times are looked up when a line is
+// painted, nothing is stored per line beyond what LineTimestamps keeps anyway.
+class TimestampGutter final : public KTextEditor::AnnotationModel {
+    Q_OBJECT
+
+public:
+    explicit TimestampGutter(const LineTimestamps& newTimestamps, QObject* parent = nullptr);
+    TimestampGutter(const TimestampGutter&) = delete;
+    TimestampGutter(TimestampGutter&&) = delete;
+    TimestampGutter& operator=(const TimestampGutter&) = delete;
+    TimestampGutter& operator=(TimestampGutter&&) = delete;
+    ~TimestampGutter() override = default;
+
+    [[nodiscard]] QVariant data(int line, Qt::ItemDataRole role) const override;
+
+    // Must be called when lines are removed from the top of the document, the times of all visible lines change
+    void linesRemoved();
+
+private:
+    const LineTimestamps& timestamps;
+};
+
+#endif // TIMESTAMPGUTTER_HPP
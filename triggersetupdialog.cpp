@@ -1,7 +1,13 @@
 #include "triggersetupdialog.h"
 #include "ui_triggersetupdialog.h"
 
+#include <QHeaderView>
 #include <QPushButton>
+#include <QRegularExpression>
+#include <QTableWidgetItem>
+
+#include <algorithm>
+#include <functional>
 
 TriggerSetupDialog::TriggerSetupDialog(QWidget* parent)
     : QDialog(parent)
@@ -9,10 +15,18 @@ TriggerSetupDialog::TriggerSetupDialog(QWidget* parent)
 {
     ui->setupUi(this);
 
+    ui->rulesTableWidget->setColumnCount(ColumnCount);
+    ui->rulesTableWidget->setHorizontalHeaderLabels({ QStringLiteral("Keyword"), QStringLiteral("Regex"), QStringLiteral("Command") });
+    ui->rulesTableWidget->horizontalHeader()->setSectionResizeMode(KeywordColumn, QHeaderView::Stretch);
+    ui->rulesTableWidget->horizontalHeader()->setSectionResizeMode(RegexColumn, QHeaderView::ResizeToContents);
+    handleAddRuleButton();
+
     connect(ui->groupBox, &QGroupBox::toggled, this, &TriggerSetupDialog::handleLineEditTextChange);
     // Disable the OK button if a line edit is empty
-    connect(ui->keywordLineEdit, &QLineEdit::textChanged, this, &TriggerSetupDialog::handleLineEditTextChange);
+    connect(ui->rulesTableWidget, &QTableWidget::itemChanged, this, &TriggerSetupDialog::handleLineEditTextChange);
     connect(ui->cmdLineEdit, &QLineEdit::textChanged, this, &TriggerSetupDialog::handleLineEditTextChange);
+    connect(ui->addRuleButton, &QPushButton::clicked, this, &TriggerSetupDialog::handleAddRuleButton);
+    connect(ui->removeRuleButton, &QPushButton::clicked, this, &TriggerSetupDialog::handleRemoveRuleButton);
 
     connect(ui->stringRadioButton, &QRadioButton::toggled, this, &TriggerSetupDialog::handleStringRadioButton);
     connect(ui->execCmdRadioButton, &QRadioButton::toggled, this, &TriggerSetupDialog::handleExecCmdRadioButton);
@@ -54,10 +68,25 @@ TriggerSetupDialog::TriggerType TriggerSetupDialog::getTriggerType() const
     return TriggerType::Disabled;
 }
 
-QString TriggerSetupDialog::getKeyword() const
+std::vector<TriggerSetupDialog::TriggerRule> TriggerSetupDialog::getRules() const
 {
     Q_ASSERT(ui->stringRadioButton->isChecked());
-    return ui->keywordLineEdit->text();
+
+    std::vector<TriggerRule> rules;
+    for (int row = 0; row < ui->rulesTableWidget->rowCount(); row++) {
+        const auto* keywordItem = ui->rulesTableWidget->item(row, KeywordColumn);
+        const auto* regexItem = ui->rulesTableWidget->item(row, RegexColumn);
+        const auto* commandItem = ui->rulesTableWidget->item(row, CommandColumn);
+
+        if (!keywordItem || keywordItem->text().isEmpty()) {
+            continue;
+        }
+        rules.push_back({ keywordItem->text(),
+            regexItem && regexItem->checkState() == Qt::Checked,
+            commandItem ? commandItem->text().trimmed() : QString() });
+    }
+
+    return rules;
 }
 
 QString TriggerSetupDialog::getTriggerActionCommand() const
@@ -75,7 +104,9 @@ void TriggerSetupDialog::handleStringRadioButton()
 {
     const auto isEnabled = ui->stringRadioButton->isChecked();
     ui->label->setEnabled(isEnabled);
-    ui->keywordLineEdit->setEnabled(isEnabled);
+    ui->rulesTableWidget->setEnabled(isEnabled);
+    ui->addRuleButton->setEnabled(isEnabled);
+    ui->removeRuleButton->setEnabled(isEnabled);
 
     handleLineEditTextChange();
 }
@@ -92,7 +123,7 @@ void TriggerSetupDialog::handleLineEditTextChange()
 {
     bool enable = true;
     if (ui->groupBox->isChecked()) {
-        if (ui->stringRadioButton->isChecked() && ui->keywordLineEdit->text().isEmpty()) {
+        if (ui->stringRadioButton->isChecked() && (getRules().empty() || !areRulesValid())) {
             enable = false;
         }
 
@@ -103,3 +134,60 @@ void TriggerSetupDialog::handleLineEditTextChange()
 
     ui->buttonBox->button(QDialogButtonBox::Ok)->setEnabled(enable);
 }
+
+void TriggerSetupDialog::handleAddRuleButton()
+{
+    const auto row = ui->rulesTableWidget->rowCount();
+    ui->rulesTableWidget->insertRow(row);
+    ui->rulesTableWidget->setItem(row, KeywordColumn, new QTableWidgetItem()); // NOLINT(cppcoreguidelines-owning-memory)
+    ui->rulesTableWidget->setItem(row, CommandColumn, new QTableWidgetItem()); // NOLINT(cppcoreguidelines-owning-memory)
+
+    auto* regexItem = new QTableWidgetItem(); // NOLINT(cppcoreguidelines-owning-memory)
+    regexItem->setFlags(Qt::ItemIsUserCheckable | Qt::ItemIsEnabled | Qt::ItemIsSelectable);
+    regexItem->setCheckState(Qt::Unchecked);
+    ui->rulesTableWidget->setItem(row, RegexColumn, regexItem);
+    ui->rulesTableWidget->editItem(ui->rulesTableWidget->item(row, KeywordColumn));
+}
+
+void TriggerSetupDialog::handleRemoveRuleButton()
+{
+    std::vector<int> rows;
+    for (const auto& index : ui->rulesTableWidget->selectionModel()->selectedRows()) {
+        rows.push_back(index.row());
+    }
+
+    // Remove from the bottom so that the remaining row numbers stay valid
+    std::sort(rows.begin(), rows.end(), std::greater<>());
+    for (const auto row : rows) {
+        ui->rulesTableWidget->removeRow(row);
+    }
+
+    handleLineEditTextChange();
+}
+
+bool TriggerSetupDialog::areRulesValid()
+{
+    bool valid = true;
+    for (int row = 0; row < ui->rulesTableWidget->rowCount(); row++) {
+        auto* keywordItem = ui->rulesTableWidget->item(row, KeywordColumn);
+        const auto* regexItem = ui->rulesTableWidget->item(row, RegexColumn);
+        if (!keywordItem || !regexItem) {
+            continue;
+        }
+
+        QString errStr;
+        if (regexItem->checkState() == Qt::Checked && !keywordItem->text().isEmpty()) {
+            if (const QRegularExpression expression(keywordItem->text()); !expression.isValid()) {
+                errStr = QStringLiteral("Invalid regular expression: %1").arg(expression.errorString());
+                valid = false;
+            }
+        }
+
+        // Updating the tooltip emits itemChanged(), avoid looping back here when nothing changed
+        if (keywordItem->toolTip() != errStr) {
+            keywordItem->setToolTip(errStr);
+        }
+    }
+
+    return valid;
+}
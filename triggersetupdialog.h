@@ -2,6 +2,9 @@
 #define TRIGGERSETUPDIALOG_H
 
 #include <QDialog>
+#include <QString>
+
+#include <vector>
 
 namespace Ui {
 class TriggerSetupDialog;
@@ -29,8 +32,18 @@ public:
         ExecuteCommand
     };
 
+    struct TriggerRule {
+        QString keyword;
+        // The keyword is a regular expression that is matched against complete lines
+        bool isRegex {};
+        // Executed when the keyword matches, the trigger action is used instead if this is empty
+        QString command;
+
+        bool operator==(const TriggerRule&) const = default;
+    };
+
     [[nodiscard]] TriggerType getTriggerType() const;
-    [[nodiscard]] QString getKeyword() const;
+    [[nodiscard]] std::vector<TriggerRule> getRules() const;
 
     [[nodiscard]] TriggerActionType getTriggerActionType() const;
     [[nodiscard]] QString getTriggerActionCommand() const;
@@ -38,10 +51,21 @@ public:
 private:
     Ui::TriggerSetupDialog* ui {};
 
+    [[nodiscard]] bool areRulesValid();
+
+    enum RuleColumn : std::uint8_t {
+        KeywordColumn,
+        RegexColumn,
+        CommandColumn,
+        ColumnCount
+    };
+
 private slots:
     void handleStringRadioButton();
     void handleExecCmdRadioButton();
     void handleLineEditTextChange();
+    void handleAddRuleButton();
+    void handleRemoveRuleButton();
 };
 
 #endif // TRIGGERSETUPDIALOG_H
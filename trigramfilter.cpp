@@ -0,0 +1,155 @@
+#include "trigramfilter.hpp"
+#include "seekableformat.hpp"
+
+#include <QDebug>
+#include <QFile>
+#include <QIODevice>
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+
+static constexpr uint32_t TRIGRAM_BITS = 24;
+
+static inline uint32_t foldCase(const char c)
+{
+    const auto byte = static_cast<uint8_t>(c);
+    return (byte >= 'A' && byte <= 'Z') ? byte | 0x20U : byte;
+}
+
+// Unicode case folding also matches characters outside ASCII: non-ASCII letters with their other case, 'k' with
+// KELVIN SIGN and 's' with LATIN SMALL LETTER LONG S
+static inline bool hasNonAsciiCaseVariant(const char c)
+{
+    const auto byte = foldCase(c);
+    return byte > 0x7F || byte == 'k' || byte == 's';
+}
+
+// Bit positions of a trigram in a filter of `bits` bits (double hashing)
+static inline uint64_t bloomHash(const uint32_t trigram, const uint32_t i, const uint64_t bits)
+{
+    auto h = static_cast<uint64_t>(trigram) * 0x9E3779B97F4A7C15ULL;
+    h ^= h >> 29;
+    const auto h1 = h;
+    const auto h2 = (h * 0xBF58476D1CE4E5B9ULL) | 1;
+    return (h1 + (i * h2)) % bits;
+}
+
+TrigramFilter::TrigramFilter()
+    : seen((1ULL << TRIGRAM_BITS) / 64)
+{
+}
+
+void TrigramFilter::add(const char* data, const size_t len)
+{
+    size_t i {};
+    // The first trigram of the archive needs three bytes
+    for (; i < len && windowFill < 2; i++, windowFill++) {
+        window = (window << 8) | foldCase(data[i]); // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+    }
+
+    auto w = window;
+    for (; i < len; i++) {
+        w = ((w << 8) | foldCase(data[i])) & ((1U << TRIGRAM_BITS) - 1); // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+        seen[w / 64] |= 1ULL << (w % 64);
+    }
+    window = w;
+}
+
+void TrigramFilter::reset()
+{
+    std::fill(seen.begin(), seen.end(), 0);
+    window = 0;
+    windowFill = 0;
+}
+
+QByteArray TrigramFilter::build(Stats& stats) const
+{
+    quint64 count {};
+    for (const auto word : seen) {
+        count += static_cast<quint64>(std::popcount(word));
+    }
+
+    // Optimal size for the target rate, m = -n ln(p) / ln(2)^2
+    const auto optimalBits = -static_cast<double>(count) * std::log(TARGET_FALSE_POSITIVE_RATE) / (std::log(2.0) * std::log(2.0));
+    const auto bits = std::max<uint64_t>(64, (static_cast<uint64_t>(optimalBits) + 63) / 64 * 64);
+    std::vector<uint64_t> filter(bits / 64);
+
+    for (size_t word = 0; word < seen.size(); word++) {
+        // NOLINTNEXTLINE(altera-id-dependent-backward-branch)
+        for (auto remaining = seen[word]; remaining; remaining &= remaining - 1) {
+            const auto trigram = static_cast<uint32_t>((word * 64) + static_cast<size_t>(std::countr_zero(remaining)));
+            for (uint32_t i = 0; i < HASH_COUNT; i++) {
+                const auto bit = bloomHash(trigram, i, bits);
+                filter[bit / 64] |= 1ULL << (bit % 64);
+            }
+        }
+    }
+
+    QByteArray out;
+    out.reserve(HEADER_SIZE + static_cast<qsizetype>(bits / 8));
+    SeekableFormat::appendLE32(out, MAGIC);
+    SeekableFormat::appendLE32(out, HASH_COUNT);
+    SeekableFormat::appendLE64(out, bits);
+    SeekableFormat::appendLE64(out, count);
+    for (const auto word : filter) {
+        SeekableFormat::appendLE64(out, word);
+    }
+
+    stats.trigrams = count;
+    stats.size = out.size();
+    stats.falsePositiveRate = std::pow(1.0 - std::exp(-static_cast<double>(HASH_COUNT) * static_cast<double>(count) / static_cast<double>(bits)),
+        static_cast<double>(HASH_COUNT));
+    return out;
+}
+
+QString TrigramFilter::filenameFor(const QString& archive)
+{
+    return archive + QStringLiteral(".bloom");
+}
+
+QByteArray TrigramFilter::load(const QString& filename)
+{
+    QFile file(filename);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return {};
+    }
+    auto filter = file.readAll();
+    if (filter.size() < HEADER_SIZE || SeekableFormat::readLE32(filter.constData()) != MAGIC) {
+        qWarning() << filename << "is not a trigram filter";
+        return {};
+    }
+    const auto bits = SeekableFormat::readLE64(filter.constData() + 8); // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+    if (bits == 0 || bits % 64 != 0 || static_cast<quint64>(filter.size() - HEADER_SIZE) != bits / 8) {
+        qWarning() << filename << "is truncated";
+        return {};
+    }
+    return filter;
+}
+
+bool TrigramFilter::mayContain(const QByteArray& filter, const std::string_view literal, const bool ignoreCase)
+{
+    if (filter.isEmpty() || literal.size() < 3) {
+        return true;
+    }
+
+    const auto hashCount = SeekableFormat::readLE32(filter.constData() + 4); // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+    const auto bits = SeekableFormat::readLE64(filter.constData() + 8); // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+    const auto* const words = filter.constData() + HEADER_SIZE; // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+
+    for (size_t pos = 0; pos + 3 <= literal.size(); pos++) {
+        if (ignoreCase
+            && (hasNonAsciiCaseVariant(literal[pos]) || hasNonAsciiCaseVariant(literal[pos + 1]) || hasNonAsciiCaseVariant(literal[pos + 2]))) {
+            continue;
+        }
+        const auto trigram = (foldCase(literal[pos]) << 16) | (foldCase(literal[pos + 1]) << 8) | foldCase(literal[pos + 2]);
+        for (uint32_t i = 0; i < hashCount; i++) {
+            const auto bit = bloomHash(trigram, i, bits);
+            // NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+            if (!(SeekableFormat::readLE64(words + ((bit / 64) * 8)) & (1ULL << (bit % 64)))) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
@@ -0,0 +1,53 @@
+#ifndef TRIGRAMFILTER_HPP
+#define TRIGRAMFILTER_HPP
+
+#include <QByteArray>
+#include <QString>
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+// Bloom filter of the byte trigrams (ASCII case folded) in an archive, stored as <archive>.bloom next to it.
+// A string can only occur in an archive if all its trigrams are in the filter, so searches can skip most archives
+// without decompressing them. The distinct trigrams are collected exactly while the archive is written and the filter
+// is sized for them when it's finished.
+class TrigramFilter final {
+public:
+    struct Stats {
+        quint64 trigrams {};
+        qsizetype size {};
+        // Probability that a trigram not in the archive is reported as present
+        double falsePositiveRate {};
+    };
+
+    TrigramFilter();
+
+    void add(const char* data, const size_t len);
+    void reset();
+
+    // Serialized Bloom filter of everything added since the last reset()
+    [[nodiscard]] QByteArray build(Stats& stats) const;
+
+    [[nodiscard]] static QString filenameFor(const QString& archive);
+    // Empty if the file can't be read or isn't a filter
+    [[nodiscard]] static QByteArray load(const QString& filename);
+    // False if `literal` can't occur in the archive `filter` was built from. With `ignoreCase` the literal may match
+    // with Unicode case folding, trigrams the ASCII folding of the filter can't rule out are not checked.
+    [[nodiscard]] static bool mayContain(const QByteArray& filter, const std::string_view literal, const bool ignoreCase);
+
+private:
+    static constexpr uint32_t MAGIC = 0x46425459; // "YTBF"
+    static constexpr qsizetype HEADER_SIZE = 24;
+    static constexpr double TARGET_FALSE_POSITIVE_RATE = 0.01;
+    static constexpr uint32_t HASH_COUNT = 7;
+
+    // One bit for every possible trigram
+    std::vector<uint64_t> seen;
+    // Last two bytes of the previous add()
+    uint32_t window {};
+    int windowFill {};
+};
+
+#endif // TRIGRAMFILTER_HPP
@@ -0,0 +1,80 @@
+#include "archivereader.hpp"
+#include "timeindex.hpp"
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDateTime>
+#include <QDebug>
+#include <QElapsedTimer>
+
+#include <algorithm>
+#include <cstdio>
+#include <stdexcept>
+
+// Accepts an ISO 8601 date and time or a time of day, which is taken to be today
+[[nodiscard]] static qint64 parseTime(const QString& str)
+{
+    if (const auto dateTime = QDateTime::fromString(str, Qt::ISODateWithMs); dateTime.isValid()) {
+        return dateTime.toMSecsSinceEpoch();
+    }
+    if (const auto time = QTime::fromString(str, Qt::ISODateWithMs); time.isValid()) {
+        return QDateTime(QDate::currentDate(), time).toMSecsSinceEpoch();
+    }
+    return -1;
+}
+
+int main(int argc, char* argv[])
+{
+    const QCoreApplication app(argc, argv);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription(QStringLiteral("Prints the lines yeTTY archived between two points in time"));
+    parser.addHelpOption();
+    const QCommandLineOption portOption({ QStringLiteral("p"), QStringLiteral("port") },
+        QStringLiteral("Only search the archives of this port"), QStringLiteral("PORT_NAME"));
+    const QCommandLineOption statsOption(QStringLiteral("stats"), QStringLiteral("Print timing statistics to stderr"));
+    parser.addOption(portOption);
+    parser.addOption(statsOption);
+    parser.addPositionalArgument(QStringLiteral("DIRECTORY"), QStringLiteral("Directory holding the archives"));
+    parser.addPositionalArgument(QStringLiteral("FROM"), QStringLiteral("Start time, e.g. 2025-01-31T03:12:07 or 03:12:07"));
+    parser.addPositionalArgument(QStringLiteral("TO"), QStringLiteral("End time"));
+    parser.process(app);
+
+    const auto args = parser.positionalArguments();
+    if (args.size() != 3) {
+        parser.showHelp(-1);
+    }
+    const auto fromMs = parseTime(args.at(1));
+    const auto toMs = parseTime(args.at(2));
+    if (fromMs < 0 || toMs < 0 || toMs < fromMs) {
+        qCritical() << "Invalid time range" << args.at(1) << args.at(2);
+        return -1;
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+    const auto matches = TimeIndex::find(args.at(0), parser.value(portOption), fromMs, toMs);
+    const auto lookupMs = timer.elapsed();
+
+    qint64 bytes {};
+    for (const auto& match : matches) {
+        try {
+            ArchiveReader reader(match.archive);
+            // One past the last '\n' to include a last line without one
+            const auto endLine = (match.endLine < 0) ? reader.lineCount() + 1 : std::min(match.endLine, reader.lineCount() + 1);
+            const auto lines = reader.readLines(match.firstLine, endLine - match.firstLine);
+            fwrite(lines.constData(), 1, static_cast<size_t>(lines.size()), stdout);
+            bytes += lines.size();
+        } catch (std::exception& e) {
+            qCritical() << e.what();
+        }
+    }
+    fflush(stdout);
+
+    if (parser.isSet(statsOption)) {
+        qInfo().nospace() << matches.size() << " archives, " << bytes << " bytes, lookup " << lookupMs << " ms, total "
+                          << timer.elapsed() << " ms";
+    }
+
+    return 0;
+}
@@ -0,0 +1,363 @@
+#include "archivereader.hpp"
+#include "literalsearch.hpp"
+#include "timeindex.hpp"
+#include "trigramfilter.hpp"
+
+#include <QByteArrayView>
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDateTime>
+#include <QDebug>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFileInfo>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QRegularExpression>
+#include <QThread>
+#include <QThreadPool>
+#include <QWaitCondition>
+
+#include <algorithm>
+#include <cstdio>
+#include <optional>
+#include <stdexcept>
+#include <vector>
+
+struct Search {
+    QString pattern;
+    QRegularExpression::PatternOptions options;
+    // Every matching line contains this (ignoring case if !caseSensitive), empty if nothing is known
+    std::string literal;
+    bool caseSensitive {};
+    // The literal is the whole pattern
+    bool fixed {};
+};
+
+struct Result {
+    QByteArray output;
+    QString error;
+    qint64 bytes {};
+    qint64 matches {};
+    // Ruled out by the trigram filter
+    bool skipped {};
+    bool done {};
+};
+
+// Longest run of plain characters that every match of `pattern` has to contain, empty if there's none or if the
+// pattern is too complex to tell. Only has to be conservative, not complete.
+[[nodiscard]] static std::string requiredLiteral(const QString& pattern)
+{
+    // Alternatives and inline options (e.g. case insensitivity) can't be handled with a single literal
+    if (pattern.contains(QLatin1Char('|')) || pattern.contains(QStringLiteral("(?"))) {
+        return {};
+    }
+
+    std::string best;
+    std::string run;
+    const auto endRun = [&]() {
+        if (run.size() > best.size()) {
+            best = run;
+        }
+        run.clear();
+    };
+
+    const auto isQuantifier = [](const QChar c) { return c == QLatin1Char('?') || c == QLatin1Char('*') || c == QLatin1Char('{'); };
+
+    for (qsizetype i = 0; i < pattern.size(); i++) {
+        auto c = pattern.at(i);
+
+        if (c == QLatin1Char('\\')) {
+            // Escaped punctuation is literal, letters and digits are classes, anchors or back references
+            i++;
+            c = (i < pattern.size()) ? pattern.at(i) : QChar();
+            if (c.isNull() || c.isLetterOrNumber() || c.unicode() > 0x7F) {
+                endRun();
+                continue;
+            }
+        } else if (c == QLatin1Char('[')) {
+            // Skip the class
+            endRun();
+            // NOLINTNEXTLINE(altera-id-dependent-backward-branch)
+            for (i++; i < pattern.size() && pattern.at(i) != QLatin1Char(']'); i++) {
+                if (pattern.at(i) == QLatin1Char('\\')) {
+                    i++;
+                }
+            }
+            continue;
+        } else if (c == QLatin1Char('(')) {
+            // Groups may be optional, skip them entirely
+            endRun();
+            int depth = 1;
+            // NOLINTNEXTLINE(altera-id-dependent-backward-branch)
+            for (i++; i < pattern.size() && depth > 0; i++) {
+                if (pattern.at(i) == QLatin1Char('\\')) {
+                    i++;
+                } else if (pattern.at(i) == QLatin1Char('(')) {
+                    depth++;
+                } else if (pattern.at(i) == QLatin1Char(')')) {
+                    depth--;
+                }
+            }
+            i--;
+            continue;
+        } else if (c == QLatin1Char('{')) {
+            endRun();
+            i = pattern.indexOf(QLatin1Char('}'), i);
+            if (i < 0) {
+                return {};
+            }
+            continue;
+        } else if (c.unicode() > 0x7F || QStringLiteral(".^$)+?*}").contains(c)) {
+            // '+' keeps the character before it but more may follow
+            endRun();
+            continue;
+        }
+
+        // The character before an optional quantifier is not required
+        if (i + 1 < pattern.size() && isQuantifier(pattern.at(i + 1))) {
+            endRun();
+            continue;
+        }
+        run.push_back(static_cast<char>(c.unicode()));
+    }
+    endRun();
+
+    return best;
+}
+
+// Archives are named <portName>_<date>_<counter>.txt.zst
+[[nodiscard]] static QString portFromFilename(const QString& filename)
+{
+    static const QRegularExpression exp(QStringLiteral(R"(^(.+)_\d{4}-\d{2}-\d{2}-\d{2}_\d{2}-\d{2}_\d+\.txt\.zst$)"));
+    const auto match = exp.match(filename);
+    return match.hasMatch() ? match.captured(1) : QString();
+}
+
+[[nodiscard]] static QByteArray timeOfLine(const std::vector<TimeIndex::Entry>& times, const qint64 line)
+{
+    const auto it = std::upper_bound(times.cbegin(), times.cend(), line,
+        [](const qint64 value, const TimeIndex::Entry& entry) { return value < entry.line; });
+    if (it == times.cbegin()) {
+        return QByteArrayLiteral("-");
+    }
+    return QDateTime::fromMSecsSinceEpoch(std::prev(it)->timeMs).toString(QStringLiteral("yyyy-MM-dd hh:mm:ss")).toUtf8();
+}
+
+static void searchArchive(const QString& path, const Search& search, Result& result)
+{
+    if (!TrigramFilter::mayContain(TrigramFilter::load(TrigramFilter::filenameFor(path)), search.literal, !search.caseSensitive)) {
+        result.skipped = true;
+        return;
+    }
+
+    ArchiveReader reader(path);
+
+    std::vector<TimeIndex::Entry> times;
+    if (const auto indexFile = TimeIndex::filenameFor(path); QFileInfo::exists(indexFile)) {
+        times = TimeIndex::load(indexFile);
+    }
+
+    const auto filename = QFileInfo(path).fileName();
+    const auto prefix = filename.toUtf8() + ':';
+    const auto port = portFromFilename(filename).toUtf8();
+
+    // Compiled per thread, matching with the same object from several threads isn't documented as safe
+    QRegularExpression regex;
+    if (!search.fixed) {
+        regex = QRegularExpression(search.pattern, search.options);
+        regex.optimize();
+    }
+    const std::optional<LiteralSearch> prefilter = (search.literal.empty() || !search.caseSensitive) ? std::nullopt : std::optional<LiteralSearch>(search.literal);
+
+    // Frames end anywhere, the incomplete last line of a frame is searched with the next one
+    QByteArray carry;
+    qint64 line {};
+    const auto& frames = reader.frames();
+    for (size_t i = 0; i < frames.size(); i++) {
+        auto buffer = carry.isEmpty() ? reader.readFrame(i) : carry + reader.readFrame(i);
+        result.bytes += frames[i].size;
+        const auto end = (i + 1 == frames.size()) ? buffer.size() : buffer.lastIndexOf('\n') + 1;
+
+        qsizetype pos {};
+        qsizetype counted {};
+        // NOLINTNEXTLINE(altera-id-dependent-backward-branch)
+        while (pos < end) {
+            auto lineStart = pos;
+            if (prefilter) {
+                const auto hit = prefilter->find(buffer.constData(), static_cast<size_t>(end), static_cast<size_t>(pos));
+                if (hit == LiteralSearch::NOT_FOUND) {
+                    break;
+                }
+                if (const auto hitPos = static_cast<qsizetype>(hit); hitPos > pos) {
+                    lineStart = std::max(pos, buffer.lastIndexOf('\n', hitPos - 1) + 1);
+                }
+            }
+            auto lineEnd = buffer.indexOf('\n', lineStart);
+            if (lineEnd < 0 || lineEnd > end) {
+                lineEnd = end;
+            }
+            line += std::count(buffer.cbegin() + counted, buffer.cbegin() + lineStart, '\n');
+            counted = lineStart;
+
+            const auto text = QByteArrayView(buffer).sliced(lineStart, lineEnd - lineStart);
+            if (search.fixed || regex.match(QString::fromUtf8(text)).hasMatch()) {
+                result.output += prefix + QByteArray::number(line + 1) + ':' + port + ' ' + timeOfLine(times, line) + ": ";
+                result.output += text;
+                result.output += '\n';
+                result.matches++;
+            }
+            pos = lineEnd + 1;
+        }
+        line += std::count(buffer.cbegin() + counted, buffer.cbegin() + end, '\n');
+        carry = buffer.sliced(end);
+    }
+}
+
+[[nodiscard]] static QStringList collectArchives(const QStringList& paths, const QString& portName)
+{
+    QStringList archives;
+    const auto pattern = (portName.isEmpty() ? QStringLiteral("*") : portName + QStringLiteral("_*")) + QStringLiteral(".txt.zst");
+    for (const auto& path : paths) {
+        if (!QFileInfo(path).isDir()) {
+            archives << path;
+            continue;
+        }
+        // Sorting by name sorts by port, then by date
+        const auto files = QDir(path).entryInfoList({ pattern }, QDir::Files, QDir::Name);
+        for (const auto& info : files) {
+            archives << info.filePath();
+        }
+    }
+    return archives;
+}
+
+int main(int argc, char* argv[])
+{
+    const QCoreApplication app(argc, argv);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription(QStringLiteral("Searches yeTTY's long term run mode archives in parallel"));
+    parser.addHelpOption();
+    const QCommandLineOption jobsOption({ QStringLiteral("j"), QStringLiteral("jobs") },
+        QStringLiteral("Number of archives searched at once (default: number of cores)"), QStringLiteral("N"));
+    const QCommandLineOption fixedOption({ QStringLiteral("F"), QStringLiteral("fixed-strings") },
+        QStringLiteral("PATTERN is a plain string"));
+    const QCommandLineOption ignoreCaseOption({ QStringLiteral("i"), QStringLiteral("ignore-case") }, QStringLiteral("Ignore case"));
+    const QCommandLineOption portOption({ QStringLiteral("p"), QStringLiteral("port") },
+        QStringLiteral("Only search the archives of this port"), QStringLiteral("PORT_NAME"));
+    const QCommandLineOption statsOption(QStringLiteral("stats"), QStringLiteral("Print throughput statistics to stderr"));
+    parser.addOptions({ jobsOption, fixedOption, ignoreCaseOption, portOption, statsOption });
+    parser.addPositionalArgument(QStringLiteral("PATTERN"), QStringLiteral("Regular expression matched against each line"));
+    parser.addPositionalArgument(QStringLiteral("PATHS"), QStringLiteral("Archives or directories holding them"), QStringLiteral("PATHS..."));
+    parser.process(app);
+
+    const auto args = parser.positionalArguments();
+    if (args.size() < 2) {
+        parser.showHelp(2);
+    }
+
+    Search search;
+    const auto ignoreCase = parser.isSet(ignoreCaseOption);
+    search.options = QRegularExpression::UseUnicodePropertiesOption;
+    if (ignoreCase) {
+        search.options |= QRegularExpression::CaseInsensitiveOption;
+    }
+    search.caseSensitive = !ignoreCase;
+    if (parser.isSet(fixedOption)) {
+        search.fixed = !ignoreCase;
+        search.pattern = QRegularExpression::escape(args.at(0));
+        search.literal = args.at(0).toStdString();
+    } else {
+        search.pattern = args.at(0);
+        search.literal = requiredLiteral(args.at(0));
+    }
+    if (const QRegularExpression exp(search.pattern, search.options); !exp.isValid()) {
+        qCritical() << "Invalid pattern:" << exp.errorString();
+        return 2;
+    }
+
+    auto jobs = QThread::idealThreadCount();
+    if (parser.isSet(jobsOption)) {
+        bool ok {};
+        jobs = parser.value(jobsOption).toInt(&ok);
+        if (!ok || jobs < 1) {
+            qCritical() << "Invalid number of jobs" << parser.value(jobsOption);
+            return 2;
+        }
+    }
+
+    const auto archives = collectArchives(args.sliced(1), parser.value(portOption));
+
+    QElapsedTimer timer;
+    timer.start();
+
+    QMutex mutex;
+    QWaitCondition resultReady;
+    std::vector<Result> results(static_cast<size_t>(archives.size()));
+
+    QThreadPool pool;
+    pool.setMaxThreadCount(jobs);
+    const auto submit = [&](const qsizetype i) {
+        pool.start([&, i]() {
+            Result result;
+            try {
+                searchArchive(archives.at(i), search, result);
+            } catch (std::exception& e) {
+                result.error = QString::fromUtf8(e.what());
+            }
+            const QMutexLocker locker(&mutex);
+            result.done = true;
+            results[static_cast<size_t>(i)] = std::move(result);
+            resultReady.wakeAll();
+        });
+    };
+
+    // Print in order as the results come in. The searches run ahead by at most `window` archives, so only that many
+    // results are held in memory however many archives there are.
+    const auto window = static_cast<qsizetype>(jobs) * 2;
+    qsizetype submitted {};
+    qint64 bytes {};
+    qint64 matches {};
+    qsizetype skipped {};
+    bool failed {};
+    for (qsizetype i = 0; i < archives.size(); i++) {
+        // NOLINTNEXTLINE(altera-id-dependent-backward-branch)
+        for (; submitted < std::min(i + window, archives.size()); submitted++) {
+            submit(submitted);
+        }
+
+        auto& result = results[static_cast<size_t>(i)];
+        QMutexLocker locker(&mutex);
+        // NOLINTNEXTLINE(altera-id-dependent-backward-branch)
+        while (!result.done) {
+            resultReady.wait(&mutex);
+        }
+        const auto output = std::move(result.output);
+        const auto error = result.error;
+        bytes += result.bytes;
+        matches += result.matches;
+        skipped += result.skipped ? 1 : 0;
+        locker.unlock();
+
+        fwrite(output.constData(), 1, static_cast<size_t>(output.size()), stdout);
+        if (!error.isEmpty()) {
+            qCritical() << error;
+            failed = true;
+        }
+    }
+    fflush(stdout);
+    pool.waitForDone();
+
+    if (parser.isSet(statsOption)) {
+        const auto elapsed = std::max<qint64>(timer.elapsed(), 1);
+        qInfo().nospace() << archives.size() << " archives (" << skipped << " ruled out by their trigram filter), " << bytes / (1024 * 1024) << " MiB, " << matches << " matches, "
+                          << jobs << " jobs, " << elapsed << " ms, " << (bytes / 1000 / elapsed) << " MB/s, prefilter \""
+                          << search.literal.c_str() << "\"";
+    }
+
+    if (failed) {
+        return 2;
+    }
+    return matches ? 0 : 1;
+}
@@ -0,0 +1,140 @@
+#include "zstddictionary.hpp"
+
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QIODevice>
+
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <zdict.h>
+#include <zstd.h>
+
+QByteArray ZstdDictionary::train(const QByteArray& data)
+{
+    // Cut at line boundaries so that the samples look like what the compressor sees
+    std::vector<size_t> sampleSizes;
+    qsizetype start {};
+    // NOLINTNEXTLINE(altera-id-dependent-backward-branch)
+    while (start < data.size()) {
+        auto end = std::min(start + SAMPLE_SIZE, data.size());
+        if (end < data.size()) {
+            if (const auto newline = data.lastIndexOf('\n', end - 1); newline > start) {
+                end = newline + 1;
+            }
+        }
+        sampleSizes.push_back(static_cast<size_t>(end - start));
+        start = end;
+    }
+
+    QByteArray dictionary(static_cast<qsizetype>(MAX_SIZE), Qt::Uninitialized);
+    const auto result = ZDICT_trainFromBuffer(dictionary.data(), MAX_SIZE, data.constData(), sampleSizes.data(),
+        static_cast<unsigned>(sampleSizes.size()));
+    if (ZDICT_isError(result)) {
+        throw std::runtime_error(std::string("Failed to train dictionary: ") + ZDICT_getErrorName(result));
+    }
+    dictionary.resize(static_cast<qsizetype>(result));
+
+    return dictionary;
+}
+
+unsigned ZstdDictionary::id(const QByteArray& dictionary)
+{
+    return ZDICT_getDictID(dictionary.constData(), static_cast<size_t>(dictionary.size()));
+}
+
+QString ZstdDictionary::save(const QString& directory, const QString& portName, const QByteArray& dictionary)
+{
+    const auto filename = QStringLiteral("%1/%2_dict_%3.zdict").arg(directory, portName).arg(id(dictionary));
+
+    QFile file(filename);
+    if (!file.open(QIODevice::WriteOnly) || file.write(dictionary) != dictionary.size() || !file.flush()) {
+        throw std::runtime_error(QStringLiteral("Failed to save dictionary: %1 %2").arg(filename, file.errorString()).toStdString());
+    }
+
+    return filename;
+}
+
+QByteArray ZstdDictionary::loadLatest(const QString& directory, const QString& portName)
+{
+    const auto files = QDir(directory).entryInfoList({ portName + QStringLiteral("_dict_*.zdict") }, QDir::Files, QDir::Time);
+    // NOLINTNEXTLINE(altera-id-dependent-backward-branch)
+    for (const auto& info : files) {
+        QFile file(info.filePath());
+        if (!file.open(QIODevice::ReadOnly)) {
+            qWarning() << "Failed to open dictionary" << info.filePath() << file.errorString();
+            continue;
+        }
+        auto dictionary = file.readAll();
+        if (id(dictionary) != 0) {
+            return dictionary;
+        }
+        qWarning() << "Invalid dictionary" << info.filePath();
+    }
+
+    return {};
+}
+
+QByteArray ZstdDictionary::loadById(const QString& directory, const unsigned dictId)
+{
+    const auto files = QDir(directory).entryInfoList({ QStringLiteral("*_dict_%1.zdict").arg(dictId) }, QDir::Files);
+    // NOLINTNEXTLINE(altera-id-dependent-backward-branch)
+    for (const auto& info : files) {
+        QFile file(info.filePath());
+        if (!file.open(QIODevice::ReadOnly)) {
+            continue;
+        }
+        if (auto dictionary = file.readAll(); id(dictionary) == dictId) {
+            return dictionary;
+        }
+    }
+
+    return {};
+}
+
+QByteArray ZstdDictionary::collectFromArchives(const QString& directory, const QString& portName, const qsizetype maxBytes)
+{
+    QByteArray data;
+    const auto files = QDir(directory).entryInfoList({ portName + QStringLiteral("_*.txt.zst") }, QDir::Files, QDir::Time);
+
+    ZSTD_DCtx* const dctx = ZSTD_createDCtx();
+    if (!dctx) {
+        return data;
+    }
+    std::vector<char> outBuffer(ZSTD_DStreamOutSize());
+
+    // NOLINTNEXTLINE(altera-id-dependent-backward-branch)
+    for (const auto& info : files) {
+        if (data.size() >= maxBytes) {
+            break;
+        }
+
+        QFile file(info.filePath());
+        if (!file.open(QIODevice::ReadOnly)) {
+            continue;
+        }
+        const auto compressed = file.readAll();
+        const auto sizeBefore = data.size();
+        void(ZSTD_DCtx_reset(dctx, ZSTD_reset_session_only));
+
+        ZSTD_inBuffer input = { compressed.constData(), static_cast<size_t>(compressed.size()), 0 };
+        // NOLINTNEXTLINE(altera-id-dependent-backward-branch)
+        while (input.pos < input.size && data.size() < maxBytes) {
+            ZSTD_outBuffer out = { outBuffer.data(), outBuffer.size(), 0 };
+            if (const auto result = ZSTD_decompressStream(dctx, &out, &input); ZSTD_isError(result)) {
+                // Most likely compressed with a dictionary, keep what was decoded until here
+                qInfo() << "Skipping rest of" << info.filePath() << ZSTD_getErrorName(result);
+                break;
+            }
+            data.append(outBuffer.data(), static_cast<qsizetype>(out.pos));
+        }
+        qInfo() << "Collected" << (data.size() - sizeBefore) << "bytes from" << info.filePath();
+    }
+
+    ZSTD_freeDCtx(dctx);
+    data.truncate(maxBytes);
+    return data;
+}
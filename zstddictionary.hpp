@@ -0,0 +1,36 @@
+#ifndef ZSTDDICTIONARY_HPP
+#define ZSTDDICTIONARY_HPP
+
+#include <QByteArray>
+#include <QString>
+
+#include <cstddef>
+
+// Helpers for the per port zstd dictionaries used by the long term run mode archives.
+// A dictionary is stored next to the archives as <portName>_dict_<id>.zdict, the id is the one zstd writes in the
+// header of every frame compressed with it, so an archive can always be matched with its dictionary.
+class ZstdDictionary final {
+public:
+    static constexpr size_t MAX_SIZE = 112 * 1024;
+
+    // Trains a dictionary from `data` (which is cut into line aligned samples), throws on failure
+    [[nodiscard]] static QByteArray train(const QByteArray& data);
+    [[nodiscard]] static unsigned id(const QByteArray& dictionary);
+
+    // Returns the path of the saved file, throws on failure
+    static QString save(const QString& directory, const QString& portName, const QByteArray& dictionary);
+    // Newest dictionary saved for `portName`, empty if there is none
+    [[nodiscard]] static QByteArray loadLatest(const QString& directory, const QString& portName);
+    // Dictionary with the given id (as found in a frame header), empty if there is none
+    [[nodiscard]] static QByteArray loadById(const QString& directory, const unsigned dictId);
+
+    // Decompresses existing archives of `portName`, newest first, until `maxBytes` have been collected.
+    // Archives that can't be decompressed are skipped.
+    [[nodiscard]] static QByteArray collectFromArchives(const QString& directory, const QString& portName, const qsizetype maxBytes);
+
+private:
+    // Size of the training samples, roughly what a frame starts with
+    static constexpr qsizetype SAMPLE_SIZE = 4096;
+};
+
+#endif // ZSTDDICTIONARY_HPP